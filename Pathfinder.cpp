@@ -7,65 +7,142 @@
  */
   
  
+#include <chrono>
+#include <climits>
+#include <functional>
 #include <iostream>
-#include <fstream>
 #include <string>
+#include <thread>
 #include "console.h"
+#include "gevents.h"
 #include "graphtypes.h"
 #include "gpathfinder.h"
 #include "graph.h"
 #include "set.h"
 #include <math.h>
-#include "pqueue.h"
 #include <map>
 #include "path.h"
+#include "allpairs.h"
+#include "backgroundworker.h"
+#include "batchmode.h"
+#include "benchmark.h"
+#include "contraction.h"
+#include "dynamicspanningtree.h"
+#include "graphsnapshot.h"
+#include "instrumentation.h"
+#include "mapgraph.h"
+#include "mapsnapshot.h"
+#include "queryserver.h"
+#include "renderlayer.h"
+#include "shortestpath.h"
+#include "spatialindex.h"
+#include "spanningtree.h"
+#include "streamingspanningtree.h"
 #include "simpio.h"
 using namespace std;
  
  
  
 /* CONSTANTS */
-const int WHITESPACE = 1;
 const int REASONABLE_CLICK_RANGE = 6;
-const int MIDDLE_EARTH_SECOND_CITY_INDEX = 15;
-const int MIDDLE_EARTH_DISTANCE_INDEX = 30;
-const int MIDDLE_EARTH_DISTANCE_TEXT = 2;
-const int DISTANCE_FORMULA_POWER = 2;
-const int NUM_PATH_ENDPOINTS = 2;
 const string DEFAULT_ARC_COLOR = "Blue";
+const int SPEEDUP_SAMPLE_QUERIES = 200;
+const string TRACE_FILE_NAME = "pathfinder-trace.json";
+const string SETTLED_NODE_COLOR = "Orange";
+const int PROGRESS_REPAINT_MS = 100;
+const int EVENT_POLL_MS = 10;
+const int MAX_PROGRESS_PER_REPAINT = 2000;
  
  
  
  
+/* Type: Activity
+ * ---------------------------------------------
+ * What the event loop is in the middle of: nothing, waiting for
+ * the user to click the first or second city of a route, or
+ * waiting for a search or spanning tree running on the worker.
+ */
+ 
+enum Activity { IDLE, CHOOSING_START, CHOOSING_FINISH, SEARCHING, SPANNING };
+ 
+ 
+/* Type: RouteRequest
+ * ---------------------------------------------
+ * A route the user asked for: the search mode, the name its
+ * search is reported under (empty for the Dijkstra button, which
+ * reports the path cache instead), the two cities, and what the
+ * worker found for them.
+ */
+ 
+struct RouteRequest {
+    SearchMode mode;
+    string label;
+    Node* start;
+    Node* finish;
+    Path path;
+    SearchStats stats;
+    int dijkstraSettled;
+};
+ 
+ 
+/* Program state shared by the event loop, the button actions and the worker */
+static BackgroundWorker worker;
+static ProgressQueue<int> settledProgress;
+static ProgressQueue<Arc*> treeProgress;
+static Activity activity = IDLE;
+static RouteRequest route;
+static Path spanningTree;
+static map<string, function<void()> > buttonActions;
+ 
+ 
+ 
 /* Function prototypes */
 void runPathfinder();
-void convertMapDataToInternalRepresentation(PathfinderGraph & graph);
-void openAndProcessFileByLine(PathfinderGraph & graph, string mapName);
-void processNodes(ifstream & infile, PathfinderGraph & graph);
-void addNodeToGraph(string city, double xCoord, double yCoord, PathfinderGraph & graph);
-void processArcs(ifstream & infile, PathfinderGraph & graph, string mapName);
-void addArcToGraph(string pairCityOne, string pairCityTwo, double distancePairCities, PathfinderGraph & graph);
-void drawAllNodesArcs(PathfinderGraph & graph);
-void recolorAllNodes(PathfinderGraph & graph, string color);
-void recolorAllArcs(PathfinderGraph & graph, string color);
+void convertMapDataToInternalRepresentation(MapGraph & graph);
+void openAndProcessFileByLine(MapGraph & graph, string mapName);
+void drawAllNodesArcs();
 void highlightNode(Node* node);
 void highlightArc(Arc* arc);
-void addBasicButtons(PathfinderGraph & graph);
-void dijkstra(PathfinderGraph & graph);
-bool withinCityRadius(GPoint pt, Node* node);
-Node* userSelectNode(Set<Node*> & allNodes);
-Path findShortestPath(Node *start, Node *finish);
+void addBasicButtons(MapGraph & graph);
+void addAction(string name, void (*action)());
+void addAction(string name, void (*action)(MapGraph &), MapGraph & graph);
+void runEventLoop();
+void cancelActivity();
+void showProgress(int limit);
+void finishActivity();
+void dijkstra(MapGraph & graph);
+void buildHierarchy(MapGraph & graph);
+void buildAllPairs(MapGraph & graph);
+double timeRandomQueries(const GraphSnapshot & snapshot, SearchMode mode, int count);
+void aStar(MapGraph & graph);
+void bidirectional(MapGraph & graph);
+void beginRoute(MapGraph & graph, SearchMode mode, string label);
+void selectRouteNode(GPoint click);
+void startSearch();
+void finishSearch();
+Node* userSelectNode(GPoint click);
 double getPathCost(const Vector<Arc *> & path);
 void quitAction();
-void kruskal(PathfinderGraph & graph);
+void kruskal(MapGraph & graph);
+void finishSpanningTree();
+void toggleTrace();
  
  
  
  
  
 /* Main program */
- 
-int main() {
+/* Any command-line arguments select the headless batch mode (see batchmode.h), */
+/* or the benchmark mode (see benchmark.h) if the first of them is --benchmark, */
+/* or the streaming spanning tree mode (see streamingspanningtree.h) if it is --stream-mst, */
+/* or the query server or its client (see queryserver.h) if it is --serve or --client. */
+ 
+int main(int argc, char *argv[]) {
+    if (argc > 1 && string(argv[1]) == "--benchmark") return runBenchmarkMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--stream-mst") return runStreamingTreeMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--serve") return runServerMode(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--client") return runClientMode(argc, argv);
+    if (argc > 1) return runBatchMode(argc, argv);
     runPathfinder();
     return 0;
 }
@@ -79,10 +156,121 @@ int main() {
  
   
 void runPathfinder() {
-    PathfinderGraph graph;
+    MapGraph graph;
     initPathfinderGraphics();
     addBasicButtons(graph);
-    pathfinderEventLoop();
+    runEventLoop();
+}
+ 
+ 
+/* Function: runEventLoop
+ * Usage: runEventLoop();
+ * --------------------------------------
+ * This function takes the place of pathfinderEventLoop so that the
+ * buttons keep working while a search or spanning tree runs on the
+ * worker (see backgroundworker.h). While the worker is busy it polls
+ * for events every EVENT_POLL_MS and repaints the worker's progress
+ * at most every PROGRESS_REPAINT_MS; otherwise it sleeps until the
+ * next event. Every button cancels whatever is in progress before
+ * its action runs, so Map and Quit take effect right away. Mouse
+ * clicks choose the cities of a route.
+ */
+ 
+ 
+void runEventLoop() {
+    chrono::steady_clock::time_point lastRepaint = chrono::steady_clock::now();
+    while (true) {
+        GEvent event = worker.isBusy() ? getNextEvent(ACTION_EVENT + MOUSE_EVENT)
+                                       : waitForEvent(ACTION_EVENT + MOUSE_EVENT);
+        if (event.isValid() && event.getEventClass() == ACTION_EVENT) {
+            string command = GActionEvent(event).getActionCommand();
+            if (buttonActions.count(command) > 0) {
+                cancelActivity();
+                buttonActions[command]();
+            }
+        } else if (event.isValid() && event.getEventType() == MOUSE_CLICKED) {
+            GMouseEvent click(event);
+            selectRouteNode(GPoint(click.getX(), click.getY()));
+        }
+        if (!worker.isBusy()) continue;
+        if (worker.isDone()) {
+            finishActivity();
+            continue;
+        }
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (now - lastRepaint >= chrono::milliseconds(PROGRESS_REPAINT_MS)) {
+            showProgress(MAX_PROGRESS_PER_REPAINT);
+            lastRepaint = now;
+        }
+        if (!event.isValid()) this_thread::sleep_for(chrono::milliseconds(EVENT_POLL_MS));
+    }
+}
+ 
+ 
+/* Function: cancelActivity
+ * Usage: cancelActivity();
+ * --------------------------------------
+ * This function stops the worker, waiting for it to return, and
+ * drops its unshown progress and any half-chosen route. It is
+ * called before every button action.
+ */
+ 
+ 
+void cancelActivity() {
+    worker.cancel();
+    settledProgress.clear();
+    treeProgress.clear();
+    if (activity == SEARCHING || activity == SPANNING) cout<<"Cancelled."<<endl;
+    activity = IDLE;
+}
+ 
+ 
+/* Function: showProgress
+ * Usage: showProgress(limit);
+ * --------------------------------------
+ * This function colors up to limit of the nodes the running search
+ * has settled, or highlights up to limit of the arcs the spanning
+ * tree has accepted, and repaints them in one flush. The cities of
+ * the route keep their highlight.
+ */
+ 
+ 
+void showProgress(int limit) {
+    if (activity == SEARCHING) {
+        const GraphSnapshot & snapshot = getGraphSnapshot();
+        vector<int> settled;
+        settledProgress.take(settled, limit);
+        for (size_t i = 0; i < settled.size(); i++) {
+            Node* node = snapshot.nodes[settled[i]];
+            if (node != route.start && node != route.finish) setNodeColor(node, SETTLED_NODE_COLOR);
+        }
+    } else if (activity == SPANNING) {
+        vector<Arc*> accepted;
+        treeProgress.take(accepted, limit);
+        for (size_t i = 0; i < accepted.size(); i++) {
+            highlightArc(accepted[i]);
+        }
+    }
+    flushRenderLayer();
+}
+ 
+ 
+/* Function: finishActivity
+ * Usage: finishActivity();
+ * --------------------------------------
+ * This function collects the worker's finished job, shows the rest
+ * of its progress, and displays and reports its result.
+ */
+ 
+ 
+void finishActivity() {
+    worker.finish();
+    if (activity == SEARCHING) {
+        finishSearch();
+    } else if (activity == SPANNING) {
+        finishSpanningTree();
+    }
+    activity = IDLE;
 }
  
  
@@ -108,13 +296,19 @@ int askUserWhichMap(){
  * Usage: addButton("Map", convertMapDataToInternalRepresentation, graph);
  * -----------------------------------------
  * This function is called when the user clicks on the map button.
- * It first calls askUserWhichMap to identify the file needed, and then
- * it sends that file name to openAndProcessFileByLine, which then operates
- * on that file.
+ * It drops the snapshot and dynamic spanning tree of the old map
+ * before clearing the graph, which frees the old map's nodes and arcs
+ * in one step (see mapgraph.h). It calls
+ * askUserWhichMap to identify the file needed, and then it sends
+ * that file name to openAndProcessFileByLine, which then operates on
+ * that file.
  */
  
  
-void convertMapDataToInternalRepresentation(PathfinderGraph & graph) {
+void convertMapDataToInternalRepresentation(MapGraph & graph) {
+    getDynamicSpanningTree().clear();
+    getAllPairsTable().clear();
+    clearGraphSnapshot();
     graph.clear();
     int mapChoice = askUserWhichMap();
     Vector<string> allMaps;
@@ -130,578 +324,480 @@ void convertMapDataToInternalRepresentation(PathfinderGraph & graph) {
 /* Function: openAndProcessFileByLine
  * Usage: openAndProcessFileByLine(graph, mapName);
  * --------------------------------------------
- * This function goes through the text file and draws the relevant map,
- * and then it calls processNodes and processArcs to store the info in
- * the relevant data structures. Nodes and arcs are drawn by calling
- * the function drawAllNodesArcs.
+ * This function hands the map file to loadMap (see mapsnapshot.h),
+ * which stores the nodes and arcs in the graph, from the binary
+ * snapshot when a valid one exists, and rebuilds the CSR snapshot
+ * (see graphsnapshot.h) that the search and spanning tree code reads.
+ * It then draws the background image the map names, which clears
+ * the display, so the render layer (see renderlayer.h) is reset
+ * before nodes and arcs are drawn by drawAllNodesArcs. Finally it
+ * reports how much memory the map takes.
  */
  
-void openAndProcessFileByLine(PathfinderGraph & graph, string mapName) {
-    ifstream infile;
-    string line;
-    infile.open(mapName.c_str());
-    getline(infile, line);
-    drawPathfinderMap(line);
-    processNodes(infile, graph);
-    processArcs(infile, graph, mapName);
-    drawAllNodesArcs(graph);
-    infile.close();
+void openAndProcessFileByLine(MapGraph & graph, string mapName) {
+    string imageName = loadMap(graph, mapName);
+    drawPathfinderMap(imageName);
+    resetRenderLayer();
+    drawAllNodesArcs();
+    MapGraphStats stats = graph.getStats();
+    cout<<"Map uses "<<graph.totalBytes()<<" bytes: "<<stats.nodeCount<<" cities ("
+        <<stats.nodeBytes<<"), "<<stats.arcCount<<" arcs ("<<stats.arcBytes<<"), long names ("
+        <<stats.nameBytes<<")."<<endl;
 }
  
  
  
-/* Function: processNodes
- * Usage: processNodes(infile, graph);
- * --------------------------------------------
- * This function goes through each line of the file, extracts the
- * city name and location info, and then calls addNodeToGraph to store
- * that node info in the graph.
+/* Function: drawAllNodesArcs
+ * Usage: drawAllNodesArcs();
+ * ------------------------------------------
+ * This function draws all the nodes and arcs of the loaded map,
+ * repainting the display once.
  */
  
  
-void processNodes(ifstream & infile, PathfinderGraph & graph) {
-    string line;
-    getline(infile, line);
-    while (true) {
-        getline(infile, line);
-        if (line=="ARCS") return;
- 
-        int firstSpace = line.find(" ");
-        int secondSpace = line.find(" ", firstSpace+WHITESPACE);
-        string city = line.substr(0, firstSpace);
-         
-        double xCoord = strtod(line.substr(firstSpace+WHITESPACE, secondSpace-(firstSpace+WHITESPACE)).c_str(), NULL);
-        double yCoord = strtod(line.substr(secondSpace+WHITESPACE, (line.size()-1) - (secondSpace)).c_str(), NULL);
-        addNodeToGraph(city, xCoord, yCoord, graph);
-    }
+void drawAllNodesArcs() {
+    setAllNodeColors(NODE_COLOR);
+    setAllArcColors(DEFAULT_ARC_COLOR);
+    flushRenderLayer();
 }
  
  
-/* Function: addNodeToGraph
- * Usage: addNodeToGraph(city, xCoord, yCoord, graph);
- * -------------------------------------------------
- * This function takes the info extracted by processNodes and
- * adds it to the Node* struct, which is then stored in the graph.
+/* Function: highlightNode
+ * Usage: highlightNode(node);
+ * -----------------------------------------
+ * This function makes it easy to highlight a node so we don't need
+ * to remember the name of the function. Like every change made
+ * through the render layer, it shows at the next flushRenderLayer.
  */
  
- 
-void addNodeToGraph(string city, double xCoord, double yCoord, PathfinderGraph & graph) {
-    Node* currentNode = new Node;
-    currentNode->name = city;
-    currentNode->loc = GPoint(xCoord,yCoord);
-    graph.addNode(currentNode);
+void highlightNode(Node* node) {
+    setNodeColor(node, HIGHLIGHT_COLOR);
 }
  
  
-/* Function: processMiddleEarthArcs
- * Usage: processMiddleEarthArcs(line, graph);
- * ----------------------------------------------
- * This function takes the line info and extracts the relevant information.
- * The formatting for the arc descriptions in the file MiddleEarth.txt is 
- * different from that in Small.txt and USA.txt, so it needs to be processed
- * separately. It then calls addArcToGraph to add the info the graph.
+/* Function: highlightArc
+ * Usage: highlightArc(arc);
+ * -------------------------------------------
+ * This function makes it easy to highlight an arc, together
+ * with the arc running the other way along the same road.
  */
  
-void processMiddleEarthArcs(string line, PathfinderGraph & graph) {
-     
-    int firstSpace = line.find(" ");
-    int secondSpace = line.find(" ", MIDDLE_EARTH_SECOND_CITY_INDEX);
-    string pairCityOne = line.substr(0, firstSpace);
-    string pairCityTwo = line.substr(MIDDLE_EARTH_SECOND_CITY_INDEX, secondSpace-MIDDLE_EARTH_SECOND_CITY_INDEX);
-    double distancePairCities = strtod((line.substr(MIDDLE_EARTH_DISTANCE_INDEX, MIDDLE_EARTH_DISTANCE_TEXT)).c_str(), NULL);
-    addArcToGraph(pairCityOne, pairCityTwo, distancePairCities, graph);         
  
+void highlightArc(Arc* arc) {
+    setArcColor(arc, HIGHLIGHT_COLOR);
 }
  
-/* Function: processUSArcs
- * Usage: processUSArcs(line, graph);
+ 
+/* Function: addBasicButtons
+ * Usage: addBasicButtons(graph);
  * ----------------------------------------------
- * This function extracts arc information from lines in the Small.txt
- * and USA.txt files. It then calls addArcToGraph to add the info to 
- * arcs in the graph.
- *
+ * This function adds the standard set of buttons to the display.
  */
  
-void processUSArcs(string line, PathfinderGraph & graph) {
-     
-    int firstSpace = line.find(" ");
-    int secondSpace = line.find(" ", firstSpace+WHITESPACE);
-    string pairCityOne = line.substr(0, firstSpace);
-    string pairCityTwo = line.substr(firstSpace+1, secondSpace-(firstSpace+WHITESPACE));
-    double distancePairCities = strtod(line.substr(secondSpace+WHITESPACE, (line.size()-1)).c_str(), NULL);
-    addArcToGraph(pairCityOne, pairCityTwo, distancePairCities, graph);         
- 
-     
+void addBasicButtons(MapGraph & graph){
+    addAction("Quit", quitAction);
+    addAction("Map", convertMapDataToInternalRepresentation, graph);
+    addAction("Dijkstra", dijkstra, graph);
+    addAction("A*", aStar, graph);
+    addAction("Bidirectional", bidirectional, graph);
+    addAction("Hierarchy", buildHierarchy, graph);
+    addAction("All Pairs", buildAllPairs, graph);
+    addAction("Kruskal", kruskal, graph);
+    addAction("Trace", toggleTrace);
 }
  
  
-/* Function: processArcs
- * Usage: processArcs(infile, graph, mapName);
- * -------------------------------------------
- * This function is called by openAndProcessFileByLine to process
- * all the arc information in the files. The function checks to see
- * which file the info needs to be extracted from, and separates
- * the case for MiddleEarth and USA/Small, because the formatting is
- * different.
+/* Function: addAction
+ * Usage: addAction(name, action);
+ *        addAction(name, action, graph);
+ * ----------------------------------------------
+ * This function adds a button to the display and records the
+ * action that runEventLoop calls when it is clicked.
  */
  
+void addAction(string name, void (*action)()) {
+    addButton(name, action);
+    buttonActions[name] = action;
+}
  
-void processArcs(ifstream & infile, PathfinderGraph & graph, string mapName) {
-    string line;
-    while (true) {
-        getline(infile, line);
-        if (infile.fail()) break;
-        if (mapName=="MiddleEarth.txt") {
-            processMiddleEarthArcs(line, graph);
-        }
-         
-        else {
-            processUSArcs(line, graph);
-        }
-    }   
+void addAction(string name, void (*action)(MapGraph &), MapGraph & graph) {
+    addButton(name, action, graph);
+    buttonActions[name] = [action, &graph]() { action(graph); };
 }
  
  
-/* Function: addArcToGraph
- * Usage: addArcToGraph(pairCityOne, pairCityTwo, distancePairCities, graph);
- * -----------------------------------------
- * This function takes the extracted info about the arcs and adds them to
- * an Arc* struct, which is then added to the graph.
+/* Function: quitAction
+ * Usage: addButton("Quit", quitAction);
+ * ------------------------------------------------
+ * This function is called when the user clicks the Quit button,
+ * causing the program to terminate and close the display. It
+ * makes sure the worker has stopped before the program exits.
  */
  
  
-void addArcToGraph(string pairCityOne, string pairCityTwo, double distancePairCities, PathfinderGraph & graph) {
-    for (int i=0; i<NUM_PATH_ENDPOINTS; i++) {
-        Arc* currentArc = new Arc;
-        currentArc->cost = distancePairCities;
-        if (i==0) {
-            currentArc->start = graph.getNode(pairCityOne);
-            currentArc->finish = graph.getNode(pairCityTwo);
-        }
-        if (i==1) {
-            currentArc->start = graph.getNode(pairCityTwo);
-            currentArc->finish = graph.getNode(pairCityOne);
-        }
-        graph.addArc(currentArc);
-    }
+void quitAction() {
+    worker.cancel();
+    exit(0);
 }
  
  
- 
-/* Function: drawAllNodesArcs
- * Usage: drawAllNodesArcs(graph);
- * ------------------------------------------
- * This function draws all the nodes and arcs in the graph.
+/* Function: toggleTrace
+ * Usage: addButton("Trace", toggleTrace);
+ * ------------------------------------------------
+ * This function is called when the user clicks the Trace button.
+ * The first click starts recording instrumentation (see
+ * instrumentation.h); the next one stops it and saves the phases
+ * and counters as a Chrome trace in TRACE_FILE_NAME.
  */
  
  
-void drawAllNodesArcs(PathfinderGraph & graph) {
-    recolorAllNodes(graph,NODE_COLOR);
-    recolorAllArcs(graph, DEFAULT_ARC_COLOR);
-    repaintPathfinderDisplay();
+void toggleTrace() {
+    if (!isInstrumentationEnabled()) {
+        resetInstrumentation();
+        setInstrumentationEnabled(true);
+        cout<<"Tracing started."<<endl;
+        return;
+    }
+    setInstrumentationEnabled(false);
+    if (saveInstrumentation(TRACE_FILE_NAME, true)) {
+        cout<<"Trace saved to "<<TRACE_FILE_NAME<<"."<<endl;
+    } else {
+        cout<<"Could not write "<<TRACE_FILE_NAME<<"."<<endl;
+    }
 }
  
  
-/* Function: highlightNode
- * Usage: highlightNode(node);
- * -----------------------------------------
- * This function makes it easy to highlight a node so we don't need
- * to remember the name of the function.
- */
- 
-void highlightNode(Node* node) {
-    drawPathfinderNode(node->loc, HIGHLIGHT_COLOR, node->name);
-}
  
  
-/* Function: highlightArc
- * Usage: highlightArc(arc);
- * -------------------------------------------
- * This function makes it easy to highlight an arc.
+/* Function: userSelectNode
+ * Usage: Node* node = userSelectNode(click);
+ * --------------------------------------------------
+ * This function asks the spatial index (see spatialindex.h) for the
+ * nearest city within REASONABLE_CLICK_RANGE of a click on the
+ * graph. The range is 6, and the node radius is 4, so it seems
+ * fair. The city is highlighted at the caller's next
+ * flushRenderLayer. If no city is in range it asks the user to try
+ * again and returns NULL.
  */
  
  
-void highlightArc(Arc* arc) {
-    drawPathfinderArc((arc->start)->loc, (arc->finish)->loc, HIGHLIGHT_COLOR);
+Node* userSelectNode(GPoint click) {
+ 
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    int id = getSpatialIndex().nearestNode(click.getX(), click.getY(), REASONABLE_CLICK_RANGE);
+    if (id == NO_NODE) {
+        cout<< "Please click on a city." <<endl;
+        return NULL;
+    }
+    highlightNode(snapshot.nodes[id]);
+    return snapshot.nodes[id];
 }
  
  
-/* Function: recolorAllNodes
- * Usage: recolorAllNodes(graph, color);
+/* Function: beginRoute
+ * Usage: beginRoute(graph, mode, label);
  * ---------------------------------------------
- * This function makes it easy to color all the nodes at once.
+ * It starts off graying out all paths, then waits for the user to
+ * select two cities; the event loop passes their clicks to
+ * selectRouteNode. The route is searched with the given mode and
+ * reported under label. Does nothing if no map has been loaded.
  */
  
-void recolorAllNodes(PathfinderGraph & graph, string color) {
-    Set<Node*> allNodes = graph.getNodeSet();
-    foreach (Node* node in allNodes) {
-        drawPathfinderNode(node->loc, color, node->name);
+ 
+void beginRoute(MapGraph & graph, SearchMode mode, string label) {
+    if (graph.isEmpty()) {
+        cout<<"Please select a map!"<<endl;
+        return;
     }
-    repaintPathfinderDisplay();
+    setAllArcColors(DIM_COLOR);
+    setAllNodeColors(NODE_COLOR);
+    flushRenderLayer();
+    route = RouteRequest();
+    route.mode = mode;
+    route.label = label;
+    activity = CHOOSING_START;
 }
  
  
-/* Function: recolorAllArcs
- * Usage: recolorAllArcs(graph, color);
+/* Function: selectRouteNode
+ * Usage: selectRouteNode(click);
  * ---------------------------------------------
- * This function makes it easy to color all the arcs at once.
+ * This function is called for every mouse click. While a route
+ * is being chosen, a click on a city selects its start or, once
+ * that is known, its finish, which starts the search.
  */
  
-void recolorAllArcs(PathfinderGraph & graph, string color) {
-    Set<Arc*> allArcs = graph.getArcSet();
-    foreach (Arc* arc in allArcs) {
-        drawPathfinderArc((arc->start)->loc, (arc->finish)->loc, color);
+ 
+void selectRouteNode(GPoint click) {
+    if (activity != CHOOSING_START && activity != CHOOSING_FINISH) return;
+    Node* node = userSelectNode(click);
+    if (node == NULL) return;
+    flushRenderLayer();
+    if (activity == CHOOSING_START) {
+        route.start = node;
+        activity = CHOOSING_FINISH;
+    } else {
+        route.finish = node;
+        startSearch();
     }
-    repaintPathfinderDisplay();
 }
  
  
-/* Function: addBasicButtons
- * Usage: addBasicButtons(graph);
- * ----------------------------------------------
- * This function adds the standard set of buttons to the display.
+/* Function: startSearch
+ * Usage: startSearch();
+ * ---------------------------------------------
+ * This function hands the route to findShortestPath (see
+ * shortestpath.h) on the worker. A search observer posts every
+ * node the search settles for the event loop to color, and stops
+ * the search once the worker is cancelled. A labeled route is then
+ * searched again with plain Dijkstra, whose settled nodes are only
+ * counted, for the report.
  */
  
-void addBasicButtons(PathfinderGraph & graph){
-    addButton("Quit", quitAction);
-    addButton("Map", convertMapDataToInternalRepresentation, graph);
-    addButton("Dijkstra", dijkstra, graph);
-    addButton("Kruskal", kruskal, graph);
+ 
+void startSearch() {
+    activity = SEARCHING;
+    worker.start([]() {
+        setSearchObserver([](int node) {
+            settledProgress.post(node);
+            return !worker.isCancelled();
+        });
+        route.path = findShortestPath(route.start, route.finish, route.mode);
+        route.stats = getLastSearchStats();
+        settledProgress.publish();
+        if (route.label != "" && route.path.size() > 0 && !worker.isCancelled()) {
+            setSearchObserver([](int) { return !worker.isCancelled(); });
+            findShortestPath(route.start, route.finish, DIJKSTRA_SEARCH);
+            route.dijkstraSettled = getLastSearchStats().settledNodes;
+        }
+        setSearchObserver(function<bool(int)>());
+    });
 }
  
  
-/* Function: quitAction
- * Usage: addButton("Quit", quitAction);
- * ------------------------------------------------
- * This function is called when the user clicks the Quit button,
- * causing the program to terminate and close the display.
+/* Function: finishSearch
+ * Usage: finishSearch();
+ * ---------------------------------------------
+ * This function shows the rest of the settled nodes, highlights
+ * the arcs of the path the worker found, and reports how many
+ * nodes the search settled next to plain Dijkstra for a labeled
+ * route, or how often the path cache has answered queries.
  */
  
  
-void quitAction() {
-    exit(0);
+void finishSearch() {
+    showProgress(INT_MAX);
+    Vector<Arc*> allArcs = route.path.allArcs();
+    foreach (Arc* arc in allArcs) {
+        highlightArc(arc);
+    }
+    flushRenderLayer();
+    if (route.label != "") {
+        if (route.path.size() == 0) return;
+        cout<<route.label<<" settled "<<route.stats.settledNodes<<" nodes; Dijkstra settled "
+            <<route.dijkstraSettled<<"."<<endl;
+        return;
+    }
+    PathCacheStats stats = getPathCacheStats();
+    cout<<"Path cache: "<<stats.pathHits<<" hits, "<<stats.pathMisses<<" misses; trees: "
+        <<stats.treeHits<<" hits, "<<stats.treeResumes<<" resumed, "<<stats.treeMisses<<" misses."<<endl;
 }
  
  
- 
- 
-/* Function: userSelectNode
- * Usage: Node* startNode = userSelectNode(allNodes);
- * --------------------------------------------------
- * This function waits for the user to click on the graph, and calls
- * withinCityRadius to check if the user clicked on a city. It doesn't
- * terminate till the user clicks on a valid city. It's called by
- * the implementation of Dijkstra.
+/* Function: dijkstra
+ * Usage: dijkstra(graph);
+ * ---------------------------------------------
+ * This function uses Dijkstra's shortest path algorithm
+ * to highlight the shortest path between two cities the
+ * user selects. The work is done by beginRoute and startSearch.
+ * Once the Hierarchy button has preprocessed the current map,
+ * the query goes through the contraction hierarchy instead,
+ * which finds a path of the same cost much faster, and once the
+ * All Pairs button has, the path is read off its table. Afterwards
+ * it reports how often the path cache has answered queries.
  */
  
  
-Node* userSelectNode(Set<Node*> & allNodes) {
- 
-    bool validEntry = false;
-    while (!validEntry) {
-        GPoint pt = getMouseClick();
-        foreach (Node* node in allNodes) {
-            if (withinCityRadius(pt, node)) {
-                highlightNode(node);
-                return node;
-            }
-        }
-        cout<< "Please click on a city." <<endl; 
-    }   
+void dijkstra(MapGraph & graph) {
+    bool tabled = getAllPairsTable().isBuiltFor(getGraphSnapshot());
+    beginRoute(graph, tabled ? ALL_PAIRS_SEARCH : HIERARCHY_SEARCH, "");
 }
  
  
-/* Function: withinCityRadius
- * Usage: if (withinCityRadius(pt, node))
- * ---------------------------------------------------
- * This function uses the standard distance formula:
- *   distance = sqrt((x1-x2)^2 + (y2-y1)^2)
- * to see if th user clicked reasonably close to a city,
- * as defined by the REASONABLE_CLICK_RANGE constant.
- * The constant is set to 6, and the node radius is 4,
- * so it seems fair.
+/* Function: buildHierarchy
+ * Usage: addButton("Hierarchy", buildHierarchy, graph);
+ * ---------------------------------------------
+ * This function is called when the user clicks the Hierarchy
+ * button. It builds a contraction hierarchy (see contraction.h)
+ * for the loaded map, then reports the preprocessing time, how
+ * many shortcuts were added, and how much faster a batch of
+ * random queries runs than with plain Dijkstra.
  */
  
  
-bool withinCityRadius(GPoint pt, Node* node) {
-     
-    double nodeXCoord = node->loc.getX();
-    double nodeYCoord = node->loc.getY();
-    double ptXcoord = pt.getX();
-    double ptYcoord = pt.getY();
-    double distance = sqrt(pow((nodeXCoord - ptXcoord), DISTANCE_FORMULA_POWER) + pow((nodeYCoord - ptYcoord), DISTANCE_FORMULA_POWER));
-     
-    if (distance<REASONABLE_CLICK_RANGE) {
-        return true;
+void buildHierarchy(MapGraph & graph) {
+    if (graph.isEmpty()) {
+        cout<<"Please select a map!"<<endl;
+        return;
+    }
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    ContractionHierarchy & hierarchy = getContractionHierarchy();
+    hierarchy.build(snapshot);
+    HierarchyStats stats = hierarchy.getStats();
+    cout<<"Contracted "<<stats.nodeCount<<" nodes in "<<stats.buildSeconds<<" s, adding "
+        <<stats.shortcutCount<<" shortcuts to "<<stats.originalEdges<<" edges."<<endl;
+    double dijkstraSeconds = timeRandomQueries(snapshot, DIJKSTRA_SEARCH, SPEEDUP_SAMPLE_QUERIES);
+    double hierarchySeconds = timeRandomQueries(snapshot, HIERARCHY_SEARCH, SPEEDUP_SAMPLE_QUERIES);
+    if (hierarchySeconds > 0) {
+        cout<<"Query speedup over Dijkstra: "<<dijkstraSeconds / hierarchySeconds<<"x"<<endl;
     }
-    return false;
-     
 }
  
  
-/* Function: dijkstra
- * Usage: dijkstra(graph);
+/* Function: buildAllPairs
+ * Usage: addButton("All Pairs", buildAllPairs, graph);
  * ---------------------------------------------
- * This function uses Dijkstra's shortest path algorithm
- * to highlight the shortest path between two cities the
- * user selects. It starts off graying out all paths, then
- * asks the user to select two cities. These cities are then
- * sent to findShortestPath, which returns a vector of arcs
- * that form the shortest path. Those arcs are then
- * highlighted for display.
- *
+ * This function is called when the user clicks the All Pairs
+ * button. It precomputes the distance and next-hop matrices of
+ * the loaded map (see allpairs.h), then reports the time and
+ * memory they took and how much faster a batch of random queries
+ * runs than with plain Dijkstra. Maps over the table's node limit
+ * are refused and keep using the other searches.
  */
  
  
-void dijkstra(PathfinderGraph & graph) {
-     
+void buildAllPairs(MapGraph & graph) {
     if (graph.isEmpty()) {
         cout<<"Please select a map!"<<endl;
         return;
     }
-    Set<Node*> allNodes = graph.getNodeSet();
-    recolorAllArcs(graph, DIM_COLOR);
-    recolorAllNodes(graph, NODE_COLOR);
-         
-    Node* startNode = userSelectNode(allNodes);
-    Node* endNode = userSelectNode(allNodes);
- 
-    Path path = findShortestPath(startNode, endNode);
-    Vector<Arc*> allArcs = path.allArcs();
-     
-    foreach (Arc* arc in allArcs) {
-        highlightArc(arc);
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    AllPairsTable & table = getAllPairsTable();
+    if (!table.build(snapshot)) {
+        cout<<"The map has "<<snapshot.nodeCount()<<" nodes, more than the all-pairs limit of "
+            <<table.getNodeLimit()<<"."<<endl;
+        return;
+    }
+    AllPairsStats stats = table.getStats();
+    cout<<"Computed all pairs of "<<stats.nodeCount<<" nodes in "<<stats.buildSeconds<<" s ("
+        <<(stats.vectorized ? "AVX2" : "scalar")<<"), using "<<stats.matrixBytes<<" bytes."<<endl;
+    double dijkstraSeconds = timeRandomQueries(snapshot, DIJKSTRA_SEARCH, SPEEDUP_SAMPLE_QUERIES);
+    double tableSeconds = timeRandomQueries(snapshot, ALL_PAIRS_SEARCH, SPEEDUP_SAMPLE_QUERIES);
+    if (tableSeconds > 0) {
+        cout<<"Query speedup over Dijkstra: "<<dijkstraSeconds / tableSeconds<<"x"<<endl;
     }
- 
-     
 }
  
  
-/* Function: findShortestPath
- * Usage: Vector<Arc *> path = findShortestPath(start, finish);
- * ------------------------------------------------------------
- * Finds the shortest path between the nodes start and finish 
- * using * Dijkstra's algorithm, which keeps track of the shortest 
- * paths in * a priority queue. The function returns a vector of arcs, 
- * which is * empty if start and finish are the same node or if no path 
- * exists.
- * 
- * Mostly copied from Course Reader with slight modifications,
- * so kept the length of the given code the same for clarity.
+/* Function: timeRandomQueries
+ * Usage: double seconds = timeRandomQueries(snapshot, mode, count);
+ * ---------------------------------------------
+ * This function runs count queries between pseudo-random pairs
+ * of cities and returns the total time they took. The pairs come
+ * from a fixed seed, so every mode is timed on the same routes;
+ * the path cache is off meanwhile so that repeats are searched.
  */
  
-Path findShortestPath(Node *start, Node *finish) {
-    Path path;
-    PriorityQueue < Path > mainQueue;
-    Map<string, double> fixed;
-    while (start != finish) {
-        if (!fixed.containsKey(start->name)) {
-            fixed.put(start->name, path.totalCost());
-            foreach (Arc *arc in start->arcs) {
-                if (!fixed.containsKey(arc->finish->name)) {
-                    path.add(arc);
-                    mainQueue.enqueue(path, path.totalCost());
-                    path.removeAt(path.size() - 1);
-                }
-            }
-        }
-        if (mainQueue.isEmpty()) {
-            path.clear();
-            return path;
-        }
-        path = mainQueue.dequeue();
-        start = path.getArc(path.size() - 1)->finish;
+ 
+double timeRandomQueries(const GraphSnapshot & snapshot, SearchMode mode, int count) {
+    int nodeCount = snapshot.nodeCount();
+    if (nodeCount == 0) return 0;
+    unsigned int seed = 1;
+    setPathCacheEnabled(false);
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        Node* start = snapshot.nodes[(seed >> 8) % nodeCount];
+        seed = seed * 1103515245 + 12345;
+        Node* finish = snapshot.nodes[(seed >> 8) % nodeCount];
+        findShortestPath(start, finish, mode);
     }
-    return path;
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    setPathCacheEnabled(true);
+    return elapsed.count();
 }
  
  
+/* Function: aStar
+ * Usage: addButton("A*", aStar, graph);
+ * ---------------------------------------------
+ * This function is called when the user clicks the A* button.
+ * It highlights the same kind of path as dijkstra, but guides
+ * the search toward the destination with the straight-line
+ * distance heuristic. Afterwards it reports how many nodes A*
+ * settled next to how many plain Dijkstra settles for the
+ * same pair of cities.
+ */
  
  
+void aStar(MapGraph & graph) {
+    beginRoute(graph, ASTAR_SEARCH, "A*");
+}
  
  
+/* Function: bidirectional
+ * Usage: addButton("Bidirectional", bidirectional, graph);
+ * ---------------------------------------------
+ * This function is called when the user clicks the Bidirectional
+ * button. It highlights a shortest path found by searching from both
+ * cities at once, then reports how many nodes that settled next to
+ * how many plain Dijkstra settles for the same pair of cities.
+ */
  
-/* ---------------------------- CODE RELATED TO KRUSKAL'S ALGORITHM ----------------------- */
  
+void bidirectional(MapGraph & graph) {
+    beginRoute(graph, BIDIRECTIONAL_SEARCH, "Bidirectional search");
+}
  
-  
  
-/* Function: oneCityInBucketButNotOther
- * Usage: if (oneCityInBucketButNotOther(i, visitedLocations, startName, finishName))
- * -----------------------------------------------
- * As the cities on the endpoints of the arc are added in sets stored in a vector,
- * this function checks to see if those cities have been previously added
- * but stored in separate sets.
- */
-  
- bool oneCityInBucketButNotOther(int i, Vector<Set<string> > & visitedLocations, string startName, string finishName) {
-  
-     if ((visitedLocations[i].contains(startName) &&
-     !visitedLocations[i].contains(finishName)) ||
-     (!visitedLocations[i].contains(startName) &&
-     visitedLocations[i].contains(finishName))) {
-         return true;
-     }
-     else {
-         return false;
-     }
- }
-  
-  
-/* Function: addNewCitySet
- * Usage: addNewCitySet(startName, finishName, visitedLocations);
- * -------------------------------------------------
- * If a pair of cities has not been added to the path,
- * this function creates a new set, adds the names of the cities
- * to that set, and then adds the set to the path.
- */
+/* ---------------------------- CODE RELATED TO KRUSKAL'S ALGORITHM ----------------------- */
  
- void addNewCitySet(string startName, string finishName, Vector<Set<string> > & visitedLocations){
-  
-    Set<string> newCitySet;
-    newCitySet.add(startName);
-    newCitySet.add(finishName);
-    visitedLocations.add(newCitySet);
- }
-  
-  
  
-/* Function: checkEachBucketOfCities
- * Usage: if (checkEachBucketOfCities(currentArc, visitedLocations, numBucketsEndpoints, startName, finishName, path))
- * -----------------------------------------------------
- * This function goes through each set of cities in the vector
- * and checks two cases:
- *
- *      1) Both cities are in the same set. This means that
- *          they're both on the same path, and nothing needs
- *          to be done.
- *
- *      2) They are in different sets/buckets. In this case,
- *          the two buckets are merged, the arc is added
- *          to the path, and the second bucket is deleted.
- *          This is the same as cities in different paths
- *          now being joined together on the same path.
- */
   
-bool checkEachBucketOfCities(Arc* currentArc, Vector<Set<string> > & visitedLocations, Vector<int> & numBucketsEndpoints, string startName, string finishName, Path & path) {
- 
-    for (int i=0; i<visitedLocations.size(); i++) {
-        if (visitedLocations[i].contains(startName) &&
-            visitedLocations[i].contains(finishName)) {
-            return true;
-        }
-        if (oneCityInBucketButNotOther(i, visitedLocations, startName, finishName)){
-            numBucketsEndpoints.add(i);
-             
-            if (numBucketsEndpoints.size()==2) {
-                visitedLocations[numBucketsEndpoints[0]] += visitedLocations[numBucketsEndpoints[1]];
-                visitedLocations.removeAt(numBucketsEndpoints[1]);
-                path.add(currentArc);
-                return true;
-            }
-        }
-    }
-    return false;
-}
  
-/* Function: atLeastOneNewCity
- * Usage: if (atLeastOneNewCity(currentArc, visitedLocations, numBucketsEndpoints, startName, finishName, path))
- * ---------------------------------------
- * In the case where one of the two cities in the new arc
- * is already in the path, the second city is added to
- * the same set. In the case where neither are part of the
- * path, we call addNewCitySet to add the new path to the graph.
- */
-  
- bool atLeastOneNewCity(Arc* currentArc,Vector<Set<string> > & visitedLocations, Vector<int> & numBucketsEndpoints, string startName, string finishName,Path & path) {
-  
-     if (numBucketsEndpoints.size()==1) {
-         visitedLocations[numBucketsEndpoints[0]].add(startName);
-         visitedLocations[numBucketsEndpoints[0]].add(finishName);
-         path.add(currentArc);
-         return true;
-     }
-     if (numBucketsEndpoints.isEmpty()) {
-         addNewCitySet(startName, finishName, visitedLocations);
-         path.add(currentArc);
-         return true;
-     }          
-     return false;
- }
-  
-  
-/* Function: findBucketWithCities
- * Usage: findBucketWithCities(currentArc, visitedLocations, startName, finishName, path);
- * -------------------------------------------
- * This function identifies the location of the set in the vector
- * of Set<Arc*> that contains the cities in the arc being considered.
- * This information is then stored in a vector. This is key, because it
- * has two advantages: First, the vector size shows how many of the cities
- * are new - not currently part of the path. Second, the elements themselves
- * are references to locations, which allow direct modification of the sets
- * at a later time as needed.
+/* Function: kruskal
+ * Usage: addButton("Kruskal", kruskal, graph);
+ * ------------------------------------------
+ * This is the function called when the user clicks the Kruskal
+ * button. It runs kruskalSpanningTree (see spanningtree.h) on the
+ * worker, which merges components with a union-find structure
+ * instead of copying sets of city names, and posts each arc as it
+ * joins the minimum spanning tree (MST) so that the event loop can
+ * highlight the tree as it grows. Kruskal's algorithm is used here
+ * rather than findMinimumSpanningTree because it accepts its arcs
+ * one at a time. Only roads whose color changes are redrawn.
  */
- 
- 
- void findBucketWithCities(Arc* currentArc, Vector<Set<string> > & visitedLocations, string startName, string finishName, Path & path) {
-     Vector<int> numBucketsEndpoints;
-     if (checkEachBucketOfCities(currentArc, visitedLocations, numBucketsEndpoints, startName, finishName, path)){
-         return;
-     }
-     if (atLeastOneNewCity(currentArc, visitedLocations, numBucketsEndpoints, startName, finishName, path)) {
+
+void kruskal(MapGraph & graph) {
+    if (graph.isEmpty()) {
+        cout<<"Please select a map!"<<endl;
         return;
-     }
- }
-  
- 
-/* Function: processInOrderOfCost
- * Usage: processInOrderOfCost(mainQueue, path);
- * --------------------------------------------
- * This function dequeues the priority queue that stores
- * all the Arc*, and since it's a priority queue, it dequeues
- * them in order of increasing cost. After extracting the names
- * of the cities it connects, it calls findBucketWithCities to
- * figure out if the arc is a new path, creates a cycle, or adds
- * to an existing path.
+    }
+    setAllArcColors(DIM_COLOR);
+    flushRenderLayer();
+    activity = SPANNING;
+    worker.start([]() {
+        spanningTree = kruskalSpanningTree(getGraphSnapshot(), [](Arc* arc) {
+            treeProgress.post(arc);
+            return !worker.isCancelled();
+        });
+        treeProgress.publish();
+    });
+}
+
+
+/* Function: finishSpanningTree
+ * Usage: finishSpanningTree();
+ * ------------------------------------------
+ * This function highlights every arc of the finished tree,
+ * including those the event loop has not shown yet.
  */
-  
- void processInOrderOfCost(PriorityQueue<Arc*> & mainQueue, Path & path){
-     Vector<Set<string> > visitedLocations;
-     while (!mainQueue.isEmpty()) {
-         Arc* currentArc = mainQueue.dequeue();
-         string startName = currentArc->start->name;
-         string finishName = currentArc->finish->name;
-         findBucketWithCities(currentArc, visitedLocations, startName, finishName, path);
-     }
-  }
-  
- /* Function: kruskal
-  * Usage: addButton("Kruskal", kruskal, graph);
-  * ------------------------------------------
-  * This is the function called when the user clicks the Kruskal
-  * button, and it implements Kruskal's algorithm for finding 
-  * minimum spanning trees (MST). Once the MST is found, the function
-  * iterates through the arcs that make up the MST and highlights them.
-  */
- 
-  
- void kruskal(PathfinderGraph & graph) {
-     if (graph.isEmpty()) {
-         cout<<"Please select a map!"<<endl;
-         return;
-     }
-     Path path;
-     Set<Arc*> allArcs = graph.getArcSet();
-     recolorAllArcs(graph, DIM_COLOR);
-     PriorityQueue<Arc*> mainQueue;
-     foreach (Arc* arc in allArcs) {
-         mainQueue.enqueue(arc, arc->cost);
-     }
-     processInOrderOfCost(mainQueue, path);
-     Vector<Arc*> pathArcs = path.allArcs();
-     foreach (Arc* arc in pathArcs) {
-         highlightArc(arc);
-     }
- }
- 
- 
+
+void finishSpanningTree() {
+    treeProgress.clear();
+    Vector<Arc*> pathArcs = spanningTree.allArcs();
+    foreach (Arc* arc in pathArcs) {
+        highlightArc(arc);
+    }
+    flushRenderLayer();
+}
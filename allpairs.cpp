@@ -0,0 +1,239 @@
+/*
+ * File: allpairs.cpp
+ * ------------------
+ * This file implements the AllPairsTable class. For each tile k of
+ * the diagonal, the build relaxes through the nodes of k first the
+ * diagonal tile itself, then the other tiles of its row and column,
+ * which depend only on the diagonal tile, and then every remaining
+ * tile, which depends only on the row and column. The tiles of the
+ * last two phases are independent of each other and are spread over
+ * the shared ThreadPool.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include "allpairs.h"
+#include "instrumentation.h"
+#include "threadpool.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ALL_PAIRS_AVX2 1
+#endif
+using namespace std;
+
+/* CONSTANTS */
+const int TILE_SIZE = 64;
+const int NO_ARC = -1;
+
+
+/* Function: relaxRowScalar
+ * Usage: relaxRowScalar(row, next, rowK, costToK, arcToK, count);
+ * ---------------------------------------------------------------
+ * Lowers each of the count costs in row to costToK plus the matching
+ * cost in rowK where that is cheaper, setting the next hop to arcToK.
+ */
+
+static void relaxRowScalar(double *row, int *next, const double *rowK, double costToK, int arcToK, int count) {
+    for (int j = 0; j < count; j++) {
+        double candidate = costToK + rowK[j];
+        if (candidate < row[j]) {
+            row[j] = candidate;
+            next[j] = arcToK;
+        }
+    }
+}
+
+#ifdef ALL_PAIRS_AVX2
+
+/* Function: relaxRowVector
+ * Usage: relaxRowVector(row, next, rowK, costToK, arcToK, count);
+ * ---------------------------------------------------------------
+ * Does the work of relaxRowScalar four costs at a time. The mask of
+ * the four comparisons is narrowed from 64-bit to 32-bit lanes to
+ * blend the next hops.
+ */
+
+__attribute__((target("avx2")))
+static void relaxRowVector(double *row, int *next, const double *rowK, double costToK, int arcToK, int count) {
+    __m256d base = _mm256_set1_pd(costToK);
+    __m128i hop = _mm_set1_epi32(arcToK);
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m256d candidate = _mm256_add_pd(base, _mm256_loadu_pd(rowK + j));
+        __m256d current = _mm256_loadu_pd(row + j);
+        __m256d lower = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+        _mm256_storeu_pd(row + j, _mm256_blendv_pd(current, candidate, lower));
+        __m256 lanes = _mm256_castpd_ps(lower);
+        __m128 narrow = _mm_shuffle_ps(_mm256_castps256_ps128(lanes), _mm256_extractf128_ps(lanes, 1),
+                                       _MM_SHUFFLE(2, 0, 2, 0));
+        __m128i hops = _mm_loadu_si128((const __m128i *) (next + j));
+        hops = _mm_blendv_epi8(hops, hop, _mm_castps_si128(narrow));
+        _mm_storeu_si128((__m128i *) (next + j), hops);
+    }
+    relaxRowScalar(row + j, next + j, rowK + j, costToK, arcToK, count - j);
+}
+
+#endif
+
+AllPairsTable::AllPairsTable() {
+    nodeLimit = DEFAULT_ALL_PAIRS_LIMIT;
+    clear();
+}
+
+void AllPairsTable::clear() {
+    nodeCount = 0;
+    stride = 0;
+    vector<double>().swap(distance);
+    vector<int>().swap(nextArc);
+    vector<int>().swap(arcTarget);
+    snapshotVersion = -1;
+    snapshotCostVersion = -1;
+    stats = AllPairsStats();
+    stats.nodeLimit = nodeLimit;
+}
+
+void AllPairsTable::setNodeLimit(int limit) {
+    nodeLimit = limit;
+}
+
+int AllPairsTable::getNodeLimit() const {
+    return nodeLimit;
+}
+
+bool AllPairsTable::isVectorSupported() {
+#ifdef ALL_PAIRS_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+/* Method: build
+ * -------------
+ * Rows are padded to a whole number of tiles so that every tile
+ * starts at the same offset within its rows. Padding entries stay
+ * infinite, and the loops stop at nodeCount, so they cost nothing.
+ */
+
+bool AllPairsTable::build(const GraphSnapshot & snapshot, bool vectorize) {
+    PhaseTimer timer("all pairs");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    clear();
+    stats.nodeCount = snapshot.nodeCount();
+    if (stats.nodeCount > nodeLimit) {
+        stats.refused = true;
+        return false;
+    }
+    nodeCount = stats.nodeCount;
+    stride = (nodeCount + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    size_t cells = (size_t) stride * stride;
+    distance.assign(cells, INFINITE_DISTANCE);
+    nextArc.assign(cells, NO_ARC);
+    arcTarget = snapshot.arcTarget;
+    for (int u = 0; u < nodeCount; u++) {
+        distance[(size_t) u * stride + u] = 0;
+        for (int arc = snapshot.arcOffset[u]; arc < snapshot.arcOffset[u + 1]; arc++) {
+            size_t cell = (size_t) u * stride + snapshot.arcTarget[arc];
+            if (snapshot.arcCost[arc] < distance[cell]) {
+                distance[cell] = snapshot.arcCost[arc];
+                nextArc[cell] = arc;
+            }
+        }
+    }
+    vectorize = vectorize && isVectorSupported();
+    int tiles = stride / TILE_SIZE;
+    ThreadPool & pool = getSharedThreadPool();
+    for (int k = 0; k < tiles; k++) {
+        relaxTile(k, k, k, vectorize);
+        pool.parallelFor(tiles, [&](int other, int) {
+            if (other == k) return;
+            relaxTile(k, k, other, vectorize);
+            relaxTile(k, other, k, vectorize);
+        });
+        pool.parallelFor(tiles, [&](int i, int) {
+            if (i == k) return;
+            for (int j = 0; j < tiles; j++) {
+                if (j != k) relaxTile(k, i, j, vectorize);
+            }
+        });
+    }
+    snapshotVersion = snapshot.version;
+    snapshotCostVersion = snapshot.costVersion;
+    stats.vectorized = vectorize;
+    stats.matrixBytes = cells * (sizeof(double) + sizeof(int));
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    stats.buildSeconds = elapsed.count();
+    timer.setArg("nodes", nodeCount);
+    timer.setArg("bytes", stats.matrixBytes);
+    return true;
+}
+
+/* Method: relaxTile
+ * Usage: relaxTile(kTile, iTile, jTile, vectorize);
+ * -------------------------------------------------
+ * Relaxes every pair of the tile (iTile, jTile) through each node of
+ * kTile in turn. A source that cannot reach the node is skipped.
+ */
+
+void AllPairsTable::relaxTile(int kTile, int iTile, int jTile, bool vectorize) {
+    int kEnd = min(nodeCount, (kTile + 1) * TILE_SIZE);
+    int iEnd = min(nodeCount, (iTile + 1) * TILE_SIZE);
+    int jStart = jTile * TILE_SIZE;
+    int count = min(nodeCount, jStart + TILE_SIZE) - jStart;
+    if (count <= 0) return;
+    for (int k = kTile * TILE_SIZE; k < kEnd; k++) {
+        const double *rowK = &distance[(size_t) k * stride + jStart];
+        for (int i = iTile * TILE_SIZE; i < iEnd; i++) {
+            size_t toK = (size_t) i * stride + k;
+            if (distance[toK] == INFINITE_DISTANCE) continue;
+            size_t first = (size_t) i * stride + jStart;
+#ifdef ALL_PAIRS_AVX2
+            if (vectorize) {
+                relaxRowVector(&distance[first], &nextArc[first], rowK, distance[toK], nextArc[toK], count);
+                continue;
+            }
+#endif
+            relaxRowScalar(&distance[first], &nextArc[first], rowK, distance[toK], nextArc[toK], count);
+        }
+    }
+}
+
+bool AllPairsTable::isBuiltFor(const GraphSnapshot & snapshot) const {
+    return snapshotVersion == snapshot.version && snapshotCostVersion == snapshot.costVersion;
+}
+
+double AllPairsTable::getDistance(int source, int target) const {
+    return distance[(size_t) source * stride + target];
+}
+
+/* Method: findPath
+ * ----------------
+ * Each hop leads to a node no farther from target than the cost left,
+ * so with positive costs the walk ends within nodeCount steps. Only
+ * zero-cost arcs can keep it from getting closer, and the bound stops
+ * it going round them forever.
+ */
+
+bool AllPairsTable::findPath(int source, int target, vector<int> & arcs) const {
+    arcs.clear();
+    if (getDistance(source, target) == INFINITE_DISTANCE) return false;
+    for (int node = source; node != target; ) {
+        if ((int) arcs.size() >= nodeCount) {
+            arcs.clear();
+            return false;
+        }
+        int arc = nextArc[(size_t) node * stride + target];
+        arcs.push_back(arc);
+        node = arcTarget[arc];
+    }
+    return true;
+}
+
+AllPairsStats AllPairsTable::getStats() const {
+    return stats;
+}
+
+AllPairsTable & getAllPairsTable() {
+    static AllPairsTable table;
+    return table;
+}
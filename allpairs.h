@@ -0,0 +1,168 @@
+/*
+ * File: allpairs.h
+ * ----------------
+ * This file exports the AllPairsTable class, which precomputes the
+ * shortest-path cost between every pair of cities on a small or
+ * medium map so that a query becomes a walk along its answer instead
+ * of a search. Besides the dense distance matrix the table keeps a
+ * next-hop matrix holding, for each pair, the first snapshot arc of
+ * a shortest path between them.
+ *
+ * The matrices are filled by Floyd-Warshall's algorithm, tiled so
+ * that each step works on three square blocks that fit in the cache
+ * together. Its inner loop is a min-plus update of one row, which
+ * runs four costs at a time with AVX2 where the processor has it and
+ * one at a time otherwise. The matrices take 12 bytes per pair, so a
+ * build is refused for maps with more nodes than a configurable
+ * limit, and queries then fall back to Dijkstra's algorithm.
+ */
+
+#ifndef _allpairs_h
+#define _allpairs_h
+
+#include <vector>
+#include "graphsnapshot.h"
+
+/* CONSTANTS */
+const int DEFAULT_ALL_PAIRS_LIMIT = 2048;
+
+/* Type: AllPairsStats
+ * -------------------
+ * Describes the last build: the map's node count and the limit it
+ * was checked against, whether the build was refused, whether the
+ * AVX2 kernel was used, the bytes the two matrices take and the time
+ * the build took.
+ */
+
+struct AllPairsStats {
+    int nodeCount;
+    int nodeLimit;
+    bool refused;
+    bool vectorized;
+    long long matrixBytes;
+    double buildSeconds;
+};
+
+class AllPairsTable {
+
+public:
+
+/* Constructor: AllPairsTable
+ * Usage: AllPairsTable table;
+ * ---------------------------
+ * Creates an empty table that matches no snapshot, with the node
+ * limit DEFAULT_ALL_PAIRS_LIMIT.
+ */
+
+    AllPairsTable();
+
+/* Method: build
+ * Usage: if (table.build(snapshot)) ...
+ *        if (table.build(snapshot, vectorize)) ...
+ * -----------------------------------------------
+ * Computes every distance and next hop of snapshot. If vectorize is
+ * false, or the processor lacks AVX2, the scalar kernel is used.
+ * Returns false, leaving the table empty, if snapshot has more nodes
+ * than the node limit.
+ */
+
+    bool build(const GraphSnapshot & snapshot, bool vectorize = true);
+
+/* Method: clear
+ * Usage: table.clear();
+ * ---------------------
+ * Discards the matrices.
+ */
+
+    void clear();
+
+/* Method: setNodeLimit
+ * Usage: table.setNodeLimit(limit);
+ * ---------------------------------
+ * Sets the largest node count that later builds accept.
+ */
+
+    void setNodeLimit(int limit);
+
+/* Method: getNodeLimit
+ * Usage: int limit = table.getNodeLimit();
+ * ----------------------------------------
+ * Returns the largest node count that builds accept.
+ */
+
+    int getNodeLimit() const;
+
+/* Method: isBuiltFor
+ * Usage: if (table.isBuiltFor(snapshot)) ...
+ * ------------------------------------------
+ * Returns true if the table was built from this version of the
+ * snapshot, and its costs have not been edited since.
+ */
+
+    bool isBuiltFor(const GraphSnapshot & snapshot) const;
+
+/* Method: getDistance
+ * Usage: double cost = table.getDistance(source, target);
+ * -------------------------------------------------------
+ * Returns the cost of a shortest path between two node IDs, or
+ * INFINITE_DISTANCE if target cannot be reached.
+ */
+
+    double getDistance(int source, int target) const;
+
+/* Method: findPath
+ * Usage: if (table.findPath(source, target, arcs)) ...
+ * ----------------------------------------------------
+ * Follows the next-hop matrix from source to target, storing the
+ * snapshot arc indices of a shortest path in arcs. Takes time
+ * proportional to the length of the path. Returns false if target
+ * cannot be reached, or if the walk goes round a cycle of zero-cost
+ * arcs, which equally short routes through such a cycle can cause;
+ * getDistance tells the two apart.
+ */
+
+    bool findPath(int source, int target, std::vector<int> & arcs) const;
+
+/* Method: getStats
+ * Usage: AllPairsStats stats = table.getStats();
+ * ----------------------------------------------
+ * Returns the statistics of the last build.
+ */
+
+    AllPairsStats getStats() const;
+
+/* Method: isVectorSupported
+ * Usage: if (AllPairsTable::isVectorSupported()) ...
+ * --------------------------------------------------
+ * Returns true if this program was compiled with the AVX2 kernel and
+ * the processor can run it.
+ */
+
+    static bool isVectorSupported();
+
+private:
+
+    int nodeCount;
+    int stride;                         /* row length, padded to whole tiles */
+    std::vector<double> distance;
+    std::vector<int> nextArc;
+    std::vector<int> arcTarget;         /* copied from the snapshot */
+    int nodeLimit;
+    int snapshotVersion;
+    int snapshotCostVersion;
+    AllPairsStats stats;
+
+    void relaxTile(int kTile, int iTile, int jTile, bool vectorize);
+
+};
+
+/* Function: getAllPairsTable
+ * Usage: AllPairsTable & table = getAllPairsTable();
+ * --------------------------------------------------
+ * Returns the table shared by the program, which findShortestPath
+ * queries in ALL_PAIRS_SEARCH mode.
+ */
+
+AllPairsTable & getAllPairsTable();
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * File: backgroundworker.cpp
+ * --------------------------
+ * This file implements the BackgroundWorker class. Each job gets a
+ * fresh thread; the cost of creating one is small next to the
+ * searches and spanning trees that run as jobs.
+ */
+
+#include "backgroundworker.h"
+using namespace std;
+
+BackgroundWorker::BackgroundWorker() {
+    cancelled = false;
+    done = false;
+    busy = false;
+}
+
+BackgroundWorker::~BackgroundWorker() {
+    cancel();
+}
+
+void BackgroundWorker::start(function<void()> job) {
+    cancel();
+    cancelled = false;
+    done = false;
+    busy = true;
+    thread = std::thread([this, job]() {
+        job();
+        done = true;
+    });
+}
+
+void BackgroundWorker::cancel() {
+    cancelled = true;
+    finish();
+}
+
+bool BackgroundWorker::isCancelled() const {
+    return cancelled;
+}
+
+bool BackgroundWorker::isBusy() const {
+    return busy;
+}
+
+bool BackgroundWorker::isDone() const {
+    return busy && done;
+}
+
+void BackgroundWorker::finish() {
+    if (thread.joinable()) thread.join();
+    busy = false;
+}
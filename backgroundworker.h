@@ -0,0 +1,202 @@
+/*
+ * File: backgroundworker.h
+ * ------------------------
+ * This file exports the BackgroundWorker and ProgressQueue classes,
+ * which let the interactive program run a long search or spanning
+ * tree on another thread while its event loop keeps answering the
+ * buttons. A job polls isCancelled and returns early once it is set.
+ * It hands its partial results back through a ProgressQueue, which
+ * the event loop drains at its own pace.
+ *
+ * Only the event loop's thread draws, edits the graph or calls the
+ * shortest-path engine outside a job. It cancels the running job
+ * before doing any of these, so a job can use the shared snapshot
+ * and the engine's search arrays without locks.
+ */
+
+#ifndef _backgroundworker_h
+#define _backgroundworker_h
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* CONSTANTS */
+const int PROGRESS_BATCH = 256;
+
+class BackgroundWorker {
+
+public:
+
+/* Constructor: BackgroundWorker
+ * Usage: BackgroundWorker worker;
+ * -------------------------------
+ * Creates a worker with no job.
+ */
+
+    BackgroundWorker();
+
+/* Destructor: ~BackgroundWorker
+ * -----------------------------
+ * Cancels the running job, if any, and waits for it.
+ */
+
+    ~BackgroundWorker();
+
+/* Method: start
+ * Usage: worker.start(job);
+ * -------------------------
+ * Cancels any job still running and then runs job on a new thread.
+ */
+
+    void start(std::function<void()> job);
+
+/* Method: cancel
+ * Usage: worker.cancel();
+ * -----------------------
+ * Asks the running job to stop and waits until it has returned.
+ * Does nothing if there is no job.
+ */
+
+    void cancel();
+
+/* Method: isCancelled
+ * Usage: if (worker.isCancelled()) return;
+ * ----------------------------------------
+ * Returns true once the current job has been asked to stop. Jobs
+ * call this from their own thread.
+ */
+
+    bool isCancelled() const;
+
+/* Method: isBusy
+ * Usage: if (worker.isBusy()) ...
+ * -------------------------------
+ * Returns true from start until the job has been cancelled or
+ * collected by finish.
+ */
+
+    bool isBusy() const;
+
+/* Method: isDone
+ * Usage: if (worker.isDone()) ...
+ * -------------------------------
+ * Returns true if a job has been started and has returned, so that
+ * finish will not wait.
+ */
+
+    bool isDone() const;
+
+/* Method: finish
+ * Usage: worker.finish();
+ * -----------------------
+ * Waits for the job to return and makes the worker idle again. The
+ * job's results can then be read without synchronization.
+ */
+
+    void finish();
+
+private:
+
+    std::thread thread;
+    std::atomic<bool> cancelled;
+    std::atomic<bool> done;
+    bool busy;
+
+    BackgroundWorker(const BackgroundWorker &);
+    BackgroundWorker & operator=(const BackgroundWorker &);
+
+};
+
+/*
+ * Class: ProgressQueue<ValueType>
+ * -------------------------------
+ * Carries partial results from a job to the event loop. The job's
+ * values collect in a private batch and are handed over under the
+ * lock every PROGRESS_BATCH values, so posting costs no more than a
+ * push_back most of the time.
+ */
+
+template <typename ValueType>
+class ProgressQueue {
+
+public:
+
+/* Method: post
+ * Usage: queue.post(value);
+ * -------------------------
+ * Adds value to the job's batch, handing the batch over when it is
+ * full. Called from the job's thread.
+ */
+
+    void post(const ValueType & value);
+
+/* Method: publish
+ * Usage: queue.publish();
+ * -----------------------
+ * Hands over the job's batch now. Jobs call this before returning.
+ */
+
+    void publish();
+
+/* Method: take
+ * Usage: int count = queue.take(values, limit);
+ * ---------------------------------------------
+ * Moves up to limit of the oldest handed-over values to the end of
+ * values and returns how many were moved. Called from the event
+ * loop's thread.
+ */
+
+    int take(std::vector<ValueType> & values, int limit);
+
+/* Method: clear
+ * Usage: queue.clear();
+ * ---------------------
+ * Drops every value. Only call this while no job is posting.
+ */
+
+    void clear();
+
+private:
+
+    std::mutex lock;
+    std::vector<ValueType> batch;
+    std::deque<ValueType> ready;
+
+};
+
+template <typename ValueType>
+void ProgressQueue<ValueType>::post(const ValueType & value) {
+    batch.push_back(value);
+    if (batch.size() >= (size_t) PROGRESS_BATCH) publish();
+}
+
+template <typename ValueType>
+void ProgressQueue<ValueType>::publish() {
+    if (batch.empty()) return;
+    std::lock_guard<std::mutex> guard(lock);
+    ready.insert(ready.end(), batch.begin(), batch.end());
+    batch.clear();
+}
+
+template <typename ValueType>
+int ProgressQueue<ValueType>::take(std::vector<ValueType> & values, int limit) {
+    std::lock_guard<std::mutex> guard(lock);
+    int count = std::min((size_t) limit, ready.size());
+    values.insert(values.end(), ready.begin(), ready.begin() + count);
+    ready.erase(ready.begin(), ready.begin() + count);
+    return count;
+}
+
+template <typename ValueType>
+void ProgressQueue<ValueType>::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    batch.clear();
+    ready.clear();
+}
+
+#endif
@@ -0,0 +1,1010 @@
+/*
+ * File: batchmode.cpp
+ * -------------------
+ * This file implements the headless batch mode. Nothing here calls
+ * the gpathfinder drawing functions; the map is read with loadMap
+ * and all queries run against the GraphSnapshot.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include "batchmode.h"
+#include "contraction.h"
+#include "allpairs.h"
+#include "deltastepping.h"
+#include "distancematrix.h"
+#include "dynamicshortestpaths.h"
+#include "dynamicspanningtree.h"
+#include "graphsnapshot.h"
+#include "instrumentation.h"
+#include "jsonlines.h"
+#include "mapsnapshot.h"
+#include "shortestpath.h"
+#include "spanningtree.h"
+#include "spatialindex.h"
+#include "vector.h"
+using namespace std;
+
+/* CONSTANTS */
+const int COST_PRECISION = 12;
+const string MST_REQUEST = "MST";
+const string MATRIX_REQUEST = "MATRIX";
+const string MATRIX_SEPARATOR = "TO";
+const string NEAREST_REQUEST = "NEAREST";
+const string VERIFY_REQUEST = "VERIFY";
+const int DEFAULT_VERIFY_PAIRS = 100;
+const unsigned VERIFY_SEED = 20240611;
+const double VERIFY_TOLERANCE = 1e-9;
+const string ROAD_REQUEST = "ROAD";
+const string ROAD_ADD = "ADD";
+const string ROAD_REMOVE = "REMOVE";
+const string ROAD_COST = "COST";
+const string TREE_VERIFY_REQUEST = "MSTVERIFY";
+const string ISOCHRONE_REQUEST = "ISOCHRONE";
+const int DEFAULT_TREE_VERIFY_UPDATES = 100;
+const string TRACK_REQUEST = "TRACK";
+const string PATH_VERIFY_REQUEST = "PATHVERIFY";
+const int PATH_VERIFY_TARGETS = 32;
+const string STATUS_OK = "ok";
+const string STATUS_UNREACHABLE = "unreachable";
+const string STATUS_UNKNOWN_CITY = "unknown city";
+const string STATUS_NO_CITY = "no city in range";
+const string STATUS_BAD_REQUEST = "bad request";
+const string STATUS_MISMATCH = "mismatch";
+const string STATUS_NO_ROAD = "no road";
+
+
+/* Type: BatchOptions
+ * ------------------
+ * The settings parsed from the command line.
+ */
+
+struct BatchOptions {
+    string mapName;
+    string queryName;
+    bool json;
+    SearchMode mode;
+    double costResolution;
+    NodeOrder nodeOrder;
+    int allPairsLimit;
+    string traceName;
+    bool chromeTrace;
+    string idsName;
+};
+
+
+/* Function: printBatchUsage
+ * Usage: printBatchUsage(programName);
+ * ------------------------------------
+ * Describes the command-line arguments on standard error.
+ */
+
+static void printBatchUsage(const string & programName) {
+    cerr<<"Usage: "<<programName<<" --map FILE [--queries FILE] [--format csv|json]"
+        <<" [--mode dijkstra|astar|hierarchy|bidirectional|integer|allpairs]"
+        <<" [--quantize auto|off|RESOLUTION] [--order graph|hilbert|bfs] [--all-pairs-limit N] [--trace FILE] [--trace-format lines|chrome]"
+        <<" [--dump-ids FILE]"<<endl;
+}
+
+/* Function: parsePositiveCount
+ * Usage: if (parsePositiveCount(value, count)) ...
+ * ------------------------------------------------
+ * Reads value as a whole number of at least 1. Returns false if it is
+ * not made of digits alone or is too large for an int.
+ */
+
+static bool parsePositiveCount(const string & value, int & count) {
+    if (value.empty() || value.find_first_not_of("0123456789") != string::npos) return false;
+    errno = 0;
+    char *end;
+    long number = strtol(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || number < 1 || number > INT_MAX) return false;
+    count = (int) number;
+    return true;
+}
+
+/* Function: parseResolution
+ * Usage: if (parseResolution(value, resolution)) ...
+ * --------------------------------------------------
+ * Reads value as a positive decimal cost resolution such as 0.01.
+ * Returns false if it holds anything but digits and one point, or is
+ * not a finite number above 0.
+ */
+
+static bool parseResolution(const string & value, double & resolution) {
+    if (value.empty() || value.find_first_not_of("0123456789.") != string::npos) return false;
+    if (value.find('.') != value.rfind('.')) return false;
+    errno = 0;
+    char *end;
+    double number = strtod(value.c_str(), &end);
+    if (errno != 0 || *end != '\0' || !isfinite(number) || number <= 0) return false;
+    resolution = number;
+    return true;
+}
+
+/* Function: parseBatchOptions
+ * Usage: if (parseBatchOptions(argc, argv, options)) ...
+ * ------------------------------------------------------
+ * Fills options from the command line. Returns false, after saying
+ * why on standard error, if the arguments are not valid. Integer
+ * mode quantizes automatically unless --quantize says otherwise.
+ */
+
+static bool parseBatchOptions(int argc, char *argv[], BatchOptions & options) {
+    options.queryName = "-";
+    options.json = false;
+    options.mode = DIJKSTRA_SEARCH;
+    options.chromeTrace = false;
+    bool quantizeGiven = false;
+    options.costResolution = NO_COST_RESOLUTION;
+    options.nodeOrder = DEFAULT_NODE_ORDER;
+    options.allPairsLimit = DEFAULT_ALL_PAIRS_LIMIT;
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (i + 1 >= argc) {
+            cerr<<"Missing value for "<<flag<<endl;
+            return false;
+        }
+        string value = argv[++i];
+        if (flag == "--map") {
+            options.mapName = value;
+        } else if (flag == "--queries") {
+            options.queryName = value;
+        } else if (flag == "--format" && (value == "csv" || value == "json")) {
+            options.json = (value == "json");
+        } else if (flag == "--mode" && value == "dijkstra") {
+            options.mode = DIJKSTRA_SEARCH;
+        } else if (flag == "--mode" && value == "astar") {
+            options.mode = ASTAR_SEARCH;
+        } else if (flag == "--mode" && value == "hierarchy") {
+            options.mode = HIERARCHY_SEARCH;
+        } else if (flag == "--mode" && value == "bidirectional") {
+            options.mode = BIDIRECTIONAL_SEARCH;
+        } else if (flag == "--mode" && value == "integer") {
+            options.mode = INTEGER_SEARCH;
+        } else if (flag == "--mode" && value == "allpairs") {
+            options.mode = ALL_PAIRS_SEARCH;
+        } else if (flag == "--all-pairs-limit" && parsePositiveCount(value, options.allPairsLimit)) {
+            continue;
+        } else if (flag == "--quantize" && value == "auto") {
+            options.costResolution = AUTO_COST_RESOLUTION;
+            quantizeGiven = true;
+        } else if (flag == "--quantize" && value == "off") {
+            options.costResolution = NO_COST_RESOLUTION;
+            quantizeGiven = true;
+        } else if (flag == "--quantize" && parseResolution(value, options.costResolution)) {
+            quantizeGiven = true;
+        } else if (flag == "--order" && value != "" && parseNodeOrder(value, options.nodeOrder)) {
+            continue;
+        } else if (flag == "--trace") {
+            options.traceName = value;
+        } else if (flag == "--trace-format" && (value == "lines" || value == "chrome")) {
+            options.chromeTrace = (value == "chrome");
+        } else if (flag == "--dump-ids" && !value.empty()) {
+            options.idsName = value;
+        } else {
+            cerr<<"Unrecognized argument: "<<flag<<" "<<value<<endl;
+            return false;
+        }
+    }
+    if (options.mapName.empty()) {
+        cerr<<"No map given."<<endl;
+        return false;
+    }
+    if (options.mode == INTEGER_SEARCH && !quantizeGiven) options.costResolution = AUTO_COST_RESOLUTION;
+    return true;
+}
+
+/* Function: csvField
+ * Usage: out << csvField(text);
+ * -----------------------------
+ * Returns text, quoted if it contains a comma, quote or newline.
+ */
+
+static string csvField(const string & text) {
+    if (text.find_first_of(",\"\n") == string::npos) return text;
+    string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '"') quoted += '"';
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+/* Function: writeRoute
+ * Usage: writeRoute(out, options, start, finish, status, path);
+ * -------------------------------------------------------------
+ * Writes one route result. The path is listed as the cities it
+ * visits, from start to finish; a route from a city to itself
+ * visits just that city.
+ */
+
+static void writeRoute(ostream & out, const BatchOptions & options, const string & start,
+                       const string & finish, const string & status, const Path & path) {
+    Vector<string> cities;
+    if (status == STATUS_OK) cities.add(start);
+    for (int i = 0; i < path.size(); i++) {
+        cities.add(path.getArc(i)->finish->name);
+    }
+    if (options.json) {
+        out<<"{\"type\":\"route\",\"start\":"<<jsonString(start)<<",\"finish\":"<<jsonString(finish)
+           <<",\"status\":"<<jsonString(status);
+        if (status == STATUS_OK) {
+            out<<",\"cost\":"<<path.totalCost()<<",\"path\":[";
+            for (int i = 0; i < cities.size(); i++) {
+                if (i > 0) out<<",";
+                out<<jsonString(cities[i]);
+            }
+            out<<"]";
+        }
+        out<<"}"<<'\n';
+    } else {
+        out<<"route,"<<csvField(start)<<","<<csvField(finish)<<","<<csvField(status)<<",";
+        if (status == STATUS_OK) out<<path.totalCost();
+        out<<",";
+        string joined;
+        for (int i = 0; i < cities.size(); i++) {
+            if (i > 0) joined += ";";
+            joined += cities[i];
+        }
+        out<<csvField(joined)<<'\n';
+    }
+}
+
+/* Function: writeSpanningTree
+ * Usage: writeSpanningTree(out, options, tree);
+ * ---------------------------------------------
+ * Writes the minimum spanning tree as a list of city pairs.
+ */
+
+static void writeSpanningTree(ostream & out, const BatchOptions & options, const Path & tree) {
+    if (options.json) {
+        out<<"{\"type\":\"mst\",\"status\":\"ok\",\"cost\":"<<tree.totalCost()<<",\"edges\":[";
+        for (int i = 0; i < tree.size(); i++) {
+            if (i > 0) out<<",";
+            out<<"["<<jsonString(tree.getArc(i)->start->name)<<","<<jsonString(tree.getArc(i)->finish->name)<<"]";
+        }
+        out<<"]}"<<'\n';
+    } else {
+        string joined;
+        for (int i = 0; i < tree.size(); i++) {
+            if (i > 0) joined += ";";
+            joined += tree.getArc(i)->start->name + "-" + tree.getArc(i)->finish->name;
+        }
+        out<<"mst,,,ok,"<<tree.totalCost()<<","<<csvField(joined)<<'\n';
+    }
+}
+
+/* Function: answerMatrix
+ * Usage: answerMatrix(out, options, tokens);
+ * ------------------------------------------
+ * Reads "source ... TO target ..." from the rest of a MATRIX line,
+ * computes every cost with computeDistanceMatrix, and writes them as
+ * one JSON object or one CSV row per pair.
+ */
+
+static void answerMatrix(ostream & out, const BatchOptions & options, istream & tokens) {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    Vector<string> sourceNames, targetNames;
+    bool readingTargets = false;
+    string name;
+    while (tokens>>name) {
+        if (name == MATRIX_SEPARATOR) {
+            readingTargets = true;
+        } else if (readingTargets) {
+            targetNames.add(name);
+        } else {
+            sourceNames.add(name);
+        }
+    }
+    vector<int> sources, targets;
+    for (int i = 0; i < sourceNames.size(); i++) {
+        sources.push_back(snapshotNodeId(snapshot, sourceNames[i]));
+    }
+    for (int j = 0; j < targetNames.size(); j++) {
+        targets.push_back(snapshotNodeId(snapshot, targetNames[j]));
+    }
+    for (size_t k = 0; k < sources.size() + targets.size(); k++) {
+        int id = (k < sources.size()) ? sources[k] : targets[k - sources.size()];
+        if (id == NO_NODE) {
+            string unknown = (k < sources.size()) ? sourceNames[k] : targetNames[k - sources.size()];
+            if (options.json) {
+                out<<"{\"type\":\"matrix\",\"status\":"<<jsonString(STATUS_UNKNOWN_CITY)
+                   <<",\"city\":"<<jsonString(unknown)<<"}"<<'\n';
+            } else {
+                out<<"matrix,"<<csvField(unknown)<<",,"<<STATUS_UNKNOWN_CITY<<",,"<<'\n';
+            }
+            return;
+        }
+    }
+    vector<double> costs = computeDistanceMatrix(snapshot, sources, targets);
+    if (options.json) {
+        out<<"{\"type\":\"matrix\",\"status\":\"ok\",\"sources\":[";
+        for (int i = 0; i < sourceNames.size(); i++) {
+            out<<(i > 0 ? "," : "")<<jsonString(sourceNames[i]);
+        }
+        out<<"],\"targets\":[";
+        for (int j = 0; j < targetNames.size(); j++) {
+            out<<(j > 0 ? "," : "")<<jsonString(targetNames[j]);
+        }
+        out<<"],\"costs\":[";
+        for (size_t i = 0; i < sources.size(); i++) {
+            out<<(i > 0 ? ",[" : "[");
+            for (size_t j = 0; j < targets.size(); j++) {
+                double cost = costs[i * targets.size() + j];
+                out<<(j > 0 ? "," : "");
+                if (cost == INFINITE_DISTANCE) {
+                    out<<"null";
+                } else {
+                    out<<cost;
+                }
+            }
+            out<<"]";
+        }
+        out<<"]}"<<'\n';
+    } else {
+        for (size_t i = 0; i < sources.size(); i++) {
+            for (size_t j = 0; j < targets.size(); j++) {
+                double cost = costs[i * targets.size() + j];
+                out<<"matrix,"<<csvField(sourceNames[i])<<","<<csvField(targetNames[j])<<",";
+                if (cost == INFINITE_DISTANCE) {
+                    out<<STATUS_UNREACHABLE<<",";
+                } else {
+                    out<<STATUS_OK<<","<<cost;
+                }
+                out<<","<<'\n';
+            }
+        }
+    }
+}
+
+/* Function: answerNearest
+ * Usage: answerNearest(out, options, tokens);
+ * -------------------------------------------
+ * Reads "x y [range]" from the rest of a NEAREST line and writes the
+ * city closest to that point, with its distance from it.
+ */
+
+static void answerNearest(ostream & out, const BatchOptions & options, istream & tokens) {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    double x, y, range = UNLIMITED_RANGE;
+    string status = STATUS_OK;
+    int id = NO_NODE;
+    if (!(tokens>>x>>y)) {
+        status = STATUS_BAD_REQUEST;
+    } else {
+        if (!(tokens>>range)) range = UNLIMITED_RANGE;
+        id = getSpatialIndex().nearestNode(x, y, range);
+        if (id == NO_NODE) status = STATUS_NO_CITY;
+    }
+    double distance = 0;
+    if (id != NO_NODE) {
+        double dx = snapshot.xCoord[id] - x;
+        double dy = snapshot.yCoord[id] - y;
+        distance = sqrt(dx * dx + dy * dy);
+    }
+    if (options.json) {
+        out<<"{\"type\":\"nearest\",\"status\":"<<jsonString(status);
+        if (id != NO_NODE) {
+            out<<",\"city\":"<<jsonString(snapshot.names[id])<<",\"distance\":"<<distance;
+        }
+        out<<"}"<<'\n';
+    } else {
+        out<<"nearest,"<<(id != NO_NODE ? csvField(snapshot.names[id]) : "")<<",,"<<csvField(status)<<",";
+        if (id != NO_NODE) out<<distance;
+        out<<","<<'\n';
+    }
+}
+
+/* Function: sameCost
+ * Usage: if (sameCost(expected, path, reachable)) ...
+ * ---------------------------------------------------
+ * Returns true if path agrees with the reference search: both find
+ * no route, or both find one and their costs differ only by rounding.
+ */
+
+static bool sameCost(double expected, const Path & path, bool reachable) {
+    if (path.size() == 0) return !reachable;
+    if (!reachable) return false;
+    double cost = path.totalCost();
+    return fabs(cost - expected) <= VERIFY_TOLERANCE * max(1.0, fabs(expected));
+}
+
+/* Function: answerVerify
+ * Usage: answerVerify(out, options, tokens);
+ * ------------------------------------------
+ * Reads an optional pair count from the rest of a VERIFY line, runs
+ * Dijkstra between that many pseudo-random pairs of distinct cities,
+ * and checks A*, bidirectional search and, if it has been built, the
+ * contraction hierarchy and the all-pairs table against it, as well
+ * as the integer search if the costs were quantized exactly. The
+ * pairs depend only on the map, so a run can be repeated. The first
+ * disagreeing pair, if any, is reported in the start and finish
+ * fields; the cost field holds the number of pairs checked and the
+ * path field the number that failed.
+ */
+
+static void answerVerify(ostream & out, const BatchOptions & options, istream & tokens) {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    int pairCount;
+    if (!(tokens>>pairCount)) pairCount = DEFAULT_VERIFY_PAIRS;
+    int nodeCount = snapshot.nodeCount();
+    bool checkHierarchy = getContractionHierarchy().isBuiltFor(snapshot);
+    bool checkTable = getAllPairsTable().isBuiltFor(snapshot);
+    bool checkInteger = snapshot.exactUnits;
+    mt19937 random(VERIFY_SEED);
+    int checked = 0, mismatches = 0;
+    string firstStart, firstFinish;
+    for (int i = 0; i < pairCount && nodeCount > 1; i++) {
+        int source = random() % nodeCount;
+        int target = random() % nodeCount;
+        if (source == target) continue;
+        Node *start = snapshot.nodes[source];
+        Node *finish = snapshot.nodes[target];
+        Path reference = findShortestPath(start, finish, DIJKSTRA_SEARCH);
+        bool reachable = reference.size() > 0;
+        double expected = reachable ? reference.totalCost() : 0;
+        bool agrees = sameCost(expected, findShortestPath(start, finish, ASTAR_SEARCH), reachable)
+                   && sameCost(expected, findShortestPath(start, finish, BIDIRECTIONAL_SEARCH), reachable);
+        if (checkHierarchy) {
+            agrees = agrees && sameCost(expected, findShortestPath(start, finish, HIERARCHY_SEARCH), reachable);
+        }
+        if (checkTable) {
+            agrees = agrees && sameCost(expected, findShortestPath(start, finish, ALL_PAIRS_SEARCH), reachable);
+        }
+        if (checkInteger) {
+            agrees = agrees && sameCost(expected, findShortestPath(start, finish, INTEGER_SEARCH), reachable);
+        }
+        checked++;
+        if (!agrees && mismatches++ == 0) {
+            firstStart = snapshot.names[source];
+            firstFinish = snapshot.names[target];
+        }
+    }
+    string status = (mismatches == 0) ? STATUS_OK : STATUS_MISMATCH;
+    if (options.json) {
+        out<<"{\"type\":\"verify\",\"status\":"<<jsonString(status)<<",\"pairs\":"<<checked
+           <<",\"mismatches\":"<<mismatches;
+        if (mismatches > 0) {
+            out<<",\"start\":"<<jsonString(firstStart)<<",\"finish\":"<<jsonString(firstFinish);
+        }
+        out<<"}"<<'\n';
+    } else {
+        out<<"verify,"<<csvField(firstStart)<<","<<csvField(firstFinish)<<","<<csvField(status)<<","
+           <<checked<<","<<mismatches<<'\n';
+    }
+}
+
+/* Function: answerRoad
+ * Usage: if (answerRoad(out, options, graph, tokens, rebuildPending)) ...
+ * -----------------------------------------------------------------------
+ * Reads "ADD city city cost", "REMOVE city city" or "COST city city
+ * cost" from the rest of a ROAD line, applies it through the shared
+ * DynamicSpanningTree (building it for the map on first use) and
+ * writes the cost of the updated minimum spanning tree. A new cost
+ * is copied into the snapshot in place, repairing the tracked
+ * shortest-path trees, unless a rebuild is already pending. Returns
+ * true if the snapshot must be rebuilt.
+ */
+
+static bool answerRoad(ostream & out, const BatchOptions & options, MapGraph & graph, istream & tokens,
+                       bool rebuildPending) {
+    string action, one, two;
+    double cost = 0;
+    tokens>>action>>one>>two;
+    bool needsCost = (action == ROAD_ADD || action == ROAD_COST);
+    bool known = needsCost || action == ROAD_REMOVE;
+    DynamicSpanningTree & tree = getDynamicSpanningTree();
+    if (!tree.isBuilt()) tree.build(graph, getGraphSnapshot());
+    string status = STATUS_OK;
+    Node *start = NULL, *finish = NULL;
+    if (!known || two.empty() || (needsCost && !(tokens>>cost))) {
+        status = STATUS_BAD_REQUEST;
+    } else {
+        start = graph.getNode(one);
+        finish = graph.getNode(two);
+        if (start == NULL || finish == NULL) status = STATUS_UNKNOWN_CITY;
+    }
+    if (status == STATUS_OK) {
+        if (action == ROAD_ADD) {
+            if (tree.addRoad(start, finish, cost) == NULL) status = STATUS_BAD_REQUEST;
+        } else {
+            Arc *road = tree.findRoad(start, finish);
+            if (road == NULL) {
+                status = STATUS_NO_ROAD;
+            } else if (action == ROAD_REMOVE) {
+                tree.removeRoad(road);
+            } else {
+                tree.setRoadCost(road, cost);
+                if (!rebuildPending) updateSnapshotCosts(start, finish);
+            }
+        }
+    }
+    double treeCost = tree.getStats().treeCost;
+    if (options.json) {
+        out<<"{\"type\":\"road\",\"action\":"<<jsonString(action)<<",\"start\":"<<jsonString(one)
+           <<",\"finish\":"<<jsonString(two)<<",\"status\":"<<jsonString(status)
+           <<",\"treeCost\":"<<treeCost<<"}"<<'\n';
+    } else {
+        out<<"road,"<<csvField(one)<<","<<csvField(two)<<","<<csvField(status)<<","<<treeCost<<","
+           <<csvField(action)<<'\n';
+    }
+    return status == STATUS_OK && (action != ROAD_COST || rebuildPending);
+}
+
+/* Function: answerTreeVerify
+ * Usage: answerTreeVerify(out, options, graph, tokens);
+ * -----------------------------------------------------
+ * Reads an optional update count from the rest of an MSTVERIFY line
+ * and applies that many pseudo-random road additions, closures and
+ * cost changes to the map through the DynamicSpanningTree. After each
+ * one the snapshot is rebuilt and the tree is compared with a full
+ * run of findMinimumSpanningTree. The edits stay in the map. The cost
+ * field holds the number of edits the tree accepted and checked, and
+ * the path field the number whose trees disagreed; the time spent updating and rebuilding goes
+ * to standard error.
+ */
+
+static void answerTreeVerify(ostream & out, const BatchOptions & options, MapGraph & graph,
+                             istream & tokens) {
+    int updateCount;
+    if (!(tokens>>updateCount)) updateCount = DEFAULT_TREE_VERIFY_UPDATES;
+    DynamicSpanningTree & tree = getDynamicSpanningTree();
+    if (!tree.isBuilt()) tree.build(graph, getGraphSnapshot());
+    mt19937 random(VERIFY_SEED);
+    uniform_real_distribution<double> factor(0.5, 2.0);
+    Path reference = findMinimumSpanningTree(getGraphSnapshot());
+    double updateSeconds = 0, rebuildSeconds = 0;
+    int applied = 0, mismatches = 0;
+    for (int i = 0; i < updateCount; i++) {
+        const GraphSnapshot & snapshot = getGraphSnapshot();
+        if (snapshot.nodeCount() < 2) break;
+        int action = random() % 3;
+        Arc *road = NULL;
+        if (action != 0 && snapshot.arcCount() > 0) {
+            bool fromTree = reference.size() > 0 && random() % 2 == 0;
+            road = fromTree ? reference.getArc(random() % reference.size())
+                            : snapshot.arcs[random() % snapshot.arcCount()];
+        }
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool changed;
+        if (road == NULL) {
+            int one = random() % snapshot.nodeCount();
+            int two = random() % snapshot.nodeCount();
+            double dx = snapshot.xCoord[one] - snapshot.xCoord[two];
+            double dy = snapshot.yCoord[one] - snapshot.yCoord[two];
+            double cost = sqrt(dx * dx + dy * dy) * factor(random);
+            changed = tree.addRoad(snapshot.nodes[one], snapshot.nodes[two], cost) != NULL;
+        } else if (action == 1) {
+            changed = tree.removeRoad(road);
+        } else {
+            changed = tree.setRoadCost(road, road->cost * factor(random));
+        }
+        chrono::duration<double> updateTime = chrono::steady_clock::now() - start;
+        updateSeconds += updateTime.count();
+        if (!changed) continue;
+        refreshGraphSnapshot(graph);
+        start = chrono::steady_clock::now();
+        reference = findMinimumSpanningTree(getGraphSnapshot());
+        chrono::duration<double> rebuildTime = chrono::steady_clock::now() - start;
+        rebuildSeconds += rebuildTime.count();
+        DynamicTreeStats stats = tree.getStats();
+        double expected = reference.totalCost();
+        applied++;
+        if (stats.treeRoads != reference.size()
+            || fabs(stats.treeCost - expected) > VERIFY_TOLERANCE * max(1.0, fabs(expected))) {
+            mismatches++;
+        }
+    }
+    string status = (mismatches == 0) ? STATUS_OK : STATUS_MISMATCH;
+    long long unpairedArcs = tree.getStats().unpairedArcs;
+    if (options.json) {
+        out<<"{\"type\":\"mstverify\",\"status\":"<<jsonString(status)<<",\"updates\":"<<applied
+           <<",\"mismatches\":"<<mismatches<<",\"unpairedArcs\":"<<unpairedArcs
+           <<",\"updateSeconds\":"<<updateSeconds<<",\"rebuildSeconds\":"<<rebuildSeconds<<"}"<<'\n';
+    } else {
+        out<<"mstverify,,,"<<csvField(status)<<","<<applied<<","<<mismatches<<'\n';
+    }
+    cerr<<"Dynamic tree: "<<applied<<" updates in "<<updateSeconds<<" s; full rebuilds took "
+        <<rebuildSeconds<<" s"<<endl;
+    if (unpairedArcs > 0) {
+        cerr<<"Dynamic tree: "<<unpairedArcs<<" arcs without an opposite arc of the same cost"
+            <<" were left out of the tree"<<endl;
+    }
+}
+
+/* Function: answerTrack
+ * Usage: answerTrack(out, options, tokens);
+ * -----------------------------------------
+ * Reads a city from the rest of a TRACK line and starts maintaining
+ * its shortest-path tree, so that later Dijkstra routes from it are
+ * read off the tree and ROAD COST requests repair it instead of
+ * invalidating it. The cost field holds the number of cities the
+ * city can reach.
+ */
+
+static void answerTrack(ostream & out, const BatchOptions & options, istream & tokens) {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    string city;
+    tokens>>city;
+    int source = snapshotNodeId(snapshot, city);
+    string status = STATUS_OK;
+    int reached = 0;
+    if (city.empty()) {
+        status = STATUS_BAD_REQUEST;
+    } else if (source == NO_NODE) {
+        status = STATUS_UNKNOWN_CITY;
+    } else {
+        DynamicShortestPaths & paths = getDynamicShortestPaths();
+        paths.track(snapshot, source);
+        const vector<double> & distance = *paths.getDistances(snapshot, source);
+        for (size_t i = 0; i < distance.size(); i++) {
+            if (distance[i] != INFINITE_DISTANCE) reached++;
+        }
+    }
+    if (options.json) {
+        out<<"{\"type\":\"track\",\"start\":"<<jsonString(city)<<",\"status\":"<<jsonString(status);
+        if (status == STATUS_OK) out<<",\"count\":"<<reached;
+        out<<"}"<<'\n';
+    } else {
+        out<<"track,"<<csvField(city)<<",,"<<csvField(status)<<",";
+        if (status == STATUS_OK) out<<reached;
+        out<<","<<'\n';
+    }
+}
+
+/* Function: treePathAgrees
+ * Usage: if (treePathAgrees(snapshot, paths, source, target, expected)) ...
+ * ------------------------------------------------------------------------
+ * Walks the path findPath reads off the tracked tree of source and
+ * returns true if it runs arc by arc from source to target and costs
+ * expected, the distance a full search found. An unreachable target
+ * must give an empty path.
+ */
+
+static bool treePathAgrees(const GraphSnapshot & snapshot, DynamicShortestPaths & paths, int source,
+                           int target, double expected) {
+    Path path;
+    if (!paths.findPath(snapshot, source, target, path)) return false;
+    if (expected == INFINITE_DISTANCE || target == source) return path.size() == 0;
+    if (path.size() == 0 || path.getArc(0)->start != snapshot.nodes[source]) return false;
+    for (int i = 1; i < path.size(); i++) {
+        if (path.getArc(i)->start != path.getArc(i - 1)->finish) return false;
+    }
+    if (path.getArc(path.size() - 1)->finish != snapshot.nodes[target]) return false;
+    return fabs(path.totalCost() - expected) <= VERIFY_TOLERANCE * max(1.0, expected);
+}
+
+/* Function: answerPathVerify
+ * Usage: answerPathVerify(out, options, graph, tokens);
+ * -----------------------------------------------------
+ * Reads an optional update count from the rest of a PATHVERIFY line
+ * and changes the cost of that many pseudo-random roads, half of them
+ * taken from tracked trees, as ROAD COST would. After each change
+ * every tracked tree is compared with a full Dijkstra search from its
+ * source, both in its distances and in the paths findPath reads off
+ * it to PATH_VERIFY_TARGETS pseudo-random cities. A pseudo-random city
+ * is tracked first if none is. The edits
+ * stay in the map. The cost field holds the number of updates and the
+ * path field the number after which some tree disagreed; the time
+ * spent repairing and searching goes to standard error.
+ */
+
+static void answerPathVerify(ostream & out, const BatchOptions & options, MapGraph & graph,
+                             istream & tokens) {
+    int updateCount;
+    if (!(tokens>>updateCount)) updateCount = DEFAULT_TREE_VERIFY_UPDATES;
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    DynamicShortestPaths & paths = getDynamicShortestPaths();
+    mt19937 random(VERIFY_SEED);
+    uniform_real_distribution<double> factor(0.5, 2.0);
+    int nodeCount = snapshot.nodeCount();
+    int arcCount = snapshot.arcCount();
+    if (paths.getSources().empty() && nodeCount > 0) paths.track(snapshot, random() % nodeCount);
+    DynamicSpanningTree & tree = getDynamicSpanningTree();
+    if (!tree.isBuilt()) tree.build(graph, snapshot);
+    vector<Node *> sources = paths.getSources();
+    SearchState state;
+    prepareSearchState(snapshot, state);
+    DynamicPathStats before = paths.getStats();
+    double searchSeconds = 0;
+    int applied = 0, mismatches = 0;
+    for (int i = 0; i < updateCount && arcCount > 0; i++) {
+        Arc *road = snapshot.arcs[random() % arcCount];
+        if (random() % 2 == 0) {
+            Path path;
+            int source = snapshotNodeId(snapshot, sources[random() % sources.size()]);
+            paths.findPath(snapshot, source, random() % nodeCount, path);
+            if (path.size() > 0) road = path.getArc(path.size() - 1);
+        }
+        if (!tree.setRoadCost(road, road->cost * factor(random))) continue;
+        updateSnapshotCosts(road->start, road->finish);
+        applied++;
+        bool agrees = true;
+        for (size_t s = 0; s < sources.size(); s++) {
+            int source = snapshotNodeId(snapshot, sources[s]);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            searchAllNodes(snapshot, state, source);
+            chrono::duration<double> searchTime = chrono::steady_clock::now() - start;
+            searchSeconds += searchTime.count();
+            const vector<double> & distance = *paths.getDistances(snapshot, source);
+            for (int id = 0; id < nodeCount && agrees; id++) {
+                double expected = state.distance[id];
+                if (expected == INFINITE_DISTANCE) {
+                    agrees = (distance[id] == INFINITE_DISTANCE);
+                } else {
+                    agrees = fabs(distance[id] - expected) <= VERIFY_TOLERANCE * max(1.0, expected);
+                }
+            }
+            for (int t = 0; t < PATH_VERIFY_TARGETS && agrees; t++) {
+                int target = random() % nodeCount;
+                agrees = treePathAgrees(snapshot, paths, source, target, state.distance[target]);
+            }
+        }
+        if (!agrees) mismatches++;
+    }
+    DynamicPathStats after = paths.getStats();
+    double repairSeconds = after.repairSeconds - before.repairSeconds;
+    string status = (mismatches == 0) ? STATUS_OK : STATUS_MISMATCH;
+    if (options.json) {
+        out<<"{\"type\":\"pathverify\",\"status\":"<<jsonString(status)<<",\"updates\":"<<applied
+           <<",\"mismatches\":"<<mismatches<<",\"trees\":"<<sources.size()
+           <<",\"repairSeconds\":"<<repairSeconds<<",\"searchSeconds\":"<<searchSeconds<<"}"<<'\n';
+    } else {
+        out<<"pathverify,,,"<<csvField(status)<<","<<applied<<","<<mismatches<<'\n';
+    }
+    cerr<<"Tracked trees: "<<applied<<" updates to "<<sources.size()<<" trees settled "
+        <<after.repairedNodes - before.repairedNodes<<" nodes in "<<repairSeconds
+        <<" s; full searches took "<<searchSeconds<<" s"<<endl;
+}
+
+/* Function: answerIsochrone
+ * Usage: answerIsochrone(out, options, tokens);
+ * ---------------------------------------------
+ * Reads "city limit" from the rest of an ISOCHRONE line, builds the
+ * full shortest-path tree of the city with delta stepping, and writes
+ * every city within limit of it, nearest first, with the count in
+ * the cost field.
+ */
+
+static void answerIsochrone(ostream & out, const BatchOptions & options, istream & tokens) {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    string city;
+    double limit;
+    string status = STATUS_OK;
+    vector< pair<double, int> > reached;
+    if (!(tokens>>city>>limit)) {
+        status = STATUS_BAD_REQUEST;
+    } else if (snapshotNodeId(snapshot, city) == NO_NODE) {
+        status = STATUS_UNKNOWN_CITY;
+    } else {
+        ShortestPathTree tree;
+        computeShortestPathTree(snapshot, snapshotNodeId(snapshot, city), tree);
+        for (int id = 0; id < snapshot.nodeCount(); id++) {
+            if (tree.distance[id] <= limit) reached.push_back(make_pair(tree.distance[id], id));
+        }
+        sort(reached.begin(), reached.end());
+    }
+    if (options.json) {
+        out<<"{\"type\":\"isochrone\",\"start\":"<<jsonString(city)<<",\"status\":"<<jsonString(status);
+        if (status == STATUS_OK) {
+            out<<",\"count\":"<<reached.size()<<",\"cities\":[";
+            for (size_t i = 0; i < reached.size(); i++) {
+                if (i > 0) out<<",";
+                out<<"{\"city\":"<<jsonString(snapshot.names[reached[i].second])<<",\"cost\":"<<reached[i].first<<"}";
+            }
+            out<<"]";
+        }
+        out<<"}"<<'\n';
+    } else {
+        string joined;
+        for (size_t i = 0; i < reached.size(); i++) {
+            if (i > 0) joined += ";";
+            joined += snapshot.names[reached[i].second];
+        }
+        out<<"isochrone,"<<csvField(city)<<",,"<<csvField(status)<<",";
+        if (status == STATUS_OK) out<<reached.size();
+        out<<","<<csvField(joined)<<'\n';
+    }
+}
+
+/* Function: answerQueries
+ * Usage: int count = answerQueries(input, options);
+ * -------------------------------------------------
+ * Reads requests from input and writes one result per request to
+ * standard output. Returns the number of requests answered. After a
+ * ROAD request adds or closes a road, the snapshot is rebuilt before
+ * the next request that searches it; a new cost is applied in place.
+ */
+
+static int answerQueries(istream & input, const BatchOptions & options, MapGraph & graph) {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    int count = 0;
+    bool edited = false;
+    string line;
+    while (getline(input, line)) {
+        istringstream tokens(line);
+        string start, finish;
+        tokens>>start;
+        if (start.empty() || start[0] == '#') continue;
+        count++;
+        if (start == ROAD_REQUEST) {
+            if (answerRoad(cout, options, graph, tokens, edited)) edited = true;
+            continue;
+        }
+        if (start == MST_REQUEST && getDynamicSpanningTree().isBuilt()) {
+            writeSpanningTree(cout, options, getDynamicSpanningTree().getTree());
+            continue;
+        }
+        if (edited) {
+            refreshGraphSnapshot(graph);
+            edited = false;
+        }
+        if (start == ISOCHRONE_REQUEST) {
+            answerIsochrone(cout, options, tokens);
+            continue;
+        }
+        if (start == TRACK_REQUEST) {
+            answerTrack(cout, options, tokens);
+            continue;
+        }
+        if (start == PATH_VERIFY_REQUEST) {
+            answerPathVerify(cout, options, graph, tokens);
+            continue;
+        }
+        if (start == TREE_VERIFY_REQUEST) {
+            answerTreeVerify(cout, options, graph, tokens);
+            continue;
+        }
+        if (start == MATRIX_REQUEST) {
+            answerMatrix(cout, options, tokens);
+            continue;
+        }
+        if (start == NEAREST_REQUEST) {
+            answerNearest(cout, options, tokens);
+            continue;
+        }
+        if (start == VERIFY_REQUEST) {
+            answerVerify(cout, options, tokens);
+            continue;
+        }
+        if (start == MST_REQUEST) {
+            writeSpanningTree(cout, options, findMinimumSpanningTree(snapshot));
+            continue;
+        }
+        tokens>>finish;
+        int source = snapshotNodeId(snapshot, start);
+        int target = snapshotNodeId(snapshot, finish);
+        Path path;
+        if (source == NO_NODE || target == NO_NODE) {
+            writeRoute(cout, options, start, finish, STATUS_UNKNOWN_CITY, path);
+            continue;
+        }
+        path = findShortestPath(snapshot.nodes[source], snapshot.nodes[target], options.mode);
+        bool reached = (source == target || path.size() > 0);
+        writeRoute(cout, options, start, finish, reached ? STATUS_OK : STATUS_UNREACHABLE, path);
+    }
+    return count;
+}
+
+/* Function: writeNodeIds
+ * Usage: if (writeNodeIds(filename, snapshot)) ...
+ * ------------------------------------------------
+ * Writes a "city,original,snapshot" CSV line for every city, in the
+ * order of the map file, giving its position in the file and its ID
+ * in the snapshot. Returns false if the file cannot be written.
+ */
+
+static bool writeNodeIds(const string & filename, const GraphSnapshot & snapshot) {
+    ofstream outfile(filename.c_str());
+    if (outfile.fail()) return false;
+    outfile<<"city,original,snapshot"<<'\n';
+    for (int i = 0; i < snapshot.nodeCount(); i++) {
+        int id = snapshot.snapshotIds[i];
+        outfile<<csvField(snapshot.names[id])<<','<<snapshot.originalIds[id]<<','<<id<<'\n';
+    }
+    outfile.close();
+    return !outfile.fail();
+}
+
+int runBatchMode(int argc, char *argv[]) {
+    BatchOptions options;
+    if (!parseBatchOptions(argc, argv, options)) {
+        printBatchUsage(argv[0]);
+        return 1;
+    }
+    if (!options.traceName.empty()) setInstrumentationEnabled(true);
+    setCostResolution(options.costResolution);
+    setNodeOrder(options.nodeOrder);
+    chrono::steady_clock::time_point loadStart = chrono::steady_clock::now();
+    MapGraph graph;
+    if (loadMap(graph, options.mapName).empty() && graph.isEmpty()) {
+        cerr<<"Could not read map "<<options.mapName<<endl;
+        return 1;
+    }
+    if (!options.idsName.empty() && !writeNodeIds(options.idsName, getGraphSnapshot())) {
+        cerr<<"Could not write "<<options.idsName<<endl;
+        return 1;
+    }
+    if (options.mode == HIERARCHY_SEARCH) {
+        getContractionHierarchy().build(getGraphSnapshot());
+    }
+    AllPairsTable & table = getAllPairsTable();
+    if (options.mode == ALL_PAIRS_SEARCH) {
+        table.setNodeLimit(options.allPairsLimit);
+        table.build(getGraphSnapshot());
+    }
+    chrono::duration<double> loadTime = chrono::steady_clock::now() - loadStart;
+
+    ifstream queryFile;
+    if (options.queryName != "-") {
+        queryFile.open(options.queryName.c_str());
+        if (queryFile.fail()) {
+            cerr<<"Could not read queries "<<options.queryName<<endl;
+            return 1;
+        }
+    }
+    istream & input = (options.queryName == "-") ? cin : queryFile;
+    cout.precision(COST_PRECISION);
+    if (!options.json) cout<<"type,start,finish,status,cost,path"<<'\n';
+    chrono::steady_clock::time_point queryStart = chrono::steady_clock::now();
+    int count = answerQueries(input, options, graph);
+    cout.flush();
+    chrono::duration<double> queryTime = chrono::steady_clock::now() - queryStart;
+
+    cerr<<"Loaded "<<getGraphSnapshot().nodeCount()<<" nodes and "<<getGraphSnapshot().arcCount()
+        <<" arcs ("<<graph.totalBytes()<<" bytes) in "<<loadTime.count()<<" s"<<endl;
+    cerr<<"Answered "<<count<<" queries in "<<queryTime.count()<<" s";
+    if (queryTime.count() > 0) cerr<<" ("<<count / queryTime.count()<<" queries/s)";
+    cerr<<endl;
+    PathCacheStats cacheStats = getPathCacheStats();
+    cerr<<"Path cache: "<<cacheStats.pathHits<<" hits, "<<cacheStats.pathMisses<<" misses; trees: "
+        <<cacheStats.treeHits<<" hits, "<<cacheStats.treeResumes<<" resumed, "<<cacheStats.treeMisses
+        <<" misses"<<endl;
+    DynamicPathStats trackedStats = getDynamicShortestPaths().getStats();
+    if (trackedStats.trackedTrees > 0) {
+        cerr<<"Tracked trees: "<<trackedStats.trackedTrees<<" trees, "<<trackedStats.rebuilds<<" built in "
+            <<trackedStats.rebuildSeconds<<" s, "<<trackedStats.updates<<" repairs settled "
+            <<trackedStats.repairedNodes<<" nodes in "<<trackedStats.repairSeconds<<" s"<<endl;
+    }
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    if (snapshot.costResolution > 0) {
+        cerr<<"Cost units: resolution "<<snapshot.costResolution<<", largest arc "<<snapshot.maxArcUnits
+            <<" units, ";
+        if (snapshot.exactUnits) {
+            cerr<<"exact"<<endl;
+        } else {
+            cerr<<"arc costs off by at most "<<snapshot.quantizationError<<endl;
+        }
+    } else if (options.costResolution != NO_COST_RESOLUTION) {
+        cerr<<"Cost units: costs could not be quantized; integer mode uses Dijkstra"<<endl;
+    }
+    if (options.mode == ALL_PAIRS_SEARCH) {
+        AllPairsStats tableStats = table.getStats();
+        if (tableStats.refused) {
+            cerr<<"All pairs: "<<tableStats.nodeCount<<" nodes is over the limit of "<<tableStats.nodeLimit
+                <<"; allpairs mode uses Dijkstra"<<endl;
+        } else {
+            cerr<<"All pairs: "<<tableStats.nodeCount<<" nodes, "<<tableStats.matrixBytes<<" bytes, built in "
+                <<tableStats.buildSeconds<<" s with the "<<(tableStats.vectorized ? "AVX2" : "scalar")
+                <<" kernel"<<endl;
+        }
+    }
+    if (!options.traceName.empty() && !saveInstrumentation(options.traceName, options.chromeTrace)) {
+        cerr<<"Could not write trace "<<options.traceName<<endl;
+    }
+    getDynamicSpanningTree().clear();
+    clearGraphSnapshot();
+    getContractionHierarchy().clear();
+    table.clear();
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * File: batchmode.h
+ * -----------------
+ * This file exports the headless batch mode of Pathfinder. Instead of
+ * opening the graphics window, it loads a map named on the command
+ * line, answers the route and spanning tree requests in a query file,
+ * and writes the results to standard output as CSV or JSON lines so
+ * that Pathfinder can be scripted from back-end jobs.
+ *
+ * Usage: Pathfinder --map USA.txt [--queries pairs.txt]
+ *                   [--format csv|json]
+ *                   [--mode dijkstra|astar|hierarchy|bidirectional|
+ *                           integer|allpairs]
+ *                   [--order graph|hilbert|bfs] [--all-pairs-limit N]
+ *                   [--trace FILE] [--trace-format lines|chrome]
+ *                   [--dump-ids FILE]
+ *
+ * Each non-blank line of the query file (standard input if omitted or
+ * "-") is "start finish", naming two cities, "MST",
+ * "MATRIX source ... TO target ...", which asks for the cost between
+ * every listed source and target, or "NEAREST x y [range]", which
+ * asks for the city closest to a map location, or "VERIFY [count]",
+ * which checks that every search mode finds the same cost between
+ * count (default 100) fixed pseudo-random pairs of cities.
+ *
+ * The map can also be edited: "ROAD ADD city city cost", "ROAD REMOVE
+ * city city" and "ROAD COST city city cost" add, close and reweight a
+ * road while keeping the minimum spanning tree up to date (see
+ * dynamicspanningtree.h), and "MSTVERIFY [count]" makes count random
+ * edits, checking the updated tree against a full rebuild after each.
+ * "TRACK city" keeps the shortest-path tree of city up to date (see
+ * dynamicshortestpaths.h): later Dijkstra routes from it are read
+ * off the tree, and ROAD COST repairs the tree instead of discarding
+ * it. "PATHVERIFY [count]" changes the cost of count (default 100)
+ * pseudo-random roads, checking every tracked tree's distances and
+ * paths against a full search after each; it tracks a random city
+ * first if none is tracked. Its new costs stay in the loaded map for
+ * the rest of the run.
+ * "ISOCHRONE city limit" lists every city within limit of city, using
+ * the parallel one-to-all search in deltastepping.h. Lines starting with
+ * # are ignored. A throughput summary goes to standard error.
+ *
+ * --order chooses how the snapshot numbers the cities (see NodeOrder
+ * in graphsnapshot.h); answers are the same under every order, apart
+ * from which of several equally short routes is reported. --dump-ids
+ * writes FILE as CSV lines "city,original,snapshot" giving each
+ * city's position in the map file and its ID under that order.
+ *
+ * The allpairs mode precomputes every distance with the AllPairsTable
+ * of allpairs.h when the map has at most --all-pairs-limit nodes
+ * (default 2048) and otherwise answers with Dijkstra's algorithm.
+ *
+ * With --trace, instrumentation (see instrumentation.h) is switched
+ * on for the whole run and its phases and counters are written to
+ * FILE as JSON lines or as a Chrome trace.
+ */
+
+#ifndef _batchmode_h
+#define _batchmode_h
+
+/* Function: runBatchMode
+ * Usage: return runBatchMode(argc, argv);
+ * ---------------------------------------
+ * Runs the batch mode with the program's command-line arguments and
+ * returns the exit status for main.
+ */
+
+int runBatchMode(int argc, char *argv[]);
+
+#endif
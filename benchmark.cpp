@@ -0,0 +1,730 @@
+/*
+ * File: benchmark.cpp
+ * -------------------
+ * This file implements the benchmark mode. Maps are generated with a
+ * small self-contained random number generator rather than <random>
+ * distributions, whose output differs between standard libraries, so
+ * a seed names the same maps everywhere.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "benchmark.h"
+#include "allpairs.h"
+#include "deltastepping.h"
+#include "graphsnapshot.h"
+#include "maploader.h"
+#include "shortestpath.h"
+#include "spanningtree.h"
+#include "threadpool.h"
+using namespace std;
+
+/* CONSTANTS */
+const double PI = 3.14159265358979323846;
+const double CITY_SPACING = 10;
+const double GEOMETRIC_DEGREE = 6;
+const int POWER_LAW_LINKS = 3;
+const double COST_JITTER = 0.25;
+const string BENCHMARK_IMAGE = "benchmark.png";
+const string DEFAULT_KINDS = "grid,geometric,powerlaw";
+const string DEFAULT_SIZES = "1000,10000,100000";
+const string DEFAULT_ORDERS = "graph,hilbert,bfs";
+const int TREE_SOURCES = 3;
+const double DISTANCE_TOLERANCE = 1e-9;
+
+
+/* Type: BenchmarkOptions
+ * ----------------------
+ * The settings parsed from the command line.
+ */
+
+struct BenchmarkOptions {
+    vector<string> kinds;
+    vector<int> sizes;
+    int queryCount;
+    uint64_t seed;
+    string directory;
+    bool keepMaps;
+    vector<int> threadCounts;
+    vector<string> orderNames;
+};
+
+/* Type: BenchmarkRandom
+ * ---------------------
+ * The splitmix64 generator: tiny, fast, and identical on every
+ * platform.
+ */
+
+struct BenchmarkRandom {
+    uint64_t state;
+
+    BenchmarkRandom(uint64_t seed) : state(seed) { }
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    double nextDouble() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    int nextInt(int limit) {
+        return (int) (next() % (uint64_t) limit);
+    }
+};
+
+/* Type: MapWriter
+ * ---------------
+ * Writes a map file as it is generated and counts what it holds. Only
+ * the coordinates are kept, for the roads to measure.
+ */
+
+struct MapWriter {
+    ofstream file;
+    int roadCount;
+    vector<double> xCoord;
+    vector<double> yCoord;
+};
+
+
+/* Function: splitList
+ * Usage: vector<string> items = splitList(text);
+ * ----------------------------------------------
+ * Splits a comma-separated list, dropping empty items.
+ */
+
+static vector<string> splitList(const string & text) {
+    vector<string> items;
+    istringstream stream(text);
+    string item;
+    while (getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+/* Function: parseWholeNumber
+ * Usage: if (parseWholeNumber(value, number)) ...
+ * -----------------------------------------------
+ * Reads value as a whole number. Returns false if it is not made of
+ * digits alone or does not fit in 64 bits.
+ */
+
+static bool parseWholeNumber(const string & value, uint64_t & number) {
+    if (value.empty() || value.find_first_not_of("0123456789") != string::npos) return false;
+    errno = 0;
+    char *end;
+    unsigned long long parsed = strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') return false;
+    number = parsed;
+    return true;
+}
+
+/* Function: parseCount
+ * Usage: if (parseCount(value, count)) ...
+ * ----------------------------------------
+ * Reads value as a whole number that fits in an int.
+ */
+
+static bool parseCount(const string & value, int & count) {
+    uint64_t number;
+    if (!parseWholeNumber(value, number) || number > INT_MAX) return false;
+    count = (int) number;
+    return true;
+}
+
+/* Function: parseBenchmarkOptions
+ * Usage: if (parseBenchmarkOptions(argc, argv, options)) ...
+ * ----------------------------------------------------------
+ * Fills options from the command line. Returns false, after saying
+ * why on standard error, if the arguments are not valid.
+ */
+
+static bool parseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions & options) {
+    options.kinds = splitList(DEFAULT_KINDS);
+    options.queryCount = 100;
+    options.seed = 1;
+    options.directory = ".";
+    options.keepMaps = false;
+    options.orderNames = splitList(DEFAULT_ORDERS);
+    string sizes = DEFAULT_SIZES;
+    string threads;
+    for (int i = 2; i < argc; i++) {
+        string flag = argv[i];
+        if (i + 1 >= argc) {
+            cerr<<"Missing value for "<<flag<<endl;
+            return false;
+        }
+        string value = argv[++i];
+        if (flag == "--kinds") {
+            options.kinds = splitList(value);
+        } else if (flag == "--sizes") {
+            sizes = value;
+        } else if (flag == "--queries") {
+            if (!parseCount(value, options.queryCount)) {
+                cerr<<"Query count must be a whole number: "<<value<<endl;
+                return false;
+            }
+        } else if (flag == "--seed") {
+            if (!parseWholeNumber(value, options.seed)) {
+                cerr<<"Seed must be a whole number: "<<value<<endl;
+                return false;
+            }
+        } else if (flag == "--dir") {
+            options.directory = value;
+        } else if (flag == "--threads") {
+            threads = value;
+        } else if (flag == "--orders") {
+            options.orderNames = splitList(value);
+        } else if (flag == "--keep" && (value == "yes" || value == "no")) {
+            options.keepMaps = (value == "yes");
+        } else {
+            cerr<<"Unrecognized argument: "<<flag<<" "<<value<<endl;
+            return false;
+        }
+    }
+    vector<string> sizeList = splitList(sizes);
+    for (size_t i = 0; i < sizeList.size(); i++) {
+        int size;
+        if (!parseCount(sizeList[i], size) || size < 2) {
+            cerr<<"Sizes must be whole numbers of at least 2 cities: "<<sizeList[i]<<endl;
+            return false;
+        }
+        options.sizes.push_back(size);
+    }
+    vector<string> threadList = splitList(threads);
+    for (size_t i = 0; i < threadList.size(); i++) {
+        int count;
+        if (!parseCount(threadList[i], count) || count < 1) {
+            cerr<<"Thread counts must be positive whole numbers: "<<threadList[i]<<endl;
+            return false;
+        }
+        options.threadCounts.push_back(count);
+    }
+    if (options.threadCounts.empty()) {
+        int hardware = max(1u, thread::hardware_concurrency());
+        for (int count = 1; count < hardware; count *= 2) {
+            options.threadCounts.push_back(count);
+        }
+        options.threadCounts.push_back(hardware);
+    }
+    for (size_t i = 0; i < options.kinds.size(); i++) {
+        const string & kind = options.kinds[i];
+        if (kind != "grid" && kind != "geometric" && kind != "powerlaw") {
+            cerr<<"Unknown map kind: "<<kind<<endl;
+            return false;
+        }
+    }
+    for (size_t i = 0; i < options.orderNames.size(); i++) {
+        NodeOrder order;
+        if (!parseNodeOrder(options.orderNames[i], order)) {
+            cerr<<"Unknown node order: "<<options.orderNames[i]<<endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Function: addCity
+ * Usage: addCity(writer, x, y);
+ * -----------------------------
+ * Writes the next city's NODES line.
+ */
+
+static void addCity(MapWriter & writer, double x, double y) {
+    char line[64];
+    int length = snprintf(line, sizeof(line), "n%d %.2f %.2f\n", (int) writer.xCoord.size(), x, y);
+    writer.file.write(line, length);
+    writer.xCoord.push_back(x);
+    writer.yCoord.push_back(y);
+}
+
+/* Function: addRoad
+ * Usage: addRoad(writer, random, a, b);
+ * -------------------------------------
+ * Writes an ARCS line between cities a and b whose cost is their
+ * distance stretched by up to COST_JITTER, plus one so that cities
+ * at the same spot are not free to travel between.
+ */
+
+static void addRoad(MapWriter & writer, BenchmarkRandom & random, int a, int b) {
+    double dx = writer.xCoord[a] - writer.xCoord[b];
+    double dy = writer.yCoord[a] - writer.yCoord[b];
+    double cost = sqrt(dx * dx + dy * dy) * (1 + COST_JITTER * random.nextDouble()) + 1;
+    char line[64];
+    int length = snprintf(line, sizeof(line), "n%d n%d %.2f\n", a, b, cost);
+    writer.file.write(line, length);
+    writer.roadCount++;
+}
+
+/* Function: generateGrid
+ * Usage: generateGrid(writer, random, size);
+ * ------------------------------------------
+ * Lays size cities out row by row on a square lattice, each nudged
+ * by up to a quarter of the spacing, and joins lattice neighbors.
+ */
+
+static void generateGrid(MapWriter & writer, BenchmarkRandom & random, int size) {
+    int side = (int) ceil(sqrt((double) size));
+    for (int i = 0; i < size; i++) {
+        double jitterX = (random.nextDouble() - 0.5) * CITY_SPACING / 2;
+        double jitterY = (random.nextDouble() - 0.5) * CITY_SPACING / 2;
+        addCity(writer, (i % side) * CITY_SPACING + jitterX, (i / side) * CITY_SPACING + jitterY);
+    }
+    writer.file<<"ARCS\n";
+    for (int i = 0; i < size; i++) {
+        if (i % side + 1 < side && i + 1 < size) addRoad(writer, random, i, i + 1);
+        if (i + side < size) addRoad(writer, random, i, i + side);
+    }
+}
+
+/* Function: generateGeometric
+ * Usage: generateGeometric(writer, random, size);
+ * -----------------------------------------------
+ * Scatters size cities uniformly and joins every pair closer than a
+ * radius chosen for GEOMETRIC_DEGREE roads per city on average.
+ * Cities are bucketed into cells one radius wide, so only
+ * neighboring cells are compared.
+ */
+
+static void generateGeometric(MapWriter & writer, BenchmarkRandom & random, int size) {
+    double width = CITY_SPACING * sqrt((double) size);
+    double radius = width * sqrt(GEOMETRIC_DEGREE / (PI * size));
+    for (int i = 0; i < size; i++) {
+        addCity(writer, random.nextDouble() * width, random.nextDouble() * width);
+    }
+    writer.file<<"ARCS\n";
+    int cells = max(1, (int) (width / radius));
+    vector<vector<int> > buckets(cells * cells);
+    for (int i = 0; i < size; i++) {
+        int cx = min(cells - 1, (int) (writer.xCoord[i] / radius));
+        int cy = min(cells - 1, (int) (writer.yCoord[i] / radius));
+        buckets[cy * cells + cx].push_back(i);
+    }
+    for (int i = 0; i < size; i++) {
+        int cx = min(cells - 1, (int) (writer.xCoord[i] / radius));
+        int cy = min(cells - 1, (int) (writer.yCoord[i] / radius));
+        for (int y = max(0, cy - 1); y <= min(cells - 1, cy + 1); y++) {
+            for (int x = max(0, cx - 1); x <= min(cells - 1, cx + 1); x++) {
+                const vector<int> & bucket = buckets[y * cells + x];
+                for (size_t k = 0; k < bucket.size(); k++) {
+                    int j = bucket[k];
+                    if (j <= i) continue;
+                    double dx = writer.xCoord[i] - writer.xCoord[j];
+                    double dy = writer.yCoord[i] - writer.yCoord[j];
+                    if (dx * dx + dy * dy < radius * radius) addRoad(writer, random, i, j);
+                }
+            }
+        }
+    }
+}
+
+/* Function: generatePowerLaw
+ * Usage: generatePowerLaw(writer, random, size);
+ * ----------------------------------------------
+ * Grows a Barabasi-Albert graph: it starts from a few fully joined
+ * cities, and each new city links to POWER_LAW_LINKS distinct cities
+ * picked with probability proportional to their number of roads.
+ * Picking a random end of a random road so far does exactly that.
+ */
+
+static void generatePowerLaw(MapWriter & writer, BenchmarkRandom & random, int size) {
+    double width = CITY_SPACING * sqrt((double) size);
+    for (int i = 0; i < size; i++) {
+        addCity(writer, random.nextDouble() * width, random.nextDouble() * width);
+    }
+    writer.file<<"ARCS\n";
+    int seedCities = min(size, POWER_LAW_LINKS + 1);
+    vector<int> roadEnds;
+    for (int i = 0; i < seedCities; i++) {
+        for (int j = i + 1; j < seedCities; j++) {
+            addRoad(writer, random, i, j);
+            roadEnds.push_back(i);
+            roadEnds.push_back(j);
+        }
+    }
+    for (int i = seedCities; i < size; i++) {
+        int chosen[POWER_LAW_LINKS];
+        int count = 0;
+        while (count < POWER_LAW_LINKS) {
+            int candidate = roadEnds[random.nextInt(roadEnds.size())];
+            bool repeated = false;
+            for (int k = 0; k < count; k++) {
+                if (chosen[k] == candidate) repeated = true;
+            }
+            if (!repeated) chosen[count++] = candidate;
+        }
+        for (int k = 0; k < count; k++) {
+            addRoad(writer, random, i, chosen[k]);
+            roadEnds.push_back(i);
+            roadEnds.push_back(chosen[k]);
+        }
+    }
+}
+
+/* Function: writeSyntheticMap
+ * Usage: if (writeSyntheticMap(filename, kind, size, seed)) ...
+ * -------------------------------------------------------------
+ * Generates a map of the given kind and size and writes it to
+ * filename. Returns false if the file cannot be written.
+ */
+
+static bool writeSyntheticMap(const string & filename, const string & kind, int size, uint64_t seed) {
+    MapWriter writer;
+    writer.roadCount = 0;
+    writer.file.open(filename.c_str(), ios::binary | ios::trunc);
+    if (writer.file.fail()) return false;
+    writer.file<<BENCHMARK_IMAGE<<"\nNODES\n";
+    BenchmarkRandom random(seed);
+    if (kind == "grid") {
+        generateGrid(writer, random, size);
+    } else if (kind == "geometric") {
+        generateGeometric(writer, random, size);
+    } else {
+        generatePowerLaw(writer, random, size);
+    }
+    writer.file.close();
+    return !writer.file.fail();
+}
+
+/* Function: secondsSince
+ * Usage: double seconds = secondsSince(start);
+ * --------------------------------------------
+ * Returns the time elapsed since start.
+ */
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/* Function: timeQueries
+ * Usage: timeQueries(out, label, snapshot, mode, options);
+ * --------------------------------------------------------
+ * Runs the benchmark's query pairs in one search mode and writes a
+ * JSON member describing how long they took and how much of the map
+ * they searched. The pairs depend only on the seed and map size, and
+ * the path cache is off so that every pair is searched.
+ */
+
+static void timeQueries(ostream & out, const string & label, const GraphSnapshot & snapshot,
+                        SearchMode mode, const BenchmarkOptions & options) {
+    BenchmarkRandom random(options.seed ^ 0x5DEECE66DULL);
+    int nodeCount = snapshot.nodeCount();
+    long long settled = 0;
+    int reached = 0;
+    setPathCacheEnabled(false);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < options.queryCount; i++) {
+        Node *from = snapshot.nodes[random.nextInt(nodeCount)];
+        Node *to = snapshot.nodes[random.nextInt(nodeCount)];
+        Path path = findShortestPath(from, to, mode);
+        settled += getLastSearchStats().settledNodes;
+        if (from == to || path.size() > 0) reached++;
+    }
+    double seconds = secondsSince(start);
+    setPathCacheEnabled(true);
+    out<<",\""<<label<<"\":{\"queries\":"<<options.queryCount<<",\"reached\":"<<reached
+       <<",\"seconds\":"<<seconds<<",\"queriesPerSecond\":"
+       <<(seconds > 0 ? options.queryCount / seconds : 0)
+       <<",\"averageSettled\":"<<(options.queryCount > 0 ? (double) settled / options.queryCount : 0)<<"}";
+}
+
+/* Function: startCacheMissCounter
+ * Usage: int counter = startCacheMissCounter();
+ * ---------------------------------------------
+ * Starts counting the hardware cache misses of this thread in user
+ * code and returns a handle for stopCacheMissCounter, or -1 if the
+ * platform or the kernel's perf_event settings do not allow it.
+ */
+
+static int startCacheMissCounter() {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+/* Function: stopCacheMissCounter
+ * Usage: long long misses = stopCacheMissCounter(counter);
+ * --------------------------------------------------------
+ * Returns the misses counted since startCacheMissCounter, or -1 if
+ * there is no counter, and releases it.
+ */
+
+static long long stopCacheMissCounter(int counter) {
+    long long misses = -1;
+#ifdef __linux__
+    if (counter < 0) return -1;
+    uint64_t value;
+    if (read(counter, &value, sizeof(value)) == sizeof(value)) misses = value;
+    close(counter);
+#endif
+    return misses;
+}
+
+/* Function: timeNodeOrders
+ * Usage: timeNodeOrders(out, graph, options);
+ * -------------------------------------------
+ * Rebuilds the snapshot of graph under each requested node order and
+ * writes a JSON member comparing them: the build time, the mean gap
+ * between the IDs at the two ends of an arc, and the time and cache
+ * misses (null where they cannot be counted) of the Dijkstra query
+ * pairs. Pairs are drawn by original ID, so every order answers the
+ * same queries. The snapshot is left in the last order listed.
+ */
+
+static void timeNodeOrders(ostream & out, MapGraph & graph, const BenchmarkOptions & options) {
+    out<<",\"nodeOrders\":{";
+    for (size_t o = 0; o < options.orderNames.size(); o++) {
+        NodeOrder order;
+        parseNodeOrder(options.orderNames[o], order);
+        setNodeOrder(order);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        refreshGraphSnapshot(graph);
+        double buildSeconds = secondsSince(start);
+        const GraphSnapshot & snapshot = getGraphSnapshot();
+        int nodeCount = snapshot.nodeCount();
+        double gapTotal = 0;
+        for (int u = 0; u < nodeCount; u++) {
+            for (int arc = snapshot.arcOffset[u]; arc < snapshot.arcOffset[u + 1]; arc++) {
+                gapTotal += abs(snapshot.arcTarget[arc] - u);
+            }
+        }
+        BenchmarkRandom random(options.seed ^ 0x5DEECE66DULL);
+        long long settled = 0;
+        setPathCacheEnabled(false);
+        int counter = startCacheMissCounter();
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < options.queryCount; i++) {
+            Node *from = snapshot.nodes[snapshot.snapshotIds[random.nextInt(nodeCount)]];
+            Node *to = snapshot.nodes[snapshot.snapshotIds[random.nextInt(nodeCount)]];
+            findShortestPath(from, to, DIJKSTRA_SEARCH);
+            settled += getLastSearchStats().settledNodes;
+        }
+        double seconds = secondsSince(start);
+        long long misses = stopCacheMissCounter(counter);
+        setPathCacheEnabled(true);
+        out<<(o > 0 ? "," : "")<<"\""<<options.orderNames[o]<<"\":{\"buildSeconds\":"<<buildSeconds
+           <<",\"averageArcGap\":"<<(snapshot.arcCount() > 0 ? gapTotal / snapshot.arcCount() : 0)
+           <<",\"querySeconds\":"<<seconds<<",\"settled\":"<<settled<<",\"cacheMisses\":";
+        if (misses < 0) {
+            out<<"null";
+        } else {
+            out<<misses;
+        }
+        out<<"}";
+    }
+    out<<"}";
+    setNodeOrder(DEFAULT_NODE_ORDER);
+}
+
+/* Function: timeAllPairs
+ * Usage: timeAllPairs(out, snapshot, options);
+ * --------------------------------------------
+ * Builds the all-pairs table of snapshot with the scalar kernel and
+ * then with the AVX2 kernel, and times the query pairs answered from
+ * it. Maps over the table's node limit get a null member instead.
+ */
+
+static void timeAllPairs(ostream & out, const GraphSnapshot & snapshot, const BenchmarkOptions & options) {
+    AllPairsTable & table = getAllPairsTable();
+    if (snapshot.nodeCount() > table.getNodeLimit()) {
+        out<<",\"allPairs\":null";
+        return;
+    }
+    table.build(snapshot, false);
+    double scalarSeconds = table.getStats().buildSeconds;
+    table.build(snapshot, true);
+    AllPairsStats stats = table.getStats();
+    out<<",\"allPairs\":{\"matrixBytes\":"<<stats.matrixBytes<<",\"scalarSeconds\":"<<scalarSeconds
+       <<",\"vectorSeconds\":";
+    if (stats.vectorized) {
+        out<<stats.buildSeconds;
+    } else {
+        out<<"null";
+    }
+    out<<"}";
+    timeQueries(out, "allPairsQueries", snapshot, ALL_PAIRS_SEARCH, options);
+    table.clear();
+}
+
+/* Function: sameDistances
+ * Usage: if (sameDistances(found, expected)) ...
+ * ----------------------------------------------
+ * Returns true if two distance arrays agree up to the rounding of
+ * adding the same costs in a different order.
+ */
+
+static bool sameDistances(const vector<double> & found, const vector<double> & expected) {
+    if (found.size() != expected.size()) return false;
+    for (size_t i = 0; i < found.size(); i++) {
+        if (found[i] == expected[i]) continue;
+        if (fabs(found[i] - expected[i]) > DISTANCE_TOLERANCE * max(1.0, fabs(expected[i]))) return false;
+    }
+    return true;
+}
+
+/* Function: timeShortestPathTrees
+ * Usage: timeShortestPathTrees(out, snapshot, options);
+ * -----------------------------------------------------
+ * Builds full shortest-path trees from a few pseudo-random sources,
+ * first with the sequential heap-based search and then with delta
+ * stepping on a pool of each requested size, and writes a JSON member
+ * with the times and each pool's speedup over the first pool size
+ * listed (by default one thread). Every delta-stepping tree is checked
+ * against the sequential distances.
+ */
+
+static void timeShortestPathTrees(ostream & out, const GraphSnapshot & snapshot, const BenchmarkOptions & options) {
+    BenchmarkRandom random(options.seed ^ 0x2545F4914F6CDD1DULL);
+    int nodeCount = snapshot.nodeCount();
+    vector<int> sources;
+    for (int i = 0; i < TREE_SOURCES; i++) {
+        sources.push_back(random.nextInt(nodeCount));
+    }
+    vector< vector<double> > expected(sources.size());
+    SearchState state;
+    prepareSearchState(snapshot, state);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < sources.size(); i++) {
+        searchAllNodes(snapshot, state, sources[i]);
+        expected[i] = state.distance;
+    }
+    out<<",\"shortestPathTrees\":{\"sources\":"<<sources.size()<<",\"dijkstraSeconds\":"<<secondsSince(start)
+       <<",\"delta\":"<<chooseDelta(snapshot)<<",\"deltaStepping\":[";
+    double firstSeconds = 0;
+    for (size_t t = 0; t < options.threadCounts.size(); t++) {
+        ThreadPool pool(options.threadCounts[t]);
+        ShortestPathTree tree;
+        bool matches = true;
+        DeltaSteppingStats stats = DeltaSteppingStats();
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < sources.size(); i++) {
+            stats = computeShortestPathTree(snapshot, sources[i], tree, pool, 0);
+            if (!sameDistances(tree.distance, expected[i])) matches = false;
+        }
+        double seconds = secondsSince(start);
+        if (t == 0) firstSeconds = seconds;
+        out<<(t > 0 ? "," : "")<<"{\"threads\":"<<pool.size()<<",\"seconds\":"<<seconds
+           <<",\"speedup\":"<<(seconds > 0 ? firstSeconds / seconds : 0)
+           <<",\"buckets\":"<<stats.buckets<<",\"phases\":"<<stats.phases
+           <<",\"relaxedArcs\":"<<stats.relaxedArcs<<",\"matches\":"<<(matches ? "true" : "false")<<"}";
+    }
+    out<<"]}";
+}
+
+/* Function: runOneBenchmark
+ * Usage: if (runOneBenchmark(kind, size, options)) ...
+ * ----------------------------------------------------
+ * Generates, loads, queries and spans one synthetic map, writing a
+ * line of JSON with the results. The text loader is called directly,
+ * so the binary snapshot cache never hides the parsing time.
+ */
+
+static bool runOneBenchmark(const string & kind, int size, const BenchmarkOptions & options) {
+    string filename = options.directory + "/benchmark-" + kind + "-" + to_string(size) + ".txt";
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (!writeSyntheticMap(filename, kind, size, options.seed)) {
+        cerr<<"Could not write "<<filename<<endl;
+        return false;
+    }
+    double generateSeconds = secondsSince(start);
+    ifstream sizeCheck(filename.c_str(), ios::binary | ios::ate);
+    long long fileBytes = sizeCheck.tellg();
+    sizeCheck.close();
+
+    MapGraph graph;
+    start = chrono::steady_clock::now();
+    loadMapFile(graph, filename);
+    double parseSeconds = secondsSince(start);
+    start = chrono::steady_clock::now();
+    refreshGraphSnapshot(graph);
+    double snapshotSeconds = secondsSince(start);
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    size_t graphBytes = graph.totalBytes();
+
+    ostringstream out;
+    out.precision(10);
+    out<<"{\"kind\":\""<<kind<<"\",\"cities\":"<<snapshot.nodeCount()<<",\"arcs\":"<<snapshot.arcCount()
+       <<",\"fileBytes\":"<<fileBytes<<",\"graphBytes\":"<<graphBytes
+       <<",\"generateSeconds\":"<<generateSeconds<<",\"parseSeconds\":"<<parseSeconds
+       <<",\"snapshotSeconds\":"<<snapshotSeconds;
+    timeQueries(out, "dijkstra", snapshot, DIJKSTRA_SEARCH, options);
+    timeQueries(out, "astar", snapshot, ASTAR_SEARCH, options);
+    timeQueries(out, "bidirectional", snapshot, BIDIRECTIONAL_SEARCH, options);
+    out<<",\"costResolution\":"<<snapshot.costResolution<<",\"maxArcUnits\":"<<snapshot.maxArcUnits
+       <<",\"quantizationError\":"<<snapshot.quantizationError;
+    timeQueries(out, "integer", snapshot, INTEGER_SEARCH, options);
+    timeAllPairs(out, snapshot, options);
+    timeShortestPathTrees(out, snapshot, options);
+    start = chrono::steady_clock::now();
+    Path kruskalTree = kruskalSpanningTree(snapshot);
+    double kruskalSeconds = secondsSince(start);
+    start = chrono::steady_clock::now();
+    Path tree = findMinimumSpanningTree(snapshot);
+    double mstSeconds = secondsSince(start);
+    bool sameTree = kruskalTree.size() == tree.size();
+    for (int i = 0; sameTree && i < tree.size(); i++) {
+        sameTree = kruskalTree.getArc(i) == tree.getArc(i);
+    }
+    out<<",\"kruskalSeconds\":"<<kruskalSeconds<<",\"mstSeconds\":"<<mstSeconds
+       <<",\"mstEdges\":"<<tree.size()<<",\"mstCost\":"<<tree.totalCost()
+       <<",\"mstMatchesKruskal\":"<<(sameTree ? "true" : "false");
+    timeNodeOrders(out, graph, options);
+
+    start = chrono::steady_clock::now();
+    clearGraphSnapshot();
+    graph.clear();
+    out<<",\"teardownSeconds\":"<<secondsSince(start)<<"}";
+    cout<<out.str()<<endl;
+    if (!options.keepMaps) remove(filename.c_str());
+    return true;
+}
+
+int runBenchmarkMode(int argc, char *argv[]) {
+    BenchmarkOptions options;
+    if (!parseBenchmarkOptions(argc, argv, options)) {
+        cerr<<"Usage: "<<argv[0]<<" --benchmark [--kinds grid,geometric,powerlaw]"
+            <<" [--sizes N,N,...] [--queries N] [--seed N] [--dir DIR] [--keep no|yes]"
+            <<" [--threads N,N,...] [--orders graph,hilbert,bfs]"<<endl;
+        return 1;
+    }
+    setCostResolution(AUTO_COST_RESOLUTION);
+    cout<<"{\"benchmark\":\"pathfinder\",\"seed\":"<<options.seed<<",\"queries\":"<<options.queryCount
+        <<",\"hardwareThreads\":"<<thread::hardware_concurrency()<<"}"<<endl;
+    for (size_t k = 0; k < options.kinds.size(); k++) {
+        for (size_t s = 0; s < options.sizes.size(); s++) {
+            if (!runOneBenchmark(options.kinds[k], options.sizes[s], options)) return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * File: benchmark.h
+ * -----------------
+ * This file exports the benchmark mode of Pathfinder. It generates
+ * synthetic maps in the ordinary map file format, then times how
+ * long each one takes to parse, to answer point-to-point queries
+ * between pseudo-random pairs of cities, and to span with a minimum
+ * spanning tree, both by plain Kruskal and by findMinimumSpanningTree,
+ * which switches to parallel Boruvka on large maps. Results go to
+ * standard output as one JSON object per line so that runs can be
+ * compared from release to release.
+ *
+ * Usage: Pathfinder --benchmark [--kinds grid,geometric,powerlaw]
+ *                   [--sizes 1000,10000,100000] [--queries 100]
+ *                   [--seed 1] [--dir .] [--keep no|yes]
+ *                   [--threads 1,2,4,...]
+ *                   [--orders graph,hilbert,bfs]
+ *
+ * Sizes count cities. A grid map is a jittered square lattice, a
+ * geometric map joins random points closer than a radius chosen for
+ * an average of six roads per city, and a power-law map grows by
+ * preferential attachment, three roads per new city. The same seed
+ * always generates the same maps.
+ *
+ * Maps small enough for the all-pairs table (see allpairs.h) also
+ * time its build with and without AVX2 and the queries it answers.
+ *
+ * Each map also gets full shortest-path trees from a few cities,
+ * built once by the sequential search and once by delta stepping
+ * (see deltastepping.h) per thread count, by default every power of
+ * two below the number of hardware threads and that number itself.
+ * The speedups over one thread give the scaling curve. Finally the
+ * snapshot is rebuilt under each node order (see NodeOrder in
+ * graphsnapshot.h) and the same Dijkstra queries are timed on each,
+ * with hardware cache-miss counts where Linux perf events allow.
+ */
+
+#ifndef _benchmark_h
+#define _benchmark_h
+
+/* Function: runBenchmarkMode
+ * Usage: return runBenchmarkMode(argc, argv);
+ * -------------------------------------------
+ * Runs the benchmark with the program's command-line arguments, the
+ * first of which is --benchmark, and returns the exit status for
+ * main.
+ */
+
+int runBenchmarkMode(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,471 @@
+/*
+ * File: contraction.cpp
+ * ---------------------
+ * This file implements the ContractionHierarchy class. Nodes are
+ * ordered by a lazily updated priority: twice the number of shortcuts
+ * contracting a node would add minus the edges it would remove, plus
+ * the number of its neighbors already contracted and its depth in the
+ * hierarchy so far (both of which spread contraction evenly across
+ * the map and keep the upward searches shallow). Shortcuts are only added when
+ * a bounded witness search finds no equally short detour.
+ */
+
+#include <chrono>
+#include "contraction.h"
+#include "instrumentation.h"
+using namespace std;
+
+/* CONSTANTS */
+const int WITNESS_SETTLE_LIMIT = 100;
+const int SIMULATION_SETTLE_LIMIT = 20;
+const int NO_EDGE = -1;
+const int FORWARD = 0;
+const int BACKWARD = 1;
+
+
+/* Type: Neighbor
+ * --------------
+ * A live neighbor of the node being contracted, with the cheapest
+ * edge that joins them.
+ */
+
+struct Neighbor {
+    int node;
+    int edge;
+    double cost;
+};
+
+/* Type: Contractor
+ * ----------------
+ * The working state while contracting: the remaining graph as lists
+ * of edge IDs, and the arrays of the witness search.
+ */
+
+struct Contractor {
+    vector< vector<int> > incident;
+    vector<bool> contracted;
+    vector<int> contractedNeighbors;
+    vector<int> depth;
+    vector<double> witnessDistance;
+    vector<int> witnessTouched;
+    vector<int> neighborEdge;       /* scratch for collectNeighbors */
+    IndexedHeap witnessHeap;
+};
+
+
+/* Function: otherEnd
+ * Usage: int v = otherEnd(edge, u);
+ * ---------------------------------
+ * Returns the endpoint of the edge that is not u.
+ */
+
+template <typename Edge>
+static inline int otherEnd(const Edge & edge, int u) {
+    return (edge.a == u) ? edge.b : edge.a;
+}
+
+/* Function: collectNeighbors
+ * Usage: collectNeighbors(state, edges, v, neighbors);
+ * ----------------------------------------------------
+ * Fills neighbors with the uncontracted nodes adjacent to v, keeping
+ * only the cheapest of any parallel edges.
+ */
+
+template <typename Edge>
+static void collectNeighbors(Contractor & state, const vector<Edge> & edges, int v,
+                             vector<Neighbor> & neighbors) {
+    neighbors.clear();
+    for (size_t i = 0; i < state.incident[v].size(); i++) {
+        int e = state.incident[v][i];
+        int u = otherEnd(edges[e], v);
+        if (u == v || state.contracted[u]) continue;
+        int slot = state.neighborEdge[u];
+        if (slot == NO_EDGE) {
+            state.neighborEdge[u] = neighbors.size();
+            Neighbor neighbor = { u, e, edges[e].cost };
+            neighbors.push_back(neighbor);
+        } else if (edges[e].cost < neighbors[slot].cost) {
+            neighbors[slot].edge = e;
+            neighbors[slot].cost = edges[e].cost;
+        }
+    }
+    for (size_t i = 0; i < neighbors.size(); i++) {
+        state.neighborEdge[neighbors[i].node] = NO_EDGE;
+    }
+}
+
+/* Function: witnessSearch
+ * Usage: witnessSearch(state, edges, source, excluded, limit, settleLimit);
+ * ------------------------------------------------------------------------
+ * Runs a Dijkstra search from source through uncontracted nodes
+ * other than excluded, stopping once distances exceed limit or
+ * settleLimit nodes have been settled. Priority estimates use the
+ * cheaper SIMULATION_SETTLE_LIMIT; a missed witness there only makes
+ * the estimate pessimistic, never the hierarchy wrong. Afterwards
+ * witnessDistance holds an upper bound on each node's distance.
+ */
+
+template <typename Edge>
+static void witnessSearch(Contractor & state, const vector<Edge> & edges, int source,
+                          int excluded, double limit, int settleLimit) {
+    for (size_t i = 0; i < state.witnessTouched.size(); i++) {
+        state.witnessDistance[state.witnessTouched[i]] = INFINITE_DISTANCE;
+    }
+    state.witnessTouched.clear();
+    state.witnessHeap.clear();
+    state.witnessDistance[source] = 0;
+    state.witnessTouched.push_back(source);
+    state.witnessHeap.pushOrDecrease(source, 0);
+    int settled = 0;
+    while (!state.witnessHeap.isEmpty() && settled < settleLimit) {
+        if (state.witnessHeap.minKey() > limit) break;
+        int u = state.witnessHeap.popMin();
+        settled++;
+        double base = state.witnessDistance[u];
+        for (size_t i = 0; i < state.incident[u].size(); i++) {
+            const Edge & edge = edges[state.incident[u][i]];
+            int w = otherEnd(edge, u);
+            if (w == excluded || state.contracted[w]) continue;
+            double candidate = base + edge.cost;
+            if (candidate < state.witnessDistance[w]) {
+                if (state.witnessDistance[w] == INFINITE_DISTANCE) state.witnessTouched.push_back(w);
+                state.witnessDistance[w] = candidate;
+                state.witnessHeap.pushOrDecrease(w, candidate);
+            }
+        }
+    }
+}
+
+/* Function: dropContractedEdges
+ * Usage: dropContractedEdges(state, edges, u);
+ * --------------------------------------------
+ * Removes the edges leading to contracted nodes from u's list, so
+ * later witness searches do not keep stepping over them.
+ */
+
+template <typename Edge>
+static void dropContractedEdges(Contractor & state, const vector<Edge> & edges, int u) {
+    vector<int> & incident = state.incident[u];
+    size_t kept = 0;
+    for (size_t i = 0; i < incident.size(); i++) {
+        if (!state.contracted[otherEnd(edges[incident[i]], u)]) incident[kept++] = incident[i];
+    }
+    incident.resize(kept);
+}
+
+/* Function: contractNode
+ * Usage: int shortcuts = contractNode(state, edges, v, simulate);
+ * ---------------------------------------------------------------
+ * Finds every pair of neighbors of v whose shortest connection runs
+ * through v and returns how many there are. Unless simulate is true,
+ * it also adds a shortcut edge for each pair and marks v contracted.
+ */
+
+template <typename Edge>
+static int contractNode(Contractor & state, vector<Edge> & edges, int v, bool simulate) {
+    vector<Neighbor> neighbors;
+    collectNeighbors(state, edges, v, neighbors);
+    double maxCost = 0;
+    for (size_t i = 0; i < neighbors.size(); i++) {
+        if (neighbors[i].cost > maxCost) maxCost = neighbors[i].cost;
+    }
+    int shortcuts = 0;
+    for (size_t i = 0; i + 1 < neighbors.size(); i++) {
+        const Neighbor & from = neighbors[i];
+        witnessSearch(state, edges, from.node, v, from.cost + maxCost,
+                      simulate ? SIMULATION_SETTLE_LIMIT : WITNESS_SETTLE_LIMIT);
+        for (size_t j = i + 1; j < neighbors.size(); j++) {
+            const Neighbor & to = neighbors[j];
+            double viaCost = from.cost + to.cost;
+            if (state.witnessDistance[to.node] <= viaCost) continue;
+            shortcuts++;
+            if (simulate) continue;
+            Edge shortcut = { from.node, to.node, viaCost, from.edge, to.edge, v, NO_EDGE, NO_EDGE };
+            int id = edges.size();
+            edges.push_back(shortcut);
+            state.incident[from.node].push_back(id);
+            state.incident[to.node].push_back(id);
+        }
+    }
+    if (!simulate) {
+        state.contracted[v] = true;
+        for (size_t i = 0; i < neighbors.size(); i++) {
+            int u = neighbors[i].node;
+            state.contractedNeighbors[u]++;
+            if (state.depth[u] < state.depth[v] + 1) state.depth[u] = state.depth[v] + 1;
+            dropContractedEdges(state, edges, u);
+        }
+    }
+    return shortcuts;
+}
+
+/* Function: contractionPriority
+ * Usage: double priority = contractionPriority(state, edges, v);
+ * --------------------------------------------------------------
+ * Returns the current priority of v; smaller is contracted sooner.
+ */
+
+template <typename Edge>
+static double contractionPriority(Contractor & state, vector<Edge> & edges, int v) {
+    vector<Neighbor> neighbors;
+    collectNeighbors(state, edges, v, neighbors);
+    int shortcuts = contractNode(state, edges, v, true);
+    return 2 * (shortcuts - (int) neighbors.size()) + state.contractedNeighbors[v] + state.depth[v];
+}
+
+
+ContractionHierarchy::ContractionHierarchy() {
+    clear();
+}
+
+void ContractionHierarchy::clear() {
+    edges.clear();
+    rank.clear();
+    upOffset.assign(1, 0);
+    upTarget.clear();
+    upCost.clear();
+    upEdge.clear();
+    stats.nodeCount = 0;
+    stats.originalEdges = 0;
+    stats.shortcutCount = 0;
+    stats.buildSeconds = 0;
+    snapshotVersion = -1;
+    snapshotCostVersion = -1;
+    lastSettledCount = 0;
+}
+
+/* Method: build
+ * -------------
+ * Each undirected edge of the snapshot becomes one HierarchyEdge
+ * that remembers the arc in both directions. The reverse arc is the
+ * one from v back to u with the same cost.
+ */
+
+void ContractionHierarchy::build(const GraphSnapshot & snapshot) {
+    PhaseTimer timer("hierarchy");
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    clear();
+    int nodeCount = snapshot.nodeCount();
+    Contractor state;
+    state.incident.assign(nodeCount, vector<int>());
+    for (int u = 0; u < nodeCount; u++) {
+        for (int arc = snapshot.arcOffset[u]; arc < snapshot.arcOffset[u + 1]; arc++) {
+            int v = snapshot.arcTarget[arc];
+            if (u >= v) continue;
+            int reverse = NO_EDGE;
+            for (int back = snapshot.arcOffset[v]; back < snapshot.arcOffset[v + 1]; back++) {
+                if (snapshot.arcTarget[back] == u && snapshot.arcCost[back] == snapshot.arcCost[arc]) {
+                    reverse = back;
+                    break;
+                }
+            }
+            if (reverse == NO_EDGE) continue;
+            HierarchyEdge edge = { u, v, snapshot.arcCost[arc], NO_EDGE, NO_EDGE, NO_NODE, arc, reverse };
+            state.incident[u].push_back(edges.size());
+            state.incident[v].push_back(edges.size());
+            edges.push_back(edge);
+        }
+    }
+    stats.nodeCount = nodeCount;
+    stats.originalEdges = edges.size();
+
+    state.contracted.assign(nodeCount, false);
+    state.contractedNeighbors.assign(nodeCount, 0);
+    state.depth.assign(nodeCount, 0);
+    state.witnessDistance.assign(nodeCount, INFINITE_DISTANCE);
+    state.neighborEdge.assign(nodeCount, NO_EDGE);
+    state.witnessHeap.resize(nodeCount);
+    IndexedHeap order(nodeCount);
+    for (int v = 0; v < nodeCount; v++) {
+        order.pushOrDecrease(v, contractionPriority(state, edges, v));
+    }
+    rank.assign(nodeCount, 0);
+    int nextRank = 0;
+    vector<Neighbor> neighbors;
+    while (!order.isEmpty()) {
+        int v = order.popMin();
+        double priority = contractionPriority(state, edges, v);
+        if (!order.isEmpty() && priority > order.minKey()) {
+            order.pushOrDecrease(v, priority);
+            continue;
+        }
+        collectNeighbors(state, edges, v, neighbors);
+        contractNode(state, edges, v, false);
+        rank[v] = nextRank++;
+        for (size_t i = 0; i < neighbors.size(); i++) {
+            int u = neighbors[i].node;
+            order.pushOrDecrease(u, contractionPriority(state, edges, u));
+        }
+    }
+    stats.shortcutCount = edges.size() - stats.originalEdges;
+    buildUpwardGraph(nodeCount);
+    snapshotVersion = snapshot.version;
+    snapshotCostVersion = snapshot.costVersion;
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    stats.buildSeconds = elapsed.count();
+}
+
+/* Method: buildUpwardGraph
+ * Usage: buildUpwardGraph(nodeCount);
+ * -----------------------------------
+ * Stores every edge once, under its lower-ranked endpoint, in CSR
+ * form. Both query directions search this same graph.
+ */
+
+void ContractionHierarchy::buildUpwardGraph(int nodeCount) {
+    upOffset.assign(nodeCount + 1, 0);
+    for (size_t e = 0; e < edges.size(); e++) {
+        int low = (rank[edges[e].a] < rank[edges[e].b]) ? edges[e].a : edges[e].b;
+        upOffset[low + 1]++;
+    }
+    for (int v = 0; v < nodeCount; v++) {
+        upOffset[v + 1] += upOffset[v];
+    }
+    upTarget.resize(edges.size());
+    upCost.resize(edges.size());
+    upEdge.resize(edges.size());
+    vector<int> slot(upOffset.begin(), upOffset.end() - 1);
+    for (size_t e = 0; e < edges.size(); e++) {
+        int low = edges[e].a;
+        int high = edges[e].b;
+        if (rank[low] > rank[high]) swap(low, high);
+        int position = slot[low]++;
+        upTarget[position] = high;
+        upCost[position] = edges[e].cost;
+        upEdge[position] = e;
+    }
+    for (int side = FORWARD; side <= BACKWARD; side++) {
+        QueryDirection & direction = directions[side];
+        direction.distance.assign(nodeCount, INFINITE_DISTANCE);
+        direction.parentEdge.assign(nodeCount, NO_EDGE);
+        direction.parent.assign(nodeCount, NO_NODE);
+        direction.touched.clear();
+        direction.heap.resize(nodeCount);
+    }
+}
+
+bool ContractionHierarchy::isBuiltFor(const GraphSnapshot & snapshot) const {
+    return snapshotVersion == snapshot.version && snapshotCostVersion == snapshot.costVersion;
+}
+
+HierarchyStats ContractionHierarchy::getStats() const {
+    return stats;
+}
+
+int ContractionHierarchy::getLastSettledCount() const {
+    return lastSettledCount;
+}
+
+void ContractionHierarchy::resetQuery() {
+    for (int side = FORWARD; side <= BACKWARD; side++) {
+        QueryDirection & direction = directions[side];
+        for (size_t i = 0; i < direction.touched.size(); i++) {
+            int v = direction.touched[i];
+            direction.distance[v] = INFINITE_DISTANCE;
+            direction.parentEdge[v] = NO_EDGE;
+            direction.parent[v] = NO_NODE;
+        }
+        direction.touched.clear();
+        direction.heap.clear();
+    }
+}
+
+/* Method: settle
+ * Usage: settle(side, node);
+ * --------------------------
+ * Relaxes the upward edges of a node popped by one direction.
+ */
+
+void ContractionHierarchy::settle(int side, int node) {
+    QueryDirection & direction = directions[side];
+    double base = direction.distance[node];
+    for (int i = upOffset[node]; i < upOffset[node + 1]; i++) {
+        int next = upTarget[i];
+        double candidate = base + upCost[i];
+        if (candidate < direction.distance[next]) {
+            if (direction.distance[next] == INFINITE_DISTANCE) direction.touched.push_back(next);
+            direction.distance[next] = candidate;
+            direction.parentEdge[next] = upEdge[i];
+            direction.parent[next] = node;
+            direction.heap.pushOrDecrease(next, candidate);
+        }
+    }
+}
+
+/* Method: findPath
+ * ----------------
+ * The two searches take turns by smaller heap key. Every settled
+ * node that the other direction has reached is a candidate meeting
+ * point, and the search stops once neither heap can improve on the
+ * best candidate found.
+ */
+
+bool ContractionHierarchy::findPath(int source, int target, vector<int> & arcs) {
+    arcs.clear();
+    lastSettledCount = 0;
+    if (source == target) return true;
+    resetQuery();
+    int ends[2] = { source, target };
+    for (int side = FORWARD; side <= BACKWARD; side++) {
+        directions[side].distance[ends[side]] = 0;
+        directions[side].touched.push_back(ends[side]);
+        directions[side].heap.pushOrDecrease(ends[side], 0);
+    }
+    double best = INFINITE_DISTANCE;
+    int meeting = NO_NODE;
+    while (true) {
+        IndexedHeap & forward = directions[FORWARD].heap;
+        IndexedHeap & backward = directions[BACKWARD].heap;
+        double forwardKey = forward.isEmpty() ? INFINITE_DISTANCE : forward.minKey();
+        double backwardKey = backward.isEmpty() ? INFINITE_DISTANCE : backward.minKey();
+        if (forwardKey >= best && backwardKey >= best) break;
+        int side = (forwardKey <= backwardKey) ? FORWARD : BACKWARD;
+        int node = directions[side].heap.popMin();
+        lastSettledCount++;
+        double through = directions[FORWARD].distance[node] + directions[BACKWARD].distance[node];
+        if (through < best) {
+            best = through;
+            meeting = node;
+        }
+        settle(side, node);
+    }
+    if (meeting == NO_NODE) return false;
+    vector<int> upward;
+    for (int v = meeting; v != source; v = directions[FORWARD].parent[v]) {
+        upward.push_back(v);
+    }
+    for (int i = upward.size() - 1; i >= 0; i--) {
+        int v = upward[i];
+        unpackEdge(directions[FORWARD].parentEdge[v], directions[FORWARD].parent[v], arcs);
+    }
+    for (int v = meeting; v != target; v = directions[BACKWARD].parent[v]) {
+        unpackEdge(directions[BACKWARD].parentEdge[v], v, arcs);
+    }
+    return true;
+}
+
+/* Method: unpackEdge
+ * Usage: unpackEdge(edge, from, arcs);
+ * ------------------------------------
+ * Appends the snapshot arcs that edge stands for, traversed starting
+ * at its endpoint from. A shortcut expands into its two halves, in
+ * the order that keeps the walk connected.
+ */
+
+void ContractionHierarchy::unpackEdge(int edge, int from, vector<int> & arcs) const {
+    const HierarchyEdge & e = edges[edge];
+    if (e.first == NO_EDGE) {
+        arcs.push_back((from == e.a) ? e.arcForward : e.arcBackward);
+    } else if (from == e.a) {
+        unpackEdge(e.first, e.a, arcs);
+        unpackEdge(e.second, e.middle, arcs);
+    } else {
+        unpackEdge(e.second, e.b, arcs);
+        unpackEdge(e.first, e.middle, arcs);
+    }
+}
+
+ContractionHierarchy & getContractionHierarchy() {
+    static ContractionHierarchy hierarchy;
+    return hierarchy;
+}
@@ -0,0 +1,158 @@
+/*
+ * File: contraction.h
+ * -------------------
+ * This file exports the ContractionHierarchy class, an optional
+ * preprocessing stage for answering many point-to-point queries on
+ * the same map. Nodes are contracted one at a time in order of
+ * importance, and a shortcut arc is added whenever removing a node
+ * would lengthen a shortest path between two of its neighbors. A
+ * query then only has to search upward in that order from both ends.
+ *
+ * The hierarchy treats each pair of opposite arcs as one undirected
+ * edge, which matches the symmetric graphs loadMapFile builds.
+ */
+
+#ifndef _contraction_h
+#define _contraction_h
+
+#include <vector>
+#include "graphsnapshot.h"
+#include "indexedheap.h"
+
+/* Type: HierarchyStats
+ * --------------------
+ * Describes the result of the last build.
+ */
+
+struct HierarchyStats {
+    int nodeCount;
+    int originalEdges;
+    int shortcutCount;
+    double buildSeconds;
+};
+
+class ContractionHierarchy {
+
+public:
+
+/* Constructor: ContractionHierarchy
+ * Usage: ContractionHierarchy hierarchy;
+ * --------------------------------------
+ * Creates an empty hierarchy that matches no snapshot.
+ */
+
+    ContractionHierarchy();
+
+/* Method: build
+ * Usage: hierarchy.build(snapshot);
+ * ---------------------------------
+ * Contracts every node of snapshot and stores the upward search
+ * graph. The snapshot must outlive the hierarchy's use of it.
+ */
+
+    void build(const GraphSnapshot & snapshot);
+
+/* Method: clear
+ * Usage: hierarchy.clear();
+ * -------------------------
+ * Discards the hierarchy.
+ */
+
+    void clear();
+
+/* Method: isBuiltFor
+ * Usage: if (hierarchy.isBuiltFor(snapshot)) ...
+ * ----------------------------------------------
+ * Returns true if the hierarchy was built from this version of the
+ * snapshot, and its costs have not been edited since, and so can
+ * answer queries about it.
+ */
+
+    bool isBuiltFor(const GraphSnapshot & snapshot) const;
+
+/* Method: findPath
+ * Usage: if (hierarchy.findPath(source, target, arcs)) ...
+ * --------------------------------------------------------
+ * Finds a shortest path between two node IDs with a bidirectional
+ * upward search, then unpacks its shortcuts into snapshot arc
+ * indices, stored in arcs from source to target. Returns false if
+ * target cannot be reached. Queries reuse internal search arrays,
+ * so a hierarchy must not be queried from two threads at once.
+ */
+
+    bool findPath(int source, int target, std::vector<int> & arcs);
+
+/* Method: getStats
+ * Usage: HierarchyStats stats = hierarchy.getStats();
+ * ---------------------------------------------------
+ * Returns the statistics of the last build.
+ */
+
+    HierarchyStats getStats() const;
+
+/* Method: getLastSettledCount
+ * Usage: int settled = hierarchy.getLastSettledCount();
+ * -----------------------------------------------------
+ * Returns the number of nodes both directions of the last query
+ * settled together.
+ */
+
+    int getLastSettledCount() const;
+
+private:
+
+/* Type: HierarchyEdge
+ * -------------------
+ * An undirected edge between a and b. Original edges record the
+ * snapshot arc in each direction; shortcuts record the two edges
+ * they replace, first joining a to middle and second middle to b.
+ */
+
+    struct HierarchyEdge {
+        int a;
+        int b;
+        double cost;
+        int first;
+        int second;
+        int middle;
+        int arcForward;
+        int arcBackward;
+    };
+
+    struct QueryDirection {
+        std::vector<double> distance;
+        std::vector<int> parentEdge;
+        std::vector<int> parent;
+        std::vector<int> touched;
+        IndexedHeap heap;
+    };
+
+    std::vector<HierarchyEdge> edges;
+    std::vector<int> rank;
+    std::vector<int> upOffset;
+    std::vector<int> upTarget;
+    std::vector<double> upCost;
+    std::vector<int> upEdge;
+    QueryDirection directions[2];
+    HierarchyStats stats;
+    int snapshotVersion;
+    int snapshotCostVersion;
+    int lastSettledCount;
+
+    void buildUpwardGraph(int nodeCount);
+    void resetQuery();
+    void settle(int side, int node);
+    void unpackEdge(int edge, int from, std::vector<int> & arcs) const;
+
+};
+
+/* Function: getContractionHierarchy
+ * Usage: ContractionHierarchy & hierarchy = getContractionHierarchy();
+ * --------------------------------------------------------------------
+ * Returns the hierarchy shared by the interactive program, which the
+ * Hierarchy button builds for the current map.
+ */
+
+ContractionHierarchy & getContractionHierarchy();
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ * File: deltastepping.cpp
+ * -----------------------
+ * This file implements the delta-stepping engine. The work is split
+ * by owner: with k workers, node v belongs to task v % k, and only
+ * its owner ever writes its distance, parent or bucket entry. Each
+ * phase therefore runs in two parallel steps separated by the join
+ * at the end of parallelFor:
+ *
+ *      1) Every task scans the nodes it owns in the current bucket
+ *         and writes a relaxation request for each arc, sorted into
+ *         one list per owner of the arc's target.
+ *
+ *      2) Every task applies the requests addressed to it, in a fixed
+ *         order, moving improved nodes into their new buckets.
+ *
+ * No locks or atomics are needed, and the result is deterministic.
+ * The buckets are a ring just long enough to hold every distance
+ * between the current bucket and it plus the largest arc cost; stale
+ * entries are skipped when their node's distance no longer matches.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "deltastepping.h"
+#include "instrumentation.h"
+using namespace std;
+
+/* CONSTANTS */
+const int NO_ARC = -1;
+const double NOT_RELAXED = -1;
+const double TARGET_LIGHT_ARCS = 2;
+const int DELTA_SAMPLE_ARCS = 65536;
+const long long MAX_RING_BUCKETS = 1 << 16;
+
+
+/* Type: RelaxRequest
+ * ------------------
+ * An offer of distance to node, reached from from along arc.
+ */
+
+struct RelaxRequest {
+    int node;
+    int from;
+    int arc;
+    double distance;
+};
+
+/* Type: DeltaRun
+ * --------------
+ * The state of one search. Ring buckets, request lists and settled
+ * lists are indexed by task first, so each task touches only its own
+ * rows while it writes.
+ */
+
+struct DeltaRun {
+    const GraphSnapshot *graph;
+    ShortestPathTree *tree;
+    double delta;
+    int taskCount;
+    long long ringSize;
+    vector< vector< vector<int> > > ring;              /* [owner][slot] */
+    vector< vector< vector<RelaxRequest> > > requests; /* [producer][owner] */
+    vector< vector<int> > frontier;                    /* [owner] */
+    vector< vector<int> > settled;                     /* [owner] */
+    vector<double> relaxedAt;
+    vector<long long> settledIn;
+    vector<long long> relaxedArcs;                     /* [producer] */
+};
+
+
+double chooseDelta(const GraphSnapshot & graph) {
+    int arcCount = graph.arcCount();
+    if (arcCount == 0 || graph.nodeCount() == 0) return 1;
+    double maxCost = 0;
+    for (int arc = 0; arc < arcCount; arc++) {
+        maxCost = max(maxCost, graph.arcCost[arc]);
+    }
+    if (maxCost <= 0) return 1;
+    int stride = max(1, arcCount / DELTA_SAMPLE_ARCS);
+    vector<double> sample;
+    for (int arc = 0; arc < arcCount; arc += stride) {
+        sample.push_back(graph.arcCost[arc]);
+    }
+    sort(sample.begin(), sample.end());
+    double averageDegree = (double) arcCount / graph.nodeCount();
+    double quantile = min(1.0, TARGET_LIGHT_ARCS / averageDegree);
+    double delta = sample[(size_t) (quantile * (sample.size() - 1))];
+    return max(delta, maxCost / (MAX_RING_BUCKETS - 2));
+}
+
+/* Function: bucketOf
+ * Usage: long long bucket = bucketOf(run, distance);
+ * --------------------------------------------------
+ * Returns the number of the bucket that holds distance.
+ */
+
+static inline long long bucketOf(const DeltaRun & run, double distance) {
+    return (long long) floor(distance / run.delta);
+}
+
+/* Function: requestRelaxations
+ * Usage: requestRelaxations(run, task, node, light);
+ * --------------------------------------------------
+ * Writes one request per light (or per heavy) arc leaving node.
+ */
+
+static void requestRelaxations(DeltaRun & run, int task, int node, bool light) {
+    const GraphSnapshot & graph = *run.graph;
+    double base = run.tree->distance[node];
+    vector< vector<RelaxRequest> > & out = run.requests[task];
+    int end = graph.arcOffset[node + 1];
+    for (int arc = graph.arcOffset[node]; arc < end; arc++) {
+        double cost = graph.arcCost[arc];
+        if ((cost <= run.delta) != light) continue;
+        int next = graph.arcTarget[arc];
+        RelaxRequest request = { next, node, arc, base + cost };
+        out[next % run.taskCount].push_back(request);
+        run.relaxedArcs[task]++;
+    }
+}
+
+/* Function: applyRequests
+ * Usage: applyRequests(run, owner);
+ * ---------------------------------
+ * Applies every request addressed to owner, producer by producer.
+ */
+
+static void applyRequests(DeltaRun & run, int owner) {
+    ShortestPathTree & tree = *run.tree;
+    for (int producer = 0; producer < run.taskCount; producer++) {
+        vector<RelaxRequest> & incoming = run.requests[producer][owner];
+        for (size_t i = 0; i < incoming.size(); i++) {
+            const RelaxRequest & request = incoming[i];
+            if (request.distance >= tree.distance[request.node]) continue;
+            tree.distance[request.node] = request.distance;
+            tree.parent[request.node] = request.from;
+            tree.parentArc[request.node] = request.arc;
+            run.ring[owner][bucketOf(run, request.distance) % run.ringSize].push_back(request.node);
+        }
+        incoming.clear();
+    }
+}
+
+/* Function: bucketIsEmpty
+ * Usage: if (bucketIsEmpty(run, bucket)) ...
+ * ------------------------------------------
+ * Returns true if no owner has an entry in the ring slot of bucket.
+ */
+
+static bool bucketIsEmpty(const DeltaRun & run, long long bucket) {
+    long long slot = bucket % run.ringSize;
+    for (int owner = 0; owner < run.taskCount; owner++) {
+        if (!run.ring[owner][slot].empty()) return false;
+    }
+    return true;
+}
+
+/* Function: settleBucket
+ * Usage: settleBucket(run, pool, bucket, phases);
+ * -----------------------------------------------
+ * Relaxes light arcs out of bucket until it stays empty, then the
+ * heavy arcs of every node that passed through it.
+ */
+
+static void settleBucket(DeltaRun & run, ThreadPool & pool, long long bucket, long long & phases) {
+    long long slot = bucket % run.ringSize;
+    while (!bucketIsEmpty(run, bucket)) {
+        pool.parallelFor(run.taskCount, [&run, bucket, slot](int task, int) {
+            vector<int> & mine = run.frontier[task];
+            mine.swap(run.ring[task][slot]);
+            for (size_t i = 0; i < mine.size(); i++) {
+                int node = mine[i];
+                double distance = run.tree->distance[node];
+                if (bucketOf(run, distance) != bucket || run.relaxedAt[node] == distance) continue;
+                run.relaxedAt[node] = distance;
+                if (run.settledIn[node] != bucket) {
+                    run.settledIn[node] = bucket;
+                    run.settled[task].push_back(node);
+                }
+                requestRelaxations(run, task, node, true);
+            }
+            mine.clear();
+        });
+        pool.parallelFor(run.taskCount, [&run](int task, int) { applyRequests(run, task); });
+        phases++;
+    }
+    pool.parallelFor(run.taskCount, [&run](int task, int) {
+        vector<int> & mine = run.settled[task];
+        for (size_t i = 0; i < mine.size(); i++) {
+            requestRelaxations(run, task, mine[i], false);
+        }
+        mine.clear();
+    });
+    pool.parallelFor(run.taskCount, [&run](int task, int) { applyRequests(run, task); });
+    phases++;
+}
+
+DeltaSteppingStats computeShortestPathTree(const GraphSnapshot & graph, int source, ShortestPathTree & tree) {
+    return computeShortestPathTree(graph, source, tree, getSharedThreadPool(), 0);
+}
+
+DeltaSteppingStats computeShortestPathTree(const GraphSnapshot & graph, int source, ShortestPathTree & tree,
+                                           ThreadPool & pool, double delta) {
+    PhaseTimer timer("delta stepping");
+    int nodeCount = graph.nodeCount();
+    tree.distance.assign(nodeCount, INFINITE_DISTANCE);
+    tree.parent.assign(nodeCount, NO_NODE);
+    tree.parentArc.assign(nodeCount, NO_ARC);
+    DeltaSteppingStats stats = DeltaSteppingStats();
+    double maxCost = 0;
+    for (int arc = 0; arc < graph.arcCount(); arc++) {
+        maxCost = max(maxCost, graph.arcCost[arc]);
+    }
+    if (delta <= 0) delta = chooseDelta(graph);
+    stats.delta = max(delta, maxCost / (MAX_RING_BUCKETS - 2));
+    stats.threadCount = pool.size();
+    if (source < 0 || source >= nodeCount) return stats;
+
+    DeltaRun run;
+    run.graph = &graph;
+    run.tree = &tree;
+    run.delta = stats.delta;
+    run.taskCount = pool.size();
+    run.ringSize = (long long) floor(maxCost / run.delta) + 2;
+    run.ring.assign(run.taskCount, vector< vector<int> >(run.ringSize));
+    run.requests.assign(run.taskCount, vector< vector<RelaxRequest> >(run.taskCount));
+    run.frontier.assign(run.taskCount, vector<int>());
+    run.settled.assign(run.taskCount, vector<int>());
+    run.relaxedAt.assign(nodeCount, NOT_RELAXED);
+    run.settledIn.assign(nodeCount, -1);
+    run.relaxedArcs.assign(run.taskCount, 0);
+
+    tree.distance[source] = 0;
+    run.ring[source % run.taskCount][0].push_back(source);
+    long long bucket = 0;
+    while (true) {
+        long long next = bucket;
+        while (next < bucket + run.ringSize && bucketIsEmpty(run, next)) {
+            next++;
+        }
+        if (next == bucket + run.ringSize) break;
+        bucket = next;
+        settleBucket(run, pool, bucket, stats.phases);
+        stats.buckets++;
+    }
+    for (int task = 0; task < run.taskCount; task++) {
+        stats.relaxedArcs += run.relaxedArcs[task];
+    }
+    timer.setArg("threads", stats.threadCount);
+    timer.setArg("buckets", stats.buckets);
+    timer.setArg("relaxedArcs", stats.relaxedArcs);
+    if (isInstrumentationEnabled()) addToCounter(COUNTER_RELAXED_ARCS, stats.relaxedArcs);
+    return stats;
+}
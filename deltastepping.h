@@ -0,0 +1,78 @@
+/*
+ * File: deltastepping.h
+ * ---------------------
+ * This file exports a parallel single-source shortest-path engine
+ * based on Meyer and Sanders' delta-stepping algorithm. Nodes wait in
+ * buckets of width delta by tentative distance. All nodes of the
+ * lowest nonempty bucket are settled together: their light arcs (cost
+ * at most delta) are relaxed repeatedly until the bucket stops
+ * refilling, then their heavy arcs once. Every phase is spread over a
+ * ThreadPool, which suits one-to-all work such as isochrones, where
+ * the sequential heap in findShortestPath leaves the other cores idle.
+ */
+
+#ifndef _deltastepping_h
+#define _deltastepping_h
+
+#include <vector>
+#include "graphsnapshot.h"
+#include "threadpool.h"
+
+/* Type: ShortestPathTree
+ * ----------------------
+ * The result of a one-to-all search, indexed by node ID: the cost of
+ * the shortest path from the source (INFINITE_DISTANCE if none), and
+ * the node and snapshot arc it is reached through (NO_NODE and -1 for
+ * the source and for unreachable nodes).
+ */
+
+struct ShortestPathTree {
+    std::vector<double> distance;
+    std::vector<int> parent;
+    std::vector<int> parentArc;
+};
+
+/* Type: DeltaSteppingStats
+ * ------------------------
+ * Describes one search: the bucket width used, how many threads
+ * shared the work, how many buckets were settled, how many parallel
+ * phases that took, and how many arcs were relaxed.
+ */
+
+struct DeltaSteppingStats {
+    double delta;
+    int threadCount;
+    long long buckets;
+    long long phases;
+    long long relaxedArcs;
+};
+
+/* Function: chooseDelta
+ * Usage: double delta = chooseDelta(graph);
+ * -----------------------------------------
+ * Picks a bucket width from the distribution of arc costs: the cost
+ * below which an average node has about two light arcs. A smaller
+ * delta wastes phases on nearly empty buckets; a larger one
+ * relaxes arcs again and again as distances keep improving inside a
+ * bucket.
+ */
+
+double chooseDelta(const GraphSnapshot & graph);
+
+/* Function: computeShortestPathTree
+ * Usage: DeltaSteppingStats stats = computeShortestPathTree(graph, source, tree);
+ *        DeltaSteppingStats stats = computeShortestPathTree(graph, source, tree, pool, delta);
+ * ------------------------------------------------------------------------------------------
+ * Fills tree with the shortest paths from the node ID source to every
+ * node of the snapshot. The pool defaults to getSharedThreadPool(),
+ * and a delta that is not positive is replaced by chooseDelta(graph).
+ * A delta so small that the bucket ring would exceed 65536 buckets is
+ * raised to fit. The result depends only on the number of workers in
+ * the pool, not on how the threads happen to be scheduled.
+ */
+
+DeltaSteppingStats computeShortestPathTree(const GraphSnapshot & graph, int source, ShortestPathTree & tree);
+DeltaSteppingStats computeShortestPathTree(const GraphSnapshot & graph, int source, ShortestPathTree & tree,
+                                           ThreadPool & pool, double delta);
+
+#endif
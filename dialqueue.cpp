@@ -0,0 +1,46 @@
+/*
+ * File: dialqueue.cpp
+ * -------------------
+ * This file implements the DialQueue class. The bucket for key k is
+ * ring[k % ring.size()]; currentKey only moves forward.
+ */
+
+#include "dialqueue.h"
+using namespace std;
+
+DialQueue::DialQueue() {
+    reset(0);
+}
+
+void DialQueue::reset(unsigned maxCost) {
+    if (ring.size() == (size_t) maxCost + 1) {
+        for (size_t i = 0; i < ring.size(); i++) {
+            ring[i].clear();
+        }
+    } else {
+        ring.assign((size_t) maxCost + 1, vector<int>());
+    }
+    currentKey = 0;
+    count = 0;
+}
+
+bool DialQueue::isEmpty() const {
+    return count == 0;
+}
+
+void DialQueue::push(int id, unsigned long long key) {
+    ring[key % ring.size()].push_back(id);
+    count++;
+}
+
+int DialQueue::popMin(unsigned long long & key) {
+    while (ring[currentKey % ring.size()].empty()) {
+        currentKey++;
+    }
+    vector<int> & bucket = ring[currentKey % ring.size()];
+    int id = bucket.back();
+    bucket.pop_back();
+    count--;
+    key = currentKey;
+    return id;
+}
@@ -0,0 +1,74 @@
+/*
+ * File: dialqueue.h
+ * -----------------
+ * This file exports the DialQueue class, Dial's bucket queue for
+ * Dijkstra's algorithm on small integer arc costs. With costs of at
+ * most maxCost, every key in the queue lies within maxCost of the
+ * last key popped, so a ring of maxCost + 1 buckets indexed by key
+ * holds them all and both push and pop take constant time apart
+ * from skipping empty buckets.
+ */
+
+#ifndef _dialqueue_h
+#define _dialqueue_h
+
+#include <cstddef>
+#include <vector>
+
+class DialQueue {
+
+public:
+
+/* Constructor: DialQueue
+ * Usage: DialQueue queue;
+ * -----------------------
+ * Creates an empty queue for arc costs of at most 0.
+ */
+
+    DialQueue();
+
+/* Method: reset
+ * Usage: queue.reset(maxCost);
+ * ----------------------------
+ * Empties the queue and sizes its ring for arc costs of at most
+ * maxCost.
+ */
+
+    void reset(unsigned maxCost);
+
+/* Method: isEmpty
+ * Usage: if (queue.isEmpty()) ...
+ * -------------------------------
+ * Returns true if the queue has no entries.
+ */
+
+    bool isEmpty() const;
+
+/* Method: push
+ * Usage: queue.push(id, key);
+ * ---------------------------
+ * Adds id with the given key, which must lie between the last key
+ * popped and that key plus maxCost. As with RadixHeap, stale copies
+ * of an ID are left for the caller to skip.
+ */
+
+    void push(int id, unsigned long long key);
+
+/* Method: popMin
+ * Usage: int id = queue.popMin(key);
+ * ----------------------------------
+ * Removes an entry with the smallest key, stores the key in key, and
+ * returns its ID. The queue must not be empty.
+ */
+
+    int popMin(unsigned long long & key);
+
+private:
+
+    std::vector< std::vector<int> > ring;
+    unsigned long long currentKey;
+    size_t count;
+
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * File: disjointset.cpp
+ * ---------------------
+ * This file implements the DisjointSet class.
+ */
+
+#include "disjointset.h"
+using namespace std;
+
+DisjointSet::DisjointSet(int size) {
+    reset(size);
+}
+
+void DisjointSet::reset(int size) {
+    parent.resize(size);
+    for (int i = 0; i < size; i++) {
+        parent[i] = i;
+    }
+    rank.assign(size, 0);
+    setCount = size;
+    findCount = 0;
+    uniteCount = 0;
+}
+
+int DisjointSet::size() const {
+    return parent.size();
+}
+
+/* Method: find
+ * ------------
+ * The first loop locates the root; the second points every node on
+ * the way directly at it.
+ */
+
+int DisjointSet::find(int x) {
+    findCount++;
+    int root = x;
+    while (parent[root] != root) {
+        root = parent[root];
+    }
+    while (parent[x] != root) {
+        int next = parent[x];
+        parent[x] = root;
+        x = next;
+    }
+    return root;
+}
+
+bool DisjointSet::unite(int x, int y) {
+    uniteCount++;
+    x = find(x);
+    y = find(y);
+    if (x == y) return false;
+    if (rank[x] < rank[y]) {
+        parent[x] = y;
+    } else {
+        parent[y] = x;
+        if (rank[x] == rank[y]) rank[x]++;
+    }
+    setCount--;
+    return true;
+}
+
+int DisjointSet::countSets() const {
+    return setCount;
+}
+
+long long DisjointSet::getFindCount() const {
+    return findCount;
+}
+
+long long DisjointSet::getUniteCount() const {
+    return uniteCount;
+}
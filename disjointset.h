@@ -0,0 +1,89 @@
+/*
+ * File: disjointset.h
+ * -------------------
+ * This file exports the DisjointSet class, a union-find structure
+ * over the integers [0, size). It uses union by rank and path
+ * compression, so any sequence of operations runs in nearly
+ * constant amortized time per call.
+ */
+
+#ifndef _disjointset_h
+#define _disjointset_h
+
+#include <vector>
+
+class DisjointSet {
+
+public:
+
+/* Constructor: DisjointSet
+ * Usage: DisjointSet sets(size);
+ * ------------------------------
+ * Creates size singleton sets, one for each integer in [0, size).
+ */
+
+    DisjointSet(int size = 0);
+
+/* Method: reset
+ * Usage: sets.reset(size);
+ * ------------------------
+ * Discards the current sets and starts over with size singletons.
+ */
+
+    void reset(int size);
+
+/* Method: size
+ * Usage: int n = sets.size();
+ * ---------------------------
+ * Returns the number of elements (not the number of sets).
+ */
+
+    int size() const;
+
+/* Method: find
+ * Usage: int root = sets.find(x);
+ * -------------------------------
+ * Returns the representative of the set containing x, compressing
+ * the path from x to it along the way.
+ */
+
+    int find(int x);
+
+/* Method: unite
+ * Usage: if (sets.unite(x, y)) ...
+ * --------------------------------
+ * Merges the sets containing x and y. Returns false if they were
+ * already the same set.
+ */
+
+    bool unite(int x, int y);
+
+/* Method: countSets
+ * Usage: int components = sets.countSets();
+ * -----------------------------------------
+ * Returns the number of disjoint sets.
+ */
+
+    int countSets() const;
+
+/* Method: getFindCount, getUniteCount
+ * Usage: long long finds = sets.getFindCount();
+ * ---------------------------------------------
+ * Return the number of find and unite calls since the last reset,
+ * counting the two finds each unite makes.
+ */
+
+    long long getFindCount() const;
+    long long getUniteCount() const;
+
+private:
+
+    std::vector<int> parent;
+    std::vector<unsigned char> rank;
+    int setCount;
+    long long findCount;
+    long long uniteCount;
+
+};
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * File: distancematrix.cpp
+ * ------------------------
+ * This file implements the distance matrix. Each task fills one row,
+ * so threads never write to the same part of the result.
+ */
+
+#include "distancematrix.h"
+#include "instrumentation.h"
+#include "shortestpath.h"
+using namespace std;
+
+vector<double> computeDistanceMatrix(const GraphSnapshot & graph, const vector<int> & sources,
+                                     const vector<int> & targets) {
+    return computeDistanceMatrix(graph, sources, targets, getSharedThreadPool());
+}
+
+vector<double> computeDistanceMatrix(const GraphSnapshot & graph, const vector<int> & sources,
+                                     const vector<int> & targets, ThreadPool & pool) {
+    PhaseTimer timer("matrix");
+    timer.setArg("sources", sources.size());
+    timer.setArg("targets", targets.size());
+    int columns = targets.size();
+    vector<double> costs((size_t) sources.size() * columns, INFINITE_DISTANCE);
+    vector<char> isTarget(graph.nodeCount(), false);
+    int targetCount = 0;
+    for (int j = 0; j < columns; j++) {
+        if (!isTarget[targets[j]]) targetCount++;
+        isTarget[targets[j]] = true;
+    }
+    vector<SearchState> states(pool.size());
+    pool.parallelFor(sources.size(), [&](int row, int worker) {
+        SearchState & state = states[worker];
+        addToCounter(COUNTER_ALLOCATED_BYTES, prepareSearchState(graph, state));
+        searchToTargets(graph, state, sources[row], isTarget, targetCount);
+        for (int j = 0; j < columns; j++) {
+            costs[(size_t) row * columns + j] = state.distance[targets[j]];
+        }
+    });
+    return costs;
+}
@@ -0,0 +1,37 @@
+/*
+ * File: distancematrix.h
+ * ----------------------
+ * This file exports the many-to-many distance matrix API. Rather
+ * than one point-to-point search per pair of cities, it runs a single
+ * one-to-many search from each source that stops once every target is
+ * settled, and spreads the sources over a ThreadPool. The snapshot is
+ * shared read-only between the threads; each worker keeps one
+ * SearchState that it reuses for all the sources it handles.
+ */
+
+#ifndef _distancematrix_h
+#define _distancematrix_h
+
+#include <vector>
+#include "graphsnapshot.h"
+#include "threadpool.h"
+
+/* Function: computeDistanceMatrix
+ * Usage: vector<double> costs = computeDistanceMatrix(graph, sources, targets);
+ *        vector<double> costs = computeDistanceMatrix(graph, sources, targets, pool);
+ * --------------------------------------------------------------------------------
+ * Returns the shortest-path cost from every source node ID to every
+ * target node ID, in row-major order: the cost from sources[i] to
+ * targets[j] is at index i * targets.size() + j. Unreachable pairs
+ * cost INFINITE_DISTANCE. The pool defaults to getSharedThreadPool().
+ */
+
+std::vector<double> computeDistanceMatrix(const GraphSnapshot & graph,
+                                          const std::vector<int> & sources,
+                                          const std::vector<int> & targets);
+std::vector<double> computeDistanceMatrix(const GraphSnapshot & graph,
+                                          const std::vector<int> & sources,
+                                          const std::vector<int> & targets,
+                                          ThreadPool & pool);
+
+#endif
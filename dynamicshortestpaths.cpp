@@ -0,0 +1,333 @@
+/*
+ * File: dynamicshortestpaths.cpp
+ * ------------------------------
+ * This file implements the DynamicShortestPaths class. Building a
+ * tree and repairing one share the same loop: nodes wait in an
+ * IndexedHeap keyed by tentative distance, and every improvement
+ * moves the node under its new parent. A repair seeds the heap with
+ * the nodes the changed arc can affect and, when the arc got more
+ * expensive, keeps the search inside the subtree it cut loose.
+ */
+
+#include <chrono>
+#include "dynamicshortestpaths.h"
+#include "instrumentation.h"
+using namespace std;
+
+/* CONSTANTS */
+const int NO_ARC = -1;
+
+
+DynamicShortestPaths::DynamicShortestPaths() {
+    arcVersion = -1;
+    affectedStamp = 0;
+    stats = DynamicPathStats();
+}
+
+void DynamicShortestPaths::track(const GraphSnapshot & graph, int source) {
+    if (findTree(graph, source) != NULL) return;
+    trees.push_back(Tree());
+    trees.back().source = graph.nodes[source];
+    buildTree(graph, trees.back());
+}
+
+void DynamicShortestPaths::clear() {
+    trees.clear();
+    arcSource.clear();
+    inOffset.clear();
+    inArcs.clear();
+    affectedMark.clear();
+    arcVersion = -1;
+    heap.resize(0);
+    stats = DynamicPathStats();
+}
+
+bool DynamicShortestPaths::isTracked(const GraphSnapshot & graph, int source) const {
+    for (size_t i = 0; i < trees.size(); i++) {
+        if (trees[i].source == graph.nodes[source]) return true;
+    }
+    return false;
+}
+
+/* Method: findPath
+ * ----------------
+ * The walk stops after nodeCount arcs, so a parent cycle left by a
+ * faulty repair gives a broken path instead of an endless loop.
+ */
+
+bool DynamicShortestPaths::findPath(const GraphSnapshot & graph, int source, int target, Path & path) {
+    Tree *tree = findTree(graph, source);
+    if (tree == NULL) return false;
+    if (tree->distance[target] == INFINITE_DISTANCE) return true;
+    vector<Arc *> reversed;
+    for (int id = target; tree->parentArc[id] != NO_ARC && (int) reversed.size() < graph.nodeCount();
+         id = arcSource[tree->parentArc[id]]) {
+        reversed.push_back(graph.arcs[tree->parentArc[id]]);
+    }
+    for (int i = reversed.size() - 1; i >= 0; i--) {
+        path.add(reversed[i]);
+    }
+    return true;
+}
+
+const vector<double> *DynamicShortestPaths::getDistances(const GraphSnapshot & graph, int source) {
+    Tree *tree = findTree(graph, source);
+    return (tree == NULL) ? NULL : &tree->distance;
+}
+
+/* Method: repairArc
+ * -----------------
+ * Trees built for an older snapshot are skipped; findTree rebuilds
+ * them when they are next used.
+ */
+
+void DynamicShortestPaths::repairArc(const GraphSnapshot & graph, int arc, double oldCost) {
+    if (trees.empty()) return;
+    PhaseTimer timer("shortest path tree repair");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    prepareArcs(graph);
+    double newCost = graph.arcCost[arc];
+    for (size_t i = 0; i < trees.size(); i++) {
+        Tree & tree = trees[i];
+        if (tree.version != graph.version) continue;
+        if (newCost < oldCost) {
+            lowerArc(graph, tree, arc);
+        } else if (newCost > oldCost) {
+            raiseTreeArc(graph, tree, arc);
+        }
+        stats.updates++;
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    stats.repairSeconds += elapsed.count();
+}
+
+vector<Node *> DynamicShortestPaths::getSources() const {
+    vector<Node *> sources;
+    for (size_t i = 0; i < trees.size(); i++) {
+        sources.push_back(trees[i].source);
+    }
+    return sources;
+}
+
+DynamicPathStats DynamicShortestPaths::getStats() const {
+    DynamicPathStats result = stats;
+    result.trackedTrees = trees.size();
+    return result;
+}
+
+/* Method: findTree
+ * Usage: Tree *tree = findTree(graph, source);
+ * --------------------------------------------
+ * Returns the tree of the node ID source, rebuilt first if it belongs
+ * to an older snapshot, or NULL if source is not tracked.
+ */
+
+DynamicShortestPaths::Tree *DynamicShortestPaths::findTree(const GraphSnapshot & graph, int source) {
+    for (size_t i = 0; i < trees.size(); i++) {
+        Tree & tree = trees[i];
+        if (tree.source != graph.nodes[source]) continue;
+        if (tree.version != graph.version) buildTree(graph, tree);
+        return &tree;
+    }
+    return NULL;
+}
+
+/* Method: prepareArcs
+ * Usage: prepareArcs(graph);
+ * --------------------------
+ * Builds the start of every arc and the incoming arcs of every node
+ * once per snapshot version, with the same two-pass counting that
+ * buildGraphSnapshot uses for the outgoing ones.
+ */
+
+void DynamicShortestPaths::prepareArcs(const GraphSnapshot & graph) {
+    if (arcVersion == graph.version) return;
+    int nodeCount = graph.nodeCount();
+    int arcCount = graph.arcCount();
+    arcSource.resize(arcCount);
+    inOffset.assign(nodeCount + 1, 0);
+    for (int u = 0; u < nodeCount; u++) {
+        for (int arc = graph.arcOffset[u]; arc < graph.arcOffset[u + 1]; arc++) {
+            arcSource[arc] = u;
+            inOffset[graph.arcTarget[arc] + 1]++;
+        }
+    }
+    for (int v = 0; v < nodeCount; v++) {
+        inOffset[v + 1] += inOffset[v];
+    }
+    inArcs.resize(arcCount);
+    vector<int> slot(inOffset.begin(), inOffset.end() - 1);
+    for (int arc = 0; arc < arcCount; arc++) {
+        inArcs[slot[graph.arcTarget[arc]]++] = arc;
+    }
+    affectedMark.assign(nodeCount, 0);
+    affectedStamp = 0;
+    heap.resize(nodeCount);
+    arcVersion = graph.version;
+}
+
+/* Method: buildTree
+ * Usage: buildTree(graph, tree);
+ * ------------------------------
+ * Computes tree from scratch for the current snapshot.
+ */
+
+void DynamicShortestPaths::buildTree(const GraphSnapshot & graph, Tree & tree) {
+    PhaseTimer timer("shortest path tree build");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    prepareArcs(graph);
+    int nodeCount = graph.nodeCount();
+    tree.root = snapshotNodeId(graph, tree.source);
+    tree.version = graph.version;
+    tree.distance.assign(nodeCount, INFINITE_DISTANCE);
+    tree.parentArc.assign(nodeCount, NO_ARC);
+    tree.firstChild.assign(nodeCount, NO_NODE);
+    tree.nextSibling.assign(nodeCount, NO_NODE);
+    tree.previousSibling.assign(nodeCount, NO_NODE);
+    tree.distance[tree.root] = 0;
+    heap.pushOrDecrease(tree.root, 0);
+    long long scannedArcs = 0;
+    settle(graph, tree, false, scannedArcs);
+    stats.rebuilds++;
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    stats.rebuildSeconds += elapsed.count();
+}
+
+/* Method: setParent
+ * Usage: setParent(tree, node, arc);
+ * ----------------------------------
+ * Moves node from the child list of its current parent, if any, to
+ * that of the start of arc. An arc of NO_ARC leaves node detached.
+ */
+
+void DynamicShortestPaths::setParent(Tree & tree, int node, int arc) {
+    int oldArc = tree.parentArc[node];
+    if (oldArc != NO_ARC) {
+        int previous = tree.previousSibling[node];
+        int next = tree.nextSibling[node];
+        if (previous == NO_NODE) {
+            tree.firstChild[arcSource[oldArc]] = next;
+        } else {
+            tree.nextSibling[previous] = next;
+        }
+        if (next != NO_NODE) tree.previousSibling[next] = previous;
+    }
+    tree.parentArc[node] = arc;
+    tree.previousSibling[node] = NO_NODE;
+    tree.nextSibling[node] = NO_NODE;
+    if (arc == NO_ARC) return;
+    int parent = arcSource[arc];
+    int first = tree.firstChild[parent];
+    tree.nextSibling[node] = first;
+    if (first != NO_NODE) tree.previousSibling[first] = node;
+    tree.firstChild[parent] = node;
+}
+
+/* Method: settle
+ * Usage: int settled = settle(graph, tree, affectedOnly, scannedArcs);
+ * --------------------------------------------------------------------
+ * Runs Dijkstra's algorithm on tree from the nodes already in the
+ * heap until it is empty. If affectedOnly is set, only nodes marked
+ * with the current affectedStamp may be improved. Returns the number
+ * of nodes settled and adds the arcs scanned to scannedArcs.
+ */
+
+int DynamicShortestPaths::settle(const GraphSnapshot & graph, Tree & tree, bool affectedOnly,
+                                 long long & scannedArcs) {
+    int settled = 0;
+    while (!heap.isEmpty()) {
+        int current = heap.popMin();
+        settled++;
+        double base = tree.distance[current];
+        int end = graph.arcOffset[current + 1];
+        scannedArcs += end - graph.arcOffset[current];
+        for (int arc = graph.arcOffset[current]; arc < end; arc++) {
+            int next = graph.arcTarget[arc];
+            if (affectedOnly && affectedMark[next] != affectedStamp) continue;
+            double candidate = base + graph.arcCost[arc];
+            if (candidate < tree.distance[next]) {
+                tree.distance[next] = candidate;
+                setParent(tree, next, arc);
+                heap.pushOrDecrease(next, candidate);
+            }
+        }
+    }
+    return settled;
+}
+
+/* Method: lowerArc
+ * Usage: lowerArc(graph, tree, arc);
+ * ----------------------------------
+ * Repairs tree after arc became cheaper. Only a strict improvement
+ * reparents a node, so a node never ends up below its own subtree.
+ */
+
+void DynamicShortestPaths::lowerArc(const GraphSnapshot & graph, Tree & tree, int arc) {
+    int u = arcSource[arc];
+    int v = graph.arcTarget[arc];
+    if (tree.distance[u] == INFINITE_DISTANCE) return;
+    double candidate = tree.distance[u] + graph.arcCost[arc];
+    if (candidate >= tree.distance[v]) return;
+    tree.distance[v] = candidate;
+    setParent(tree, v, arc);
+    heap.pushOrDecrease(v, candidate);
+    long long scannedArcs = 0;
+    stats.repairedNodes += settle(graph, tree, false, scannedArcs);
+    stats.scannedArcs += scannedArcs;
+}
+
+/* Method: raiseTreeArc
+ * Usage: raiseTreeArc(graph, tree, arc);
+ * --------------------------------------
+ * Repairs tree after arc became more expensive. Distances outside
+ * the subtree below arc cannot change, since none of their tree
+ * paths use it, so only the subtree is detached and searched again,
+ * starting from the best arc into each of its nodes from outside.
+ */
+
+void DynamicShortestPaths::raiseTreeArc(const GraphSnapshot & graph, Tree & tree, int arc) {
+    int v = graph.arcTarget[arc];
+    if (tree.parentArc[v] != arc) return;
+    affectedStamp++;
+    affected.clear();
+    affected.push_back(v);
+    affectedMark[v] = affectedStamp;
+    for (size_t i = 0; i < affected.size(); i++) {
+        for (int child = tree.firstChild[affected[i]]; child != NO_NODE; child = tree.nextSibling[child]) {
+            affectedMark[child] = affectedStamp;
+            affected.push_back(child);
+        }
+    }
+    for (size_t i = 0; i < affected.size(); i++) {
+        setParent(tree, affected[i], NO_ARC);
+        tree.distance[affected[i]] = INFINITE_DISTANCE;
+    }
+    long long scannedArcs = 0;
+    for (size_t i = 0; i < affected.size(); i++) {
+        int node = affected[i];
+        int bestArc = NO_ARC;
+        double best = INFINITE_DISTANCE;
+        scannedArcs += inOffset[node + 1] - inOffset[node];
+        for (int slot = inOffset[node]; slot < inOffset[node + 1]; slot++) {
+            int incoming = inArcs[slot];
+            int from = arcSource[incoming];
+            if (affectedMark[from] == affectedStamp) continue;
+            double candidate = tree.distance[from] + graph.arcCost[incoming];
+            if (candidate < best) {
+                best = candidate;
+                bestArc = incoming;
+            }
+        }
+        if (bestArc == NO_ARC) continue;
+        tree.distance[node] = best;
+        setParent(tree, node, bestArc);
+        heap.pushOrDecrease(node, best);
+    }
+    stats.repairedNodes += settle(graph, tree, true, scannedArcs);
+    stats.scannedArcs += scannedArcs;
+}
+
+DynamicShortestPaths & getDynamicShortestPaths() {
+    static DynamicShortestPaths paths;
+    return paths;
+}
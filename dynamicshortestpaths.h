@@ -0,0 +1,188 @@
+/*
+ * File: dynamicshortestpaths.h
+ * ----------------------------
+ * This file exports the DynamicShortestPaths class, which keeps the
+ * shortest-path trees of a few tracked sources correct while arc
+ * costs change, in the style of Ramalingam and Reps, instead of
+ * searching the whole map again after every change:
+ *
+ *    - An arc that became cheaper can only improve the nodes it now
+ *      leads to more cheaply. They are found by a Dijkstra search
+ *      that starts at the arc's finish and goes no further than the
+ *      improvements do.
+ *
+ *    - An arc that became more expensive only matters if it is in
+ *      the tree. Then the subtree below it is cut loose, each of its
+ *      nodes is offered the best arc from outside the subtree, and a
+ *      Dijkstra search confined to the subtree settles the rest.
+ *
+ * Either way the work grows with the nodes whose distances change
+ * and their arcs, not with the size of the map, and a query from a
+ * tracked source only walks the tree back from its finish. Each
+ * tree costs about 24 bytes per node of the map.
+ */
+
+#ifndef _dynamicshortestpaths_h
+#define _dynamicshortestpaths_h
+
+#include <vector>
+#include "graphsnapshot.h"
+#include "graphtypes.h"
+#include "indexedheap.h"
+#include "path.h"
+
+/* Type: DynamicPathStats
+ * ----------------------
+ * Describes the tracked trees and the work done to maintain them.
+ * An update is one changed arc applied to one tree; repairedNodes
+ * counts the nodes the repairs settled and scannedArcs the arcs they
+ * looked at. A rebuild is a full search, made when a source is first
+ * tracked or the snapshot has been rebuilt since.
+ */
+
+struct DynamicPathStats {
+    int trackedTrees;
+    long long updates;
+    long long repairedNodes;
+    long long scannedArcs;
+    long long rebuilds;
+    double repairSeconds;
+    double rebuildSeconds;
+};
+
+class DynamicShortestPaths {
+
+public:
+
+/* Constructor: DynamicShortestPaths
+ * Usage: DynamicShortestPaths paths;
+ * ----------------------------------
+ * Creates an object that tracks no sources.
+ */
+
+    DynamicShortestPaths();
+
+/* Method: track
+ * Usage: paths.track(graph, source);
+ * ----------------------------------
+ * Starts maintaining the shortest-path tree from the node ID source
+ * of graph, building it now if it is not already tracked.
+ */
+
+    void track(const GraphSnapshot & graph, int source);
+
+/* Method: clear
+ * Usage: paths.clear();
+ * ---------------------
+ * Stops tracking every source. This must happen before the graph
+ * frees its nodes.
+ */
+
+    void clear();
+
+/* Method: isTracked
+ * Usage: if (paths.isTracked(graph, source)) ...
+ * ----------------------------------------------
+ * Returns true if the node ID source of graph is a tracked source.
+ */
+
+    bool isTracked(const GraphSnapshot & graph, int source) const;
+
+/* Method: findPath
+ * Usage: if (paths.findPath(graph, source, target, path)) ...
+ * -----------------------------------------------------------
+ * Reads the shortest path from source to target off the tree of a
+ * tracked source and adds its arcs to path, which stays empty if
+ * target is unreachable. Returns false if source is not tracked.
+ */
+
+    bool findPath(const GraphSnapshot & graph, int source, int target, Path & path);
+
+/* Method: getDistances
+ * Usage: const std::vector<double> *distance = paths.getDistances(graph, source);
+ * -------------------------------------------------------------------------------
+ * Returns the distances from a tracked source to every node ID of
+ * graph (INFINITE_DISTANCE if unreachable), or NULL if source is not
+ * tracked. The array changes with the next update.
+ */
+
+    const std::vector<double> *getDistances(const GraphSnapshot & graph, int source);
+
+/* Method: repairArc
+ * Usage: paths.repairArc(graph, arc, oldCost);
+ * --------------------------------------------
+ * Repairs every tracked tree after the cost of the snapshot arc arc
+ * has changed from oldCost to the value now in graph.arcCost.
+ */
+
+    void repairArc(const GraphSnapshot & graph, int arc, double oldCost);
+
+/* Method: getSources
+ * Usage: std::vector<Node *> sources = paths.getSources();
+ * --------------------------------------------------------
+ * Returns the tracked sources in the order they were first tracked.
+ */
+
+    std::vector<Node *> getSources() const;
+
+/* Method: getStats
+ * Usage: DynamicPathStats stats = paths.getStats();
+ * -------------------------------------------------
+ * Returns the number of tracked trees and the work done so far.
+ */
+
+    DynamicPathStats getStats() const;
+
+private:
+
+/* Type: Tree
+ * ----------
+ * The shortest-path tree of one source. Each node's children form a
+ * doubly linked list through nextSibling and previousSibling, so a
+ * node can be moved to another parent in constant time and a subtree
+ * can be listed without scanning the map.
+ */
+
+    struct Tree {
+        Node *source;
+        int root;
+        int version;
+        std::vector<double> distance;
+        std::vector<int> parentArc;
+        std::vector<int> firstChild;
+        std::vector<int> nextSibling;
+        std::vector<int> previousSibling;
+    };
+
+    std::vector<Tree> trees;
+    std::vector<int> arcSource;         /* the start of each snapshot arc */
+    std::vector<int> inOffset;          /* incoming arcs, laid out like arcOffset */
+    std::vector<int> inArcs;
+    int arcVersion;
+    IndexedHeap heap;
+    std::vector<int> affected;
+    std::vector<int> affectedMark;
+    int affectedStamp;
+    DynamicPathStats stats;
+
+    Tree *findTree(const GraphSnapshot & graph, int source);
+    void prepareArcs(const GraphSnapshot & graph);
+    void buildTree(const GraphSnapshot & graph, Tree & tree);
+    void setParent(Tree & tree, int node, int arc);
+    int settle(const GraphSnapshot & graph, Tree & tree, bool affectedOnly, long long & scannedArcs);
+    void lowerArc(const GraphSnapshot & graph, Tree & tree, int arc);
+    void raiseTreeArc(const GraphSnapshot & graph, Tree & tree, int arc);
+
+};
+
+/* Function: getDynamicShortestPaths
+ * Usage: DynamicShortestPaths & paths = getDynamicShortestPaths();
+ * ----------------------------------------------------------------
+ * Returns the tracked trees shared by the program. findShortestPath
+ * answers Dijkstra queries from their sources, and
+ * updateSnapshotCosts in graphsnapshot.h repairs them.
+ */
+
+DynamicShortestPaths & getDynamicShortestPaths();
+
+#endif
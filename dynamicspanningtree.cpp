@@ -0,0 +1,354 @@
+/*
+ * File: dynamicspanningtree.cpp
+ * -----------------------------
+ * This file implements the DynamicSpanningTree class. Roads are
+ * ordered by cost and then by ID, so the forest is unique even when
+ * costs tie; the LinkCutForest breaks ties the same way because road
+ * elements are numbered in ID order.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include "dynamicspanningtree.h"
+#include "disjointset.h"
+#include "instrumentation.h"
+using namespace std;
+
+/* CONSTANTS */
+const int NO_ROAD = -1;
+
+
+DynamicSpanningTree::DynamicSpanningTree() {
+    graph = NULL;
+    visitStamp = 0;
+    stats = DynamicTreeStats();
+}
+
+void DynamicSpanningTree::build(MapGraph & graph, const GraphSnapshot & snapshot) {
+    PhaseTimer timer("dynamic mst build");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    clear();
+    this->graph = &graph;
+    int nodeCount = snapshot.nodeCount();
+    nodes = snapshot.nodes;
+    nodeIds.reserve(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        nodeIds[nodes[i]] = i;
+    }
+    forest.reset(nodeCount);
+    incident.assign(nodeCount, vector<int>());
+    visitMark.assign(nodeCount, 0);
+    roads.reserve(snapshot.arcCount() / 2);
+    roadIds.reserve(snapshot.arcCount());
+    vector<char> paired(snapshot.arcCount(), false);
+    for (int u = 0; u < nodeCount; u++) {
+        for (int arc = snapshot.arcOffset[u]; arc < snapshot.arcOffset[u + 1]; arc++) {
+            int v = snapshot.arcTarget[arc];
+            if (u > v || paired[arc]) continue;
+            int reverse = NO_ROAD;
+            for (int back = snapshot.arcOffset[v]; back < snapshot.arcOffset[v + 1]; back++) {
+                if (back != arc && !paired[back] && snapshot.arcTarget[back] == u
+                    && snapshot.arcCost[back] == snapshot.arcCost[arc]) {
+                    reverse = back;
+                    break;
+                }
+            }
+            if (reverse == NO_ROAD) continue;
+            paired[arc] = paired[reverse] = true;
+            newRoad(u, v, snapshot.arcCost[arc], snapshot.arcs[arc], snapshot.arcs[reverse]);
+        }
+    }
+    stats.unpairedArcs = count(paired.begin(), paired.end(), false);
+    vector<int> order(roads.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [this](int a, int b) { return lighter(a, b); });
+    DisjointSet components(nodeCount);
+    for (size_t i = 0; i < order.size(); i++) {
+        if (components.unite(roads[order[i]].u, roads[order[i]].v)) linkRoad(order[i]);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    stats.buildSeconds = elapsed.count();
+    timer.setArg("roads", roads.size());
+    timer.setArg("unpaired", stats.unpairedArcs);
+}
+
+void DynamicSpanningTree::clear() {
+    graph = NULL;
+    nodes.clear();
+    nodeIds.clear();
+    roadIds.clear();
+    roads.clear();
+    freeRoads.clear();
+    incident.clear();
+    forest.reset(0);
+    visitMark.clear();
+    visitStamp = 0;
+    stats = DynamicTreeStats();
+}
+
+bool DynamicSpanningTree::isBuilt() const {
+    return graph != NULL;
+}
+
+Arc *DynamicSpanningTree::findRoad(Node *one, Node *two) const {
+    unordered_map<Node *, int>::const_iterator from = nodeIds.find(one);
+    unordered_map<Node *, int>::const_iterator to = nodeIds.find(two);
+    if (from == nodeIds.end() || to == nodeIds.end()) return NULL;
+    Arc *best = NULL;
+    const vector<int> & candidates = incident[from->second];
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const Road & road = roads[candidates[i]];
+        Arc *arc = (road.u == from->second) ? road.forward : road.backward;
+        if (arc->finish == two && (best == NULL || arc->cost < best->cost)) best = arc;
+    }
+    return best;
+}
+
+Arc *DynamicSpanningTree::addRoad(Node *one, Node *two, double cost) {
+    unordered_map<Node *, int>::const_iterator from = nodeIds.find(one);
+    unordered_map<Node *, int>::const_iterator to = nodeIds.find(two);
+    if (graph == NULL || from == nodeIds.end() || to == nodeIds.end()) return NULL;
+    PhaseTimer timer("dynamic mst update");
+    Arc *forward = graph->addArc(one, two, cost);
+    Arc *backward = graph->addArc(two, one, cost);
+    int road = newRoad(from->second, to->second, cost, forward, backward);
+    offerRoad(road);
+    stats.updates++;
+    return forward;
+}
+
+bool DynamicSpanningTree::removeRoad(Arc *arc) {
+    unordered_map<Arc *, int>::iterator entry = roadIds.find(arc);
+    if (entry == roadIds.end()) return false;
+    PhaseTimer timer("dynamic mst update");
+    int id = entry->second;
+    Road & road = roads[id];
+    road.live = false;
+    roadIds.erase(road.forward);
+    roadIds.erase(road.backward);
+    detachRoad(id);
+    if (road.inTree) replaceTreeRoad(id);
+    graph->removeArc(road.forward);
+    graph->removeArc(road.backward);
+    road.forward = road.backward = NULL;
+    freeRoads.push_back(id);
+    stats.updates++;
+    return true;
+}
+
+/* Method: setRoadCost
+ * -------------------
+ * Only two of the four cases can change the forest: a tree road
+ * that became more expensive may lose its place to a road across
+ * its cut, and a road outside the tree that became cheaper may take
+ * the place of the most expensive road on its cycle.
+ */
+
+bool DynamicSpanningTree::setRoadCost(Arc *arc, double cost) {
+    unordered_map<Arc *, int>::iterator entry = roadIds.find(arc);
+    if (entry == roadIds.end()) return false;
+    PhaseTimer timer("dynamic mst update");
+    int id = entry->second;
+    Road & road = roads[id];
+    double oldCost = road.cost;
+    road.cost = cost;
+    road.forward->cost = cost;
+    road.backward->cost = cost;
+    forest.setValue(nodes.size() + id, cost);
+    if (road.inTree) {
+        stats.treeCost += cost - oldCost;
+        if (cost > oldCost) replaceTreeRoad(id);
+    } else if (cost < oldCost) {
+        offerRoad(id);
+    }
+    stats.updates++;
+    return true;
+}
+
+bool DynamicSpanningTree::isTreeRoad(Arc *arc) const {
+    unordered_map<Arc *, int>::const_iterator entry = roadIds.find(arc);
+    return entry != roadIds.end() && roads[entry->second].inTree;
+}
+
+Path DynamicSpanningTree::getTree() const {
+    vector<int> treeRoads;
+    for (size_t i = 0; i < roads.size(); i++) {
+        if (roads[i].live && roads[i].inTree) treeRoads.push_back(i);
+    }
+    sort(treeRoads.begin(), treeRoads.end(), [this](int a, int b) { return lighter(a, b); });
+    Path tree;
+    for (size_t i = 0; i < treeRoads.size(); i++) {
+        tree.add(roads[treeRoads[i]].forward);
+    }
+    return tree;
+}
+
+DynamicTreeStats DynamicSpanningTree::getStats() const {
+    DynamicTreeStats result = stats;
+    result.roadCount = roads.size() - freeRoads.size();
+    return result;
+}
+
+/* Method: newRoad
+ * ---------------
+ * Records a road outside the tree, reusing the slot of a closed road
+ * if there is one, and returns its ID.
+ */
+
+int DynamicSpanningTree::newRoad(int u, int v, double cost, Arc *forward, Arc *backward) {
+    Road road = { u, v, cost, forward, backward, true, false };
+    int id;
+    if (freeRoads.empty()) {
+        id = roads.size();
+        roads.push_back(road);
+        forest.grow(nodes.size() + roads.size());
+    } else {
+        id = freeRoads.back();
+        freeRoads.pop_back();
+        roads[id] = road;
+    }
+    forest.setValue(nodes.size() + id, cost);
+    roadIds[forward] = id;
+    roadIds[backward] = id;
+    incident[u].push_back(id);
+    if (v != u) incident[v].push_back(id);
+    return id;
+}
+
+bool DynamicSpanningTree::lighter(int a, int b) const {
+    if (roads[a].cost != roads[b].cost) return roads[a].cost < roads[b].cost;
+    return a < b;
+}
+
+void DynamicSpanningTree::linkRoad(int road) {
+    int element = nodes.size() + road;
+    forest.link(roads[road].u, element);
+    forest.link(element, roads[road].v);
+    roads[road].inTree = true;
+    stats.treeRoads++;
+    stats.treeCost += roads[road].cost;
+}
+
+void DynamicSpanningTree::cutRoad(int road) {
+    int element = nodes.size() + road;
+    forest.cut(roads[road].u, element);
+    forest.cut(element, roads[road].v);
+    roads[road].inTree = false;
+    stats.treeRoads--;
+    stats.treeCost -= roads[road].cost;
+}
+
+/* Method: offerRoad
+ * -----------------
+ * Adds a road outside the tree to the forest if it joins two trees
+ * or is cheaper than the most expensive road on the cycle it closes.
+ */
+
+void DynamicSpanningTree::offerRoad(int road) {
+    int u = roads[road].u;
+    int v = roads[road].v;
+    if (u == v) return;
+    if (!forest.connected(u, v)) {
+        linkRoad(road);
+        return;
+    }
+    int heaviest = forest.heaviestOnPath(u, v) - nodes.size();
+    if (lighter(road, heaviest)) {
+        cutRoad(heaviest);
+        linkRoad(road);
+    }
+}
+
+/* Method: replaceTreeRoad
+ * -----------------------
+ * Cuts a tree road out and links the cheapest live road across the
+ * cut, which may be the same road again if it is still live.
+ */
+
+void DynamicSpanningTree::replaceTreeRoad(int road) {
+    cutRoad(road);
+    int replacement = findReplacement(roads[road].u, roads[road].v);
+    if (replacement != NO_ROAD) linkRoad(replacement);
+}
+
+/* Method: findReplacement
+ * -----------------------
+ * Grows the trees of u and v, which were just separated, one node at
+ * a time along tree roads. The first to run out is the smaller half;
+ * the cheapest live road leaving it is the answer.
+ */
+
+int DynamicSpanningTree::findReplacement(int u, int v) {
+    stats.replacementSearches++;
+    visitStamp += 2;
+    int start[2] = { u, v };
+    size_t head[2] = { 0, 0 };
+    for (int side = 0; side < 2; side++) {
+        searchQueue[side].clear();
+        searchQueue[side].push_back(start[side]);
+        visitMark[start[side]] = visitStamp + side;
+    }
+    int smaller = -1;
+    while (smaller < 0) {
+        for (int side = 0; side < 2 && smaller < 0; side++) {
+            vector<int> & queue = searchQueue[side];
+            if (head[side] == queue.size()) {
+                smaller = side;
+                break;
+            }
+            int node = queue[head[side]++];
+            stats.scannedNodes++;
+            const vector<int> & around = incident[node];
+            for (size_t i = 0; i < around.size(); i++) {
+                const Road & road = roads[around[i]];
+                if (!road.inTree) continue;
+                int next = (road.u == node) ? road.v : road.u;
+                if (visitMark[next] != visitStamp + side) {
+                    visitMark[next] = visitStamp + side;
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+    int best = NO_ROAD;
+    const vector<int> & half = searchQueue[smaller];
+    for (size_t i = 0; i < half.size(); i++) {
+        const vector<int> & around = incident[half[i]];
+        for (size_t j = 0; j < around.size(); j++) {
+            int id = around[j];
+            const Road & road = roads[id];
+            if (road.inTree || road.u == road.v) continue;
+            int other = (road.u == half[i]) ? road.v : road.u;
+            if (visitMark[other] == visitStamp + smaller) continue;
+            if (best == NO_ROAD || lighter(id, best)) best = id;
+        }
+    }
+    return best;
+}
+
+/* Method: detachRoad
+ * ------------------
+ * Removes a road from the incident lists of its ends.
+ */
+
+void DynamicSpanningTree::detachRoad(int road) {
+    int ends[2] = { roads[road].u, roads[road].v };
+    for (int i = 0; i < 2; i++) {
+        vector<int> & around = incident[ends[i]];
+        for (size_t j = 0; j < around.size(); j++) {
+            if (around[j] == road) {
+                around[j] = around.back();
+                around.pop_back();
+                break;
+            }
+        }
+        if (ends[1] == ends[0]) break;
+    }
+}
+
+DynamicSpanningTree & getDynamicSpanningTree() {
+    static DynamicSpanningTree tree;
+    return tree;
+}
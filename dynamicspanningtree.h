@@ -0,0 +1,212 @@
+/*
+ * File: dynamicspanningtree.h
+ * ---------------------------
+ * This file exports the DynamicSpanningTree class, which keeps the
+ * minimum spanning forest of a loaded map up to date while roads are
+ * added, closed and reweighted, instead of rerunning Kruskal after
+ * every change. The forest is stored in a LinkCutForest in which
+ * every road is an element of its own, carrying its cost:
+ *
+ *    - A new or cheaper road that joins two parts of one tree
+ *      replaces the most expensive road on the tree path between its
+ *      ends if it is cheaper (the cycle property).
+ *
+ *    - A closed or more expensive tree road is cut out, and the
+ *      cheapest road across the cut takes its place (the cut
+ *      property). That road is found by exploring the smaller of the
+ *      two halves, both grown a node at a time until one runs out.
+ *
+ * Adding a road and lowering a cost take O(log n) amortized time;
+ * closing or raising a tree road costs time proportional to the
+ * smaller half and its roads, which is still far below a rebuild.
+ * Edits change the MapGraph but not the GraphSnapshot. After
+ * setRoadCost, updateSnapshotCosts (see graphsnapshot.h) brings the
+ * snapshot up to date for that road alone; after addRoad or
+ * removeRoad, which change the arcs themselves, call
+ * refreshGraphSnapshot before searching the edited map.
+ */
+
+#ifndef _dynamicspanningtree_h
+#define _dynamicspanningtree_h
+
+#include <unordered_map>
+#include <vector>
+#include "graphsnapshot.h"
+#include "graphtypes.h"
+#include "linkcutforest.h"
+#include "path.h"
+
+/* Type: DynamicTreeStats
+ * ----------------------
+ * Describes the forest and the work done to maintain it. A
+ * replacement search happens whenever a tree road is cut out;
+ * scannedNodes counts the nodes those searches visited.
+ * unpairedArcs counts the arcs build found no opposite arc of the
+ * same cost for. They are left out of the forest, so on a map that
+ * has any, Kruskal over every arc may choose a different tree.
+ */
+
+struct DynamicTreeStats {
+    int roadCount;
+    int treeRoads;
+    double treeCost;
+    long long updates;
+    long long replacementSearches;
+    long long scannedNodes;
+    long long unpairedArcs;
+    double buildSeconds;
+};
+
+class DynamicSpanningTree {
+
+public:
+
+/* Constructor: DynamicSpanningTree
+ * Usage: DynamicSpanningTree tree;
+ * --------------------------------
+ * Creates a tree that is not yet built for any map.
+ */
+
+    DynamicSpanningTree();
+
+/* Method: build
+ * Usage: tree.build(graph, snapshot);
+ * -----------------------------------
+ * Computes the minimum spanning forest of graph with Kruskal's
+ * algorithm. The snapshot must be the current one for graph; each
+ * pair of opposite arcs of equal cost in it becomes one road, and
+ * arcs without such a partner are counted in unpairedArcs.
+ */
+
+    void build(MapGraph & graph, const GraphSnapshot & snapshot);
+
+/* Method: clear
+ * Usage: tree.clear();
+ * --------------------
+ * Forgets the map. This must happen before the graph frees its nodes.
+ */
+
+    void clear();
+
+/* Method: isBuilt
+ * Usage: if (tree.isBuilt()) ...
+ * ------------------------------
+ * Returns true if build has been called since the last clear.
+ */
+
+    bool isBuilt() const;
+
+/* Method: findRoad
+ * Usage: Arc *road = tree.findRoad(one, two);
+ * -------------------------------------------
+ * Returns the cheapest arc from one to two, or NULL if no road joins
+ * them.
+ */
+
+    Arc *findRoad(Node *one, Node *two) const;
+
+/* Method: addRoad
+ * Usage: Arc *road = tree.addRoad(one, two, cost);
+ * ------------------------------------------------
+ * Adds a road between two cities of the map to the graph, as a pair
+ * of opposite arcs, and updates the forest. Returns the arc from one
+ * to two.
+ */
+
+    Arc *addRoad(Node *one, Node *two, double cost);
+
+/* Method: removeRoad
+ * Usage: if (tree.removeRoad(road)) ...
+ * -------------------------------------
+ * Removes both arcs of the road that road belongs to from the graph
+ * and updates the forest. Returns false if road is not a known arc.
+ */
+
+    bool removeRoad(Arc *road);
+
+/* Method: setRoadCost
+ * Usage: if (tree.setRoadCost(road, cost)) ...
+ * --------------------------------------------
+ * Changes the cost of both arcs of a road and updates the forest.
+ * Returns false if road is not a known arc.
+ */
+
+    bool setRoadCost(Arc *road, double cost);
+
+/* Method: isTreeRoad
+ * Usage: if (tree.isTreeRoad(road)) ...
+ * -------------------------------------
+ * Returns true if the road that road belongs to is in the forest.
+ */
+
+    bool isTreeRoad(Arc *road) const;
+
+/* Method: getTree
+ * Usage: Path tree = tree.getTree();
+ * ----------------------------------
+ * Returns one arc per road of the forest, cheapest first.
+ */
+
+    Path getTree() const;
+
+/* Method: getStats
+ * Usage: DynamicTreeStats stats = tree.getStats();
+ * ------------------------------------------------
+ * Returns the size and cost of the forest and the work done so far.
+ */
+
+    DynamicTreeStats getStats() const;
+
+private:
+
+/* Type: Road
+ * ----------
+ * One undirected road: its end node IDs, cost and two arcs. Closed
+ * roads stay in the array, marked not live, until their slot is
+ * reused.
+ */
+
+    struct Road {
+        int u;
+        int v;
+        double cost;
+        Arc *forward;
+        Arc *backward;
+        bool live;
+        bool inTree;
+    };
+
+    MapGraph *graph;
+    std::vector<Node *> nodes;
+    std::unordered_map<Node *, int> nodeIds;
+    std::unordered_map<Arc *, int> roadIds;
+    std::vector<Road> roads;
+    std::vector<int> freeRoads;
+    std::vector< std::vector<int> > incident;     /* live road IDs per node */
+    LinkCutForest forest;                       /* nodes, then one element per road */
+    std::vector<int> visitMark;
+    std::vector<int> searchQueue[2];
+    int visitStamp;
+    DynamicTreeStats stats;
+
+    int newRoad(int u, int v, double cost, Arc *forward, Arc *backward);
+    bool lighter(int a, int b) const;
+    void linkRoad(int road);
+    void cutRoad(int road);
+    void offerRoad(int road);
+    void replaceTreeRoad(int road);
+    int findReplacement(int u, int v);
+    void detachRoad(int road);
+
+};
+
+/* Function: getDynamicSpanningTree
+ * Usage: DynamicSpanningTree & tree = getDynamicSpanningTree();
+ * -------------------------------------------------------------
+ * Returns the tree shared by the program, which batch mode builds
+ * when a map is first edited.
+ */
+
+DynamicSpanningTree & getDynamicSpanningTree();
+
+#endif
@@ -0,0 +1,397 @@
+/*
+ * File: graphsnapshot.cpp
+ * -----------------------
+ * This file implements GraphSnapshot construction. A first pass sizes
+ * each node's slice of the arc arrays from its arc count and a second
+ * pass fills the slices, so building takes time linear in the size of
+ * the graph apart from sorting the nodes into their new order and
+ * each node's arcs by target. Quantizing the costs adds one more pass
+ * over the arcs, or up to seven when the resolution is chosen
+ * automatically.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "graphsnapshot.h"
+#include "dynamicshortestpaths.h"
+#include "instrumentation.h"
+#include "shortestpath.h"
+#include "spatialindex.h"
+using namespace std;
+
+/* CONSTANTS */
+const double HEURISTIC_SAFETY_MARGIN = 1e-9;
+const unsigned MAX_ARC_UNITS = 1u << 30;
+const int MAX_AUTO_DECIMALS = 6;
+const double EXACT_UNIT_TOLERANCE = 1e-12;
+const unsigned HILBERT_SIDE = 1u << 16;
+
+static GraphSnapshot currentSnapshot;
+static int snapshotVersion = 0;
+static double costResolution = NO_COST_RESOLUTION;
+static NodeOrder nodeOrder = DEFAULT_NODE_ORDER;
+
+
+void refreshGraphSnapshot(MapGraph & graph) {
+    PhaseTimer timer("snapshot");
+    buildGraphSnapshot(graph, currentSnapshot);
+    getSpatialIndex().build(currentSnapshot);
+    clearPathCache();
+}
+
+void clearGraphSnapshot() {
+    GraphSnapshot empty;
+    empty.version = ++snapshotVersion;
+    swap(currentSnapshot, empty);
+    getSpatialIndex().clear();
+    clearPathCache();
+    getDynamicShortestPaths().clear();
+}
+
+const GraphSnapshot & getGraphSnapshot() {
+    return currentSnapshot;
+}
+
+/* Function: hilbertIndex
+ * Usage: unsigned long long d = hilbertIndex(x, y);
+ * -------------------------------------------------
+ * Returns the position of the cell (x, y) along a Hilbert curve that
+ * covers a HILBERT_SIDE by HILBERT_SIDE grid.
+ */
+
+static unsigned long long hilbertIndex(unsigned x, unsigned y) {
+    unsigned long long d = 0;
+    for (unsigned s = HILBERT_SIDE / 2; s > 0; s /= 2) {
+        unsigned rx = (x & s) ? 1 : 0;
+        unsigned ry = (y & s) ? 1 : 0;
+        d += (unsigned long long) s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = HILBERT_SIDE - 1 - x;
+                y = HILBERT_SIDE - 1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return d;
+}
+
+/* Function: hilbertOrder
+ * Usage: hilbertOrder(nodes, order);
+ * ----------------------------------
+ * Fills order with the indices of nodes sorted by the Hilbert index
+ * of their locations, scaled to the grid over their bounding box.
+ */
+
+static void hilbertOrder(const vector<Node *> & nodes, vector<int> & order) {
+    int nodeCount = nodes.size();
+    double minX = numeric_limits<double>::infinity(), maxX = -minX;
+    double minY = minX, maxY = -minX;
+    for (int i = 0; i < nodeCount; i++) {
+        minX = min(minX, nodes[i]->loc.getX());
+        maxX = max(maxX, nodes[i]->loc.getX());
+        minY = min(minY, nodes[i]->loc.getY());
+        maxY = max(maxY, nodes[i]->loc.getY());
+    }
+    double scaleX = (maxX > minX) ? (HILBERT_SIDE - 1) / (maxX - minX) : 0;
+    double scaleY = (maxY > minY) ? (HILBERT_SIDE - 1) / (maxY - minY) : 0;
+    vector<pair<unsigned long long, int> > keys(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        unsigned x = (unsigned) ((nodes[i]->loc.getX() - minX) * scaleX);
+        unsigned y = (unsigned) ((nodes[i]->loc.getY() - minY) * scaleY);
+        keys[i] = make_pair(hilbertIndex(x, y), i);
+    }
+    sort(keys.begin(), keys.end());
+    order.resize(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        order[i] = keys[i].second;
+    }
+}
+
+/* Function: breadthFirstOrder
+ * Usage: breadthFirstOrder(nodes, order);
+ * ---------------------------------------
+ * Fills order with the indices of nodes in reverse Cuthill-McKee
+ * order. Each component is searched from its unvisited node of least
+ * degree, and the neighbors of each node are queued by degree.
+ */
+
+static void breadthFirstOrder(const vector<Node *> & nodes, vector<int> & order) {
+    int nodeCount = nodes.size();
+    unordered_map<Node *, int> index;
+    vector<int> degree(nodeCount);
+    vector<pair<int, int> > starts(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        index[nodes[i]] = i;
+        degree[i] = nodes[i]->arcs.size();
+        starts[i] = make_pair(degree[i], i);
+    }
+    sort(starts.begin(), starts.end());
+    vector<bool> visited(nodeCount, false);
+    vector<pair<int, int> > neighbors;
+    order.clear();
+    order.reserve(nodeCount);
+    for (int s = 0; s < nodeCount; s++) {
+        int start = starts[s].second;
+        if (visited[start]) continue;
+        visited[start] = true;
+        order.push_back(start);
+        for (size_t head = order.size() - 1; head < order.size(); head++) {
+            neighbors.clear();
+            foreach (Arc *arc in nodes[order[head]]->arcs) {
+                int next = index[arc->finish];
+                if (visited[next]) continue;
+                visited[next] = true;
+                neighbors.push_back(make_pair(degree[next], next));
+            }
+            sort(neighbors.begin(), neighbors.end());
+            for (size_t i = 0; i < neighbors.size(); i++) {
+                order.push_back(neighbors[i].second);
+            }
+        }
+    }
+    reverse(order.begin(), order.end());
+}
+
+/* Function: buildGraphSnapshot
+ * ----------------------------
+ * Nodes are renumbered before the arcs are laid out, and each node's
+ * arcs are sorted by target so that a scan of them moves forward
+ * through the per-node arrays.
+ */
+
+void buildGraphSnapshot(MapGraph & graph, GraphSnapshot & snapshot) {
+    snapshot = GraphSnapshot();
+    vector<Node *> graphNodes;
+    foreach (Node *node in graph.getNodes()) {
+        graphNodes.push_back(node);
+    }
+    int nodeCount = graphNodes.size();
+    vector<int> order;
+    if (nodeOrder == HILBERT_ORDER) {
+        hilbertOrder(graphNodes, order);
+    } else if (nodeOrder == BFS_ORDER) {
+        breadthFirstOrder(graphNodes, order);
+    } else {
+        for (int i = 0; i < nodeCount; i++) {
+            order.push_back(i);
+        }
+    }
+    snapshot.nodeOrder = nodeOrder;
+    snapshot.originalIds = order;
+    snapshot.snapshotIds.resize(nodeCount);
+    for (int id = 0; id < nodeCount; id++) {
+        Node *node = graphNodes[order[id]];
+        snapshot.snapshotIds[order[id]] = id;
+        snapshot.nodes.push_back(node);
+        snapshot.names.push_back(node->name);
+        snapshot.xCoord.push_back(node->loc.getX());
+        snapshot.yCoord.push_back(node->loc.getY());
+        snapshot.nodeIds[node] = id;
+        snapshot.nameIds[node->name] = id;
+    }
+    snapshot.arcOffset.assign(nodeCount + 1, 0);
+    for (int i = 0; i < nodeCount; i++) {
+        snapshot.arcOffset[i + 1] = snapshot.arcOffset[i] + snapshot.nodes[i]->arcs.size();
+    }
+    int arcCount = snapshot.arcOffset[nodeCount];
+    snapshot.arcTarget.resize(arcCount);
+    snapshot.arcCost.resize(arcCount);
+    snapshot.arcs.resize(arcCount);
+    vector<pair<int, Arc *> > slice;
+    for (int i = 0; i < nodeCount; i++) {
+        slice.clear();
+        foreach (Arc *arc in snapshot.nodes[i]->arcs) {
+            slice.push_back(make_pair(snapshot.nodeIds[arc->finish], arc));
+        }
+        stable_sort(slice.begin(), slice.end(),
+                    [](const pair<int, Arc *> & a, const pair<int, Arc *> & b) { return a.first < b.first; });
+        int slot = snapshot.arcOffset[i];
+        for (size_t j = 0; j < slice.size(); j++, slot++) {
+            snapshot.arcTarget[slot] = slice[j].first;
+            snapshot.arcCost[slot] = slice[j].second->cost;
+            snapshot.arcs[slot] = slice[j].second;
+        }
+    }
+    if (costResolution != NO_COST_RESOLUTION) quantizeArcCosts(snapshot, costResolution);
+    snapshot.heuristicScale = calibrateHeuristicScale(snapshot);
+    snapshot.version = ++snapshotVersion;
+}
+
+void setNodeOrder(NodeOrder order) {
+    nodeOrder = order;
+}
+
+bool parseNodeOrder(const string & name, NodeOrder & order) {
+    if (name == "graph") {
+        order = GRAPH_ORDER;
+    } else if (name == "hilbert") {
+        order = HILBERT_ORDER;
+    } else if (name == "bfs") {
+        order = BFS_ORDER;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void setCostResolution(double resolution) {
+    costResolution = resolution;
+}
+
+/* Function: fillArcUnits
+ * Usage: if (fillArcUnits(snapshot, resolution, exactOnly)) ...
+ * -------------------------------------------------------------
+ * Rounds every arc cost to units of resolution and records the
+ * result in snapshot. Returns false, leaving snapshot unquantized,
+ * if a cost does not fit or, when exactOnly is set, if a cost is not
+ * a whole number of units. Costs are compared relative to their size
+ * so that 0.1 counts as exactly one unit of 0.1.
+ */
+
+static bool fillArcUnits(GraphSnapshot & snapshot, double resolution, bool exactOnly) {
+    int arcCount = snapshot.arcCount();
+    vector<unsigned> units(arcCount);
+    double worstError = 0;
+    unsigned largest = 0;
+    bool exact = true;
+    for (int arc = 0; arc < arcCount; arc++) {
+        double cost = snapshot.arcCost[arc];
+        double scaled = floor(cost / resolution + 0.5);
+        if (!(scaled >= 0) || scaled > MAX_ARC_UNITS) return false;
+        double error = fabs(scaled * resolution - cost);
+        if (error > EXACT_UNIT_TOLERANCE * max(1.0, cost)) {
+            if (exactOnly) return false;
+            exact = false;
+        }
+        if (error > worstError) worstError = error;
+        units[arc] = (unsigned) scaled;
+        if (units[arc] > largest) largest = units[arc];
+    }
+    snapshot.arcUnits.swap(units);
+    snapshot.costResolution = resolution;
+    snapshot.quantizationError = exact ? 0 : worstError;
+    snapshot.exactUnits = exact;
+    snapshot.maxArcUnits = largest;
+    return true;
+}
+
+/* Function: requantizeArc
+ * Usage: requantizeArc(snapshot, arc);
+ * ------------------------------------
+ * Recomputes the units of one arc whose cost was edited. A cost that
+ * is not a whole number of units makes the snapshot's units inexact,
+ * and one that no longer fits leaves the snapshot unquantized.
+ */
+
+static void requantizeArc(GraphSnapshot & snapshot, int arc) {
+    if (snapshot.arcUnits.empty()) return;
+    double cost = snapshot.arcCost[arc];
+    double scaled = floor(cost / snapshot.costResolution + 0.5);
+    if (!(scaled >= 0) || scaled > MAX_ARC_UNITS) {
+        quantizeArcCosts(snapshot, NO_COST_RESOLUTION);
+        return;
+    }
+    double error = fabs(scaled * snapshot.costResolution - cost);
+    if (error > EXACT_UNIT_TOLERANCE * max(1.0, cost)) {
+        snapshot.exactUnits = false;
+        if (error > snapshot.quantizationError) snapshot.quantizationError = error;
+    }
+    snapshot.arcUnits[arc] = (unsigned) scaled;
+    if (snapshot.arcUnits[arc] > snapshot.maxArcUnits) snapshot.maxArcUnits = snapshot.arcUnits[arc];
+}
+
+void quantizeArcCosts(GraphSnapshot & snapshot, double resolution) {
+    snapshot.arcUnits.clear();
+    snapshot.costResolution = 0;
+    snapshot.quantizationError = 0;
+    snapshot.exactUnits = false;
+    snapshot.maxArcUnits = 0;
+    if (resolution > 0) {
+        fillArcUnits(snapshot, resolution, false);
+        return;
+    }
+    if (resolution != AUTO_COST_RESOLUTION) return;
+    double candidate = 1;
+    for (int decimals = 0; decimals <= MAX_AUTO_DECIMALS; decimals++) {
+        if (fillArcUnits(snapshot, candidate, true)) return;
+        candidate /= 10;
+    }
+}
+
+/* Function: updateSnapshotCosts
+ * -----------------------------
+ * Arcs are copied and repaired one at a time, so each repair starts
+ * from trees that are correct for every other cost. The heuristic
+ * scale can only be invalidated by a decrease, so it is lowered to
+ * fit the new arc rather than recalibrated over the whole map.
+ */
+
+int updateSnapshotCosts(Node *one, Node *two) {
+    GraphSnapshot & snapshot = currentSnapshot;
+    int ends[2] = { snapshotNodeId(snapshot, one), snapshotNodeId(snapshot, two) };
+    if (ends[0] == NO_NODE || ends[1] == NO_NODE) return 0;
+    int changed = 0;
+    for (int side = 0; side < 2; side++) {
+        int u = ends[side];
+        int v = ends[1 - side];
+        for (int arc = snapshot.arcOffset[u]; arc < snapshot.arcOffset[u + 1]; arc++) {
+            if (snapshot.arcTarget[arc] != v || snapshot.arcCost[arc] == snapshot.arcs[arc]->cost) continue;
+            if (changed++ == 0) {
+                snapshot.costVersion++;
+                clearPathCache();
+            }
+            double oldCost = snapshot.arcCost[arc];
+            snapshot.arcCost[arc] = snapshot.arcs[arc]->cost;
+            requantizeArc(snapshot, arc);
+            double dx = snapshot.xCoord[u] - snapshot.xCoord[v];
+            double dy = snapshot.yCoord[u] - snapshot.yCoord[v];
+            double length = sqrt(dx * dx + dy * dy);
+            if (length > 0) {
+                double ratio = max(0.0, snapshot.arcCost[arc] / length * (1 - HEURISTIC_SAFETY_MARGIN));
+                if (ratio < snapshot.heuristicScale) snapshot.heuristicScale = ratio;
+            }
+            getDynamicShortestPaths().repairArc(snapshot, arc, oldCost);
+        }
+        if (u == v) break;
+    }
+    return changed;
+}
+
+/* Function: calibrateHeuristicScale
+ * ---------------------------------
+ * Arcs whose endpoints share a location say nothing about the scale
+ * and are skipped. The ratio is shrunk by HEURISTIC_SAFETY_MARGIN so
+ * that rounding in the heuristic can never make it overestimate.
+ */
+
+double calibrateHeuristicScale(const GraphSnapshot & snapshot) {
+    double scale = numeric_limits<double>::infinity();
+    for (int u = 0; u < snapshot.nodeCount(); u++) {
+        for (int arc = snapshot.arcOffset[u]; arc < snapshot.arcOffset[u + 1]; arc++) {
+            int v = snapshot.arcTarget[arc];
+            double dx = snapshot.xCoord[u] - snapshot.xCoord[v];
+            double dy = snapshot.yCoord[u] - snapshot.yCoord[v];
+            double length = sqrt(dx * dx + dy * dy);
+            if (length == 0) continue;
+            double ratio = snapshot.arcCost[arc] / length;
+            if (ratio < scale) scale = ratio;
+        }
+    }
+    if (scale == numeric_limits<double>::infinity() || scale <= 0) return 0;
+    return scale * (1 - HEURISTIC_SAFETY_MARGIN);
+}
+
+int snapshotNodeId(const GraphSnapshot & snapshot, Node *node) {
+    unordered_map<Node *, int>::const_iterator it = snapshot.nodeIds.find(node);
+    return (it == snapshot.nodeIds.end()) ? NO_NODE : it->second;
+}
+
+int snapshotNodeId(const GraphSnapshot & snapshot, const string & name) {
+    unordered_map<string, int>::const_iterator it = snapshot.nameIds.find(name);
+    return (it == snapshot.nameIds.end()) ? NO_NODE : it->second;
+}
@@ -0,0 +1,209 @@
+/*
+ * File: graphsnapshot.h
+ * ---------------------
+ * This file exports GraphSnapshot, a read-only copy of the loaded
+ * MapGraph laid out in compressed sparse row (CSR) form. The
+ * outgoing arcs of node i occupy positions arcOffset[i] up to
+ * arcOffset[i + 1] of the arc arrays, and per-node data is stored as
+ * one array per field. Search and spanning tree algorithms walk these
+ * arrays instead of chasing Node and Arc pointers. Nodes are numbered
+ * so that cities near each other get nearby IDs (see NodeOrder), and
+ * each node's arcs are sorted by target. Arc costs can also
+ * be quantized to integer units for the integer search mode in
+ * shortestpath.h.
+ */
+
+#ifndef _graphsnapshot_h
+#define _graphsnapshot_h
+
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "graphtypes.h"
+#include "mapgraph.h"
+
+/* CONSTANTS */
+const int NO_NODE = -1;
+const double INFINITE_DISTANCE = std::numeric_limits<double>::infinity();
+const double AUTO_COST_RESOLUTION = 0;
+const double NO_COST_RESOLUTION = -1;
+
+/* Type: NodeOrder
+ * ---------------
+ * Selects how buildGraphSnapshot numbers nodes. GRAPH_ORDER keeps
+ * the order of graph.getNodes(). HILBERT_ORDER sorts nodes along a
+ * Hilbert curve over their locations, so that cities close on the
+ * map share cache lines and pages in every per-node array. BFS_ORDER
+ * is reverse Cuthill-McKee: breadth-first from a node of least degree
+ * in each component, neighbors by increasing degree, then reversed,
+ * which keeps the ends of each arc close in ID even where locations
+ * say little about the roads.
+ */
+
+enum NodeOrder { GRAPH_ORDER, HILBERT_ORDER, BFS_ORDER };
+const NodeOrder DEFAULT_NODE_ORDER = HILBERT_ORDER;
+
+/* Type: GraphSnapshot
+ * -------------------
+ * The CSR arrays for one map. Node IDs run from 0 to nodeCount() - 1
+ * and stay fixed until the snapshot is rebuilt; version changes on
+ * every rebuild so that code holding per-node arrays can tell when
+ * they are stale. If costs were quantized (see setCostResolution),
+ * arcUnits holds each arc's cost as a whole number of costResolution
+ * units and quantizationError the largest difference between an arc
+ * cost and its units; otherwise arcUnits is empty. originalIds maps
+ * each node ID to the node's position in graph.getNodes(), which is
+ * its position among the cities of the map file whether the map was
+ * parsed or read from its binary snapshot, and snapshotIds maps back.
+ * Batch mode can write both (see --dump-ids in batchmode.h). Costs
+ * edited in place by updateSnapshotCosts keep the version but change
+ * costVersion.
+ */
+
+struct GraphSnapshot {
+    std::vector<int> arcOffset;             /* nodeCount() + 1 entries */
+    std::vector<int> arcTarget;             /* ID of each arc's finish */
+    std::vector<double> arcCost;
+    std::vector<Arc *> arcs;                /* the original Arc */
+    std::vector<double> xCoord;
+    std::vector<double> yCoord;
+    std::vector<std::string> names;
+    std::vector<Node *> nodes;
+    std::unordered_map<Node *, int> nodeIds;
+    std::unordered_map<std::string, int> nameIds;
+    std::vector<int> originalIds;
+    std::vector<int> snapshotIds;
+    NodeOrder nodeOrder;
+    std::vector<unsigned> arcUnits;
+    double costResolution;                  /* 0 if not quantized */
+    double quantizationError;
+    bool exactUnits;                        /* every cost is a whole number of units */
+    unsigned maxArcUnits;
+    double heuristicScale;                  /* see calibrateHeuristicScale */
+    int version;
+    int costVersion;
+
+    GraphSnapshot() : arcOffset(1, 0), nodeOrder(GRAPH_ORDER), costResolution(0), quantizationError(0), exactUnits(false),
+                      maxArcUnits(0), heuristicScale(0), version(0), costVersion(0) {}
+    int nodeCount() const { return nodes.size(); }
+    int arcCount() const { return arcs.size(); }
+};
+
+/* Function: refreshGraphSnapshot
+ * Usage: refreshGraphSnapshot(graph);
+ * -----------------------------------
+ * Rebuilds the current snapshot from graph, and the spatial index
+ * over its node locations (see spatialindex.h), and empties the
+ * path cache (see shortestpath.h). It is called each time a map
+ * finishes loading.
+ */
+
+void refreshGraphSnapshot(MapGraph & graph);
+
+/* Function: clearGraphSnapshot
+ * Usage: clearGraphSnapshot();
+ * ----------------------------
+ * Empties the current snapshot, the path cache and the tracked
+ * shortest-path trees. This must happen before the graph frees its
+ * nodes, since each of them points at those nodes.
+ */
+
+void clearGraphSnapshot();
+
+/* Function: updateSnapshotCosts
+ * Usage: int changed = updateSnapshotCosts(one, two);
+ * ---------------------------------------------------
+ * Copies into the current snapshot the costs of every arc between
+ * the nodes one and two, in either direction, that was changed in
+ * the graph since the snapshot was built. Unlike a refresh this
+ * takes time proportional to the degrees of one and two: the quantized
+ * units and heuristic scale are adjusted for just those arcs, the
+ * path cache is emptied, and the tracked shortest-path trees (see
+ * dynamicshortestpaths.h) are repaired. Returns the number of arcs
+ * whose cost changed.
+ */
+
+int updateSnapshotCosts(Node *one, Node *two);
+
+/* Function: getGraphSnapshot
+ * Usage: const GraphSnapshot & snapshot = getGraphSnapshot();
+ * -----------------------------------------------------------
+ * Returns the snapshot of the most recently loaded map.
+ */
+
+const GraphSnapshot & getGraphSnapshot();
+
+/* Function: buildGraphSnapshot
+ * Usage: buildGraphSnapshot(graph, snapshot);
+ * -------------------------------------------
+ * Fills snapshot from graph without touching the current snapshot.
+ */
+
+void buildGraphSnapshot(MapGraph & graph, GraphSnapshot & snapshot);
+
+/* Function: setNodeOrder
+ * Usage: setNodeOrder(order);
+ * ---------------------------
+ * Chooses how later snapshots number their nodes. The default is
+ * DEFAULT_NODE_ORDER.
+ */
+
+void setNodeOrder(NodeOrder order);
+
+/* Function: parseNodeOrder
+ * Usage: if (parseNodeOrder(name, order)) ...
+ * -------------------------------------------
+ * Sets order from its command-line name, "graph", "hilbert" or "bfs".
+ * Returns false if name is none of these.
+ */
+
+bool parseNodeOrder(const std::string & name, NodeOrder & order);
+
+/* Function: setCostResolution
+ * Usage: setCostResolution(resolution);
+ * -------------------------------------
+ * Chooses how later snapshots quantize arc costs. A positive
+ * resolution rounds every cost to the nearest multiple of it, however
+ * much that loses. AUTO_COST_RESOLUTION picks the coarsest of 1, 0.1,
+ * ..., 0.000001 that represents every cost exactly, and leaves the
+ * costs unquantized if none does. NO_COST_RESOLUTION, the default,
+ * turns quantization off.
+ */
+
+void setCostResolution(double resolution);
+
+/* Function: quantizeArcCosts
+ * Usage: quantizeArcCosts(snapshot, resolution);
+ * ----------------------------------------------
+ * Fills the quantization fields of snapshot as setCostResolution
+ * describes for the given resolution. Costs that are negative or
+ * would need more than 2^30 units leave the snapshot unquantized.
+ */
+
+void quantizeArcCosts(GraphSnapshot & snapshot, double resolution);
+
+/* Function: calibrateHeuristicScale
+ * Usage: double scale = calibrateHeuristicScale(snapshot);
+ * --------------------------------------------------------
+ * Returns the largest factor k such that no arc costs less than k
+ * times the straight-line distance between its endpoints. Scaling
+ * Euclidean distance by k therefore never overestimates the cost of
+ * a route, even on maps such as MiddleEarth.txt whose costs are not
+ * measured in pixels. Returns 0 if any arc is free.
+ */
+
+double calibrateHeuristicScale(const GraphSnapshot & snapshot);
+
+/* Function: snapshotNodeId
+ * Usage: int id = snapshotNodeId(snapshot, node);
+ *        int id = snapshotNodeId(snapshot, name);
+ * -----------------------------------------------
+ * Returns the ID of a node, looked up by pointer or by city name,
+ * or NO_NODE if the snapshot does not contain it.
+ */
+
+int snapshotNodeId(const GraphSnapshot & snapshot, Node *node);
+int snapshotNodeId(const GraphSnapshot & snapshot, const std::string & name);
+
+#endif
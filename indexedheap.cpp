@@ -0,0 +1,127 @@
+/*
+ * File: indexedheap.cpp
+ * ---------------------
+ * This file implements the IndexedHeap class. The heap is stored
+ * implicitly in an array with HEAP_ARITY children per entry; a wider
+ * fan-out makes the tree shallower, which favors the many cheap
+ * decrease-key operations Dijkstra performs over the fewer pops.
+ */
+
+#include "indexedheap.h"
+using namespace std;
+
+/* CONSTANTS */
+const int HEAP_ARITY = 4;
+const int NOT_IN_HEAP = -1;
+
+
+IndexedHeap::IndexedHeap(int capacity) {
+    resize(capacity);
+}
+
+void IndexedHeap::resize(int capacity) {
+    entries.clear();
+    position.assign(capacity, NOT_IN_HEAP);
+}
+
+void IndexedHeap::clear() {
+    for (size_t i = 0; i < entries.size(); i++) {
+        position[entries[i].id] = NOT_IN_HEAP;
+    }
+    entries.clear();
+}
+
+bool IndexedHeap::isEmpty() const {
+    return entries.empty();
+}
+
+int IndexedHeap::size() const {
+    return entries.size();
+}
+
+bool IndexedHeap::contains(int id) const {
+    return position[id] != NOT_IN_HEAP;
+}
+
+bool IndexedHeap::pushOrDecrease(int id, double key) {
+    int index = position[id];
+    if (index == NOT_IN_HEAP) {
+        Entry entry = { key, id };
+        entries.push_back(entry);
+        position[id] = entries.size() - 1;
+        siftUp(entries.size() - 1);
+        return true;
+    }
+    if (key < entries[index].key) {
+        entries[index].key = key;
+        siftUp(index);
+        return true;
+    }
+    return false;
+}
+
+int IndexedHeap::popMin() {
+    int id = entries[0].id;
+    position[id] = NOT_IN_HEAP;
+    Entry last = entries.back();
+    entries.pop_back();
+    if (!entries.empty()) {
+        entries[0] = last;
+        position[last.id] = 0;
+        siftDown(0);
+    }
+    return id;
+}
+
+double IndexedHeap::minKey() const {
+    return entries[0].key;
+}
+
+/* Method: siftUp
+ * Usage: siftUp(index);
+ * ---------------------
+ * Moves the entry at index toward the root until its parent's key is
+ * no larger. The moving entry is held aside so each level costs one
+ * copy instead of a swap.
+ */
+
+void IndexedHeap::siftUp(int index) {
+    Entry moving = entries[index];
+    while (index > 0) {
+        int parent = (index - 1) / HEAP_ARITY;
+        if (entries[parent].key <= moving.key) break;
+        entries[index] = entries[parent];
+        position[entries[index].id] = index;
+        index = parent;
+    }
+    entries[index] = moving;
+    position[moving.id] = index;
+}
+
+/* Method: siftDown
+ * Usage: siftDown(index);
+ * -----------------------
+ * Moves the entry at index toward the leaves, each time swapping with
+ * the smallest of its HEAP_ARITY children.
+ */
+
+void IndexedHeap::siftDown(int index) {
+    Entry moving = entries[index];
+    int count = entries.size();
+    while (true) {
+        int first = index * HEAP_ARITY + 1;
+        if (first >= count) break;
+        int last = first + HEAP_ARITY;
+        if (last > count) last = count;
+        int best = first;
+        for (int child = first + 1; child < last; child++) {
+            if (entries[child].key < entries[best].key) best = child;
+        }
+        if (entries[best].key >= moving.key) break;
+        entries[index] = entries[best];
+        position[entries[index].id] = index;
+        index = best;
+    }
+    entries[index] = moving;
+    position[moving.id] = index;
+}
@@ -0,0 +1,111 @@
+/*
+ * File: indexedheap.h
+ * -------------------
+ * This file exports the IndexedHeap class, a d-ary min-heap over
+ * dense integer IDs in the range [0, capacity). Because every ID
+ * remembers its own position in the heap, the priority of an entry
+ * can be lowered in place (decrease-key) instead of pushing a second
+ * copy, which is what the shortest-path engines need.
+ */
+
+#ifndef _indexedheap_h
+#define _indexedheap_h
+
+#include <vector>
+
+class IndexedHeap {
+
+public:
+
+/* Constructor: IndexedHeap
+ * Usage: IndexedHeap heap;
+ *        IndexedHeap heap(capacity);
+ * ----------------------------------
+ * Creates an empty heap that can hold IDs in [0, capacity).
+ */
+
+    IndexedHeap(int capacity = 0);
+
+/* Method: resize
+ * Usage: heap.resize(capacity);
+ * -----------------------------
+ * Empties the heap and makes room for IDs in [0, capacity).
+ */
+
+    void resize(int capacity);
+
+/* Method: clear
+ * Usage: heap.clear();
+ * --------------------
+ * Removes every entry. The cost is proportional to the number of
+ * entries still in the heap, not to its capacity.
+ */
+
+    void clear();
+
+/* Method: isEmpty
+ * Usage: if (heap.isEmpty()) ...
+ * ------------------------------
+ * Returns true if the heap has no entries.
+ */
+
+    bool isEmpty() const;
+
+/* Method: size
+ * Usage: int n = heap.size();
+ * ---------------------------
+ * Returns the number of entries in the heap.
+ */
+
+    int size() const;
+
+/* Method: contains
+ * Usage: if (heap.contains(id)) ...
+ * ---------------------------------
+ * Returns true if id currently has an entry in the heap.
+ */
+
+    bool contains(int id) const;
+
+/* Method: pushOrDecrease
+ * Usage: if (heap.pushOrDecrease(id, key)) ...
+ * --------------------------------------------
+ * Inserts id with the given key, or lowers its key if it is already
+ * present and the new key is smaller. Returns true if the heap changed.
+ */
+
+    bool pushOrDecrease(int id, double key);
+
+/* Method: popMin
+ * Usage: int id = heap.popMin();
+ * ------------------------------
+ * Removes and returns the ID with the smallest key. The heap must
+ * not be empty.
+ */
+
+    int popMin();
+
+/* Method: minKey
+ * Usage: double key = heap.minKey();
+ * ----------------------------------
+ * Returns the smallest key without removing it.
+ */
+
+    double minKey() const;
+
+private:
+
+    struct Entry {
+        double key;
+        int id;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> position;      /* -1 if the ID is not in the heap */
+
+    void siftUp(int index);
+    void siftDown(int index);
+
+};
+
+#endif
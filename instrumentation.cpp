@@ -0,0 +1,205 @@
+/*
+ * File: instrumentation.cpp
+ * -------------------------
+ * This file implements the instrumentation. Counters are atomics, so
+ * engines on worker threads can report without locking. Phases are
+ * appended to a vector under a mutex, which is taken once per phase,
+ * never inside a search. At most MAX_RECORDED_PHASES are kept; later
+ * ones are counted as dropped so that a long session cannot exhaust
+ * memory.
+ */
+
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "instrumentation.h"
+using namespace std;
+
+/* CONSTANTS */
+const size_t MAX_RECORDED_PHASES = 1000000;
+const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+    "settledNodes", "heapPushes", "heapPops", "relaxedArcs",
+    "allocatedBytes", "findCalls", "unionCalls",
+    "pathCacheHits", "pathCacheMisses"
+};
+
+
+/* Type: RecordedPhase
+ * -------------------
+ * One finished phase. Times are microseconds since the clock origin.
+ */
+
+struct RecordedPhase {
+    const char *name;
+    long long startMicros;
+    long long durationMicros;
+    int thread;
+    int argCount;
+    const char *argKeys[PhaseTimer::MAX_PHASE_ARGS];
+    long long argValues[PhaseTimer::MAX_PHASE_ARGS];
+};
+
+atomic<bool> instrumentationFlag(false);
+static atomic<long long> counters[COUNTER_COUNT];
+static mutex phaseLock;
+static vector<RecordedPhase> phases;
+static long long droppedPhases = 0;
+static const chrono::steady_clock::time_point clockOrigin = chrono::steady_clock::now();
+static atomic<int> nextThreadNumber(0);
+
+
+/* Function: threadNumber
+ * Usage: int tid = threadNumber();
+ * --------------------------------
+ * Returns a small number for the calling thread, assigned the first
+ * time the thread records a phase.
+ */
+
+static int threadNumber() {
+    thread_local int number = nextThreadNumber++;
+    return number;
+}
+
+/* Function: microsSinceOrigin
+ * Usage: long long micros = microsSinceOrigin(time);
+ * --------------------------------------------------
+ * Converts a time point into microseconds since the clock origin.
+ */
+
+static long long microsSinceOrigin(chrono::steady_clock::time_point time) {
+    return chrono::duration_cast<chrono::microseconds>(time - clockOrigin).count();
+}
+
+void setInstrumentationEnabled(bool enabled) {
+    instrumentationFlag.store(enabled);
+}
+
+void resetInstrumentation() {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        counters[i].store(0);
+    }
+    lock_guard<mutex> guard(phaseLock);
+    phases.clear();
+    droppedPhases = 0;
+}
+
+void addToCounter(InstrumentCounter counter, long long amount) {
+    if (!isInstrumentationEnabled()) return;
+    counters[counter].fetch_add(amount, memory_order_relaxed);
+}
+
+long long getCounter(InstrumentCounter counter) {
+    return counters[counter].load();
+}
+
+string getCounterName(InstrumentCounter counter) {
+    return COUNTER_NAMES[counter];
+}
+
+PhaseTimer::PhaseTimer(const char *name) {
+    this->name = name;
+    argCount = 0;
+    active = isInstrumentationEnabled();
+    if (active) start = chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (!active) return;
+    chrono::steady_clock::time_point finish = chrono::steady_clock::now();
+    RecordedPhase phase;
+    phase.name = name;
+    phase.startMicros = microsSinceOrigin(start);
+    phase.durationMicros = microsSinceOrigin(finish) - phase.startMicros;
+    phase.thread = threadNumber();
+    phase.argCount = argCount;
+    for (int i = 0; i < argCount; i++) {
+        phase.argKeys[i] = argKeys[i];
+        phase.argValues[i] = argValues[i];
+    }
+    lock_guard<mutex> guard(phaseLock);
+    if (phases.size() < MAX_RECORDED_PHASES) {
+        phases.push_back(phase);
+    } else {
+        droppedPhases++;
+    }
+}
+
+void PhaseTimer::setArg(const char *key, long long value) {
+    if (!active || argCount == MAX_PHASE_ARGS) return;
+    argKeys[argCount] = key;
+    argValues[argCount] = value;
+    argCount++;
+}
+
+/* Function: writeArgs
+ * Usage: writeArgs(out, phase);
+ * -----------------------------
+ * Writes the named values of a phase as the members of an object.
+ */
+
+static void writeArgs(ostream & out, const RecordedPhase & phase) {
+    out<<"{";
+    for (int i = 0; i < phase.argCount; i++) {
+        out<<(i > 0 ? "," : "")<<"\""<<phase.argKeys[i]<<"\":"<<phase.argValues[i];
+    }
+    out<<"}";
+}
+
+/* Function: writeCounters
+ * Usage: writeCounters(out);
+ * --------------------------
+ * Writes the counter totals as the members of an object.
+ */
+
+static void writeCounters(ostream & out) {
+    out<<"{";
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        out<<(i > 0 ? "," : "")<<"\""<<COUNTER_NAMES[i]<<"\":"<<counters[i].load();
+    }
+    out<<"}";
+}
+
+void writeInstrumentationLines(ostream & out) {
+    lock_guard<mutex> guard(phaseLock);
+    for (size_t i = 0; i < phases.size(); i++) {
+        const RecordedPhase & phase = phases[i];
+        out<<"{\"phase\":\""<<phase.name<<"\",\"startMicros\":"<<phase.startMicros
+           <<",\"durationMicros\":"<<phase.durationMicros<<",\"thread\":"<<phase.thread<<",\"args\":";
+        writeArgs(out, phase);
+        out<<"}"<<'\n';
+    }
+    out<<"{\"counters\":";
+    writeCounters(out);
+    out<<",\"droppedPhases\":"<<droppedPhases<<"}"<<'\n';
+}
+
+void writeChromeTrace(ostream & out) {
+    lock_guard<mutex> guard(phaseLock);
+    out<<"{\"traceEvents\":["<<'\n';
+    long long lastMicros = 0;
+    for (size_t i = 0; i < phases.size(); i++) {
+        const RecordedPhase & phase = phases[i];
+        out<<"{\"name\":\""<<phase.name<<"\",\"cat\":\"pathfinder\",\"ph\":\"X\",\"ts\":"<<phase.startMicros
+           <<",\"dur\":"<<phase.durationMicros<<",\"pid\":1,\"tid\":"<<phase.thread<<",\"args\":";
+        writeArgs(out, phase);
+        out<<"},"<<'\n';
+        lastMicros = max(lastMicros, phase.startMicros + phase.durationMicros);
+    }
+    out<<"{\"name\":\"counters\",\"cat\":\"pathfinder\",\"ph\":\"C\",\"ts\":"<<lastMicros
+       <<",\"pid\":1,\"tid\":0,\"args\":";
+    writeCounters(out);
+    out<<"}"<<'\n'<<"],\"otherData\":{\"droppedPhases\":"<<droppedPhases<<"}}"<<'\n';
+}
+
+bool saveInstrumentation(const string & filename, bool chrome) {
+    ofstream outfile(filename.c_str());
+    if (outfile.fail()) return false;
+    if (chrome) {
+        writeChromeTrace(outfile);
+    } else {
+        writeInstrumentationLines(outfile);
+    }
+    outfile.close();
+    return !outfile.fail();
+}
@@ -0,0 +1,173 @@
+/*
+ * File: instrumentation.h
+ * -----------------------
+ * This file exports Pathfinder's instrumentation: running totals of
+ * the work the engines do, and timed phases such as loading a map,
+ * answering a query or repainting the display. It is off by default
+ * and can be switched on and off at any time. While it is off, every
+ * hook costs one relaxed atomic load. The engines count into their
+ * own local variables and only report totals here when a phase ends.
+ *
+ * Recorded data can be written as JSON lines, one object per phase
+ * plus a final line of totals, or as a Chrome trace-event file that
+ * chrome://tracing and Perfetto display as a timeline.
+ */
+
+#ifndef _instrumentation_h
+#define _instrumentation_h
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <string>
+
+/* Type: InstrumentCounter
+ * -----------------------
+ * The running totals that are kept.
+ */
+
+enum InstrumentCounter {
+    COUNTER_SETTLED_NODES,
+    COUNTER_HEAP_PUSHES,
+    COUNTER_HEAP_POPS,
+    COUNTER_RELAXED_ARCS,
+    COUNTER_ALLOCATED_BYTES,
+    COUNTER_FIND_CALLS,
+    COUNTER_UNION_CALLS,
+    COUNTER_PATH_CACHE_HITS,
+    COUNTER_PATH_CACHE_MISSES,
+    COUNTER_COUNT
+};
+
+/* Variable: instrumentationFlag
+ * -----------------------------
+ * Whether instrumentation is on. setInstrumentationEnabled writes it;
+ * read it through isInstrumentationEnabled.
+ */
+
+extern std::atomic<bool> instrumentationFlag;
+
+/* Function: isInstrumentationEnabled
+ * Usage: if (isInstrumentationEnabled()) ...
+ * ------------------------------------------
+ * Returns true if instrumentation is switched on.
+ */
+
+inline bool isInstrumentationEnabled() {
+    return instrumentationFlag.load(std::memory_order_relaxed);
+}
+
+/* Function: setInstrumentationEnabled
+ * Usage: setInstrumentationEnabled(true);
+ * ---------------------------------------
+ * Switches instrumentation on or off. Data already recorded is kept.
+ */
+
+void setInstrumentationEnabled(bool enabled);
+
+/* Function: resetInstrumentation
+ * Usage: resetInstrumentation();
+ * ------------------------------
+ * Discards all recorded phases and zeroes the counters.
+ */
+
+void resetInstrumentation();
+
+/* Function: addToCounter
+ * Usage: addToCounter(COUNTER_RELAXED_ARCS, relaxed);
+ * ---------------------------------------------------
+ * Adds amount to a counter if instrumentation is on. Safe to call
+ * from any thread.
+ */
+
+void addToCounter(InstrumentCounter counter, long long amount);
+
+/* Function: getCounter
+ * Usage: long long total = getCounter(COUNTER_SETTLED_NODES);
+ * -----------------------------------------------------------
+ * Returns the total of a counter since the last reset.
+ */
+
+long long getCounter(InstrumentCounter counter);
+
+/* Function: getCounterName
+ * Usage: string name = getCounterName(counter);
+ * ---------------------------------------------
+ * Returns the name a counter is exported under.
+ */
+
+std::string getCounterName(InstrumentCounter counter);
+
+/* Class: PhaseTimer
+ * -----------------
+ * Times the block it is declared in and records it as a phase when
+ * the block ends, along with up to MAX_PHASE_ARGS named values
+ * attached by setArg. If instrumentation is off when the timer is
+ * created, it does nothing.
+ *
+ * Usage: PhaseTimer timer("search");
+ *        ...
+ *        timer.setArg("settled", stats.settledNodes);
+ */
+
+class PhaseTimer {
+
+public:
+
+    static const int MAX_PHASE_ARGS = 8;
+
+    explicit PhaseTimer(const char *name);
+    ~PhaseTimer();
+
+/* Method: setArg
+ * Usage: timer.setArg(key, value);
+ * --------------------------------
+ * Attaches a named value to the phase. The key must be a string
+ * literal or otherwise outlive the recorded data.
+ */
+
+    void setArg(const char *key, long long value);
+
+private:
+
+    const char *name;
+    bool active;
+    int argCount;
+    const char *argKeys[MAX_PHASE_ARGS];
+    long long argValues[MAX_PHASE_ARGS];
+    std::chrono::steady_clock::time_point start;
+
+    PhaseTimer(const PhaseTimer &);
+    PhaseTimer & operator=(const PhaseTimer &);
+
+};
+
+/* Function: writeInstrumentationLines
+ * Usage: writeInstrumentationLines(out);
+ * --------------------------------------
+ * Writes each recorded phase as a JSON object on its own line,
+ * followed by a line holding the counter totals.
+ */
+
+void writeInstrumentationLines(std::ostream & out);
+
+/* Function: writeChromeTrace
+ * Usage: writeChromeTrace(out);
+ * -----------------------------
+ * Writes the recorded phases as complete ("X") events and the counter
+ * totals as a counter ("C") event in Chrome's trace-event format.
+ */
+
+void writeChromeTrace(std::ostream & out);
+
+/* Function: saveInstrumentation
+ * Usage: if (saveInstrumentation(filename, chrome)) ...
+ * -----------------------------------------------------
+ * Writes the recorded data to filename, as a Chrome trace if chrome
+ * is true and as JSON lines otherwise. Returns false if the file
+ * cannot be written.
+ */
+
+bool saveInstrumentation(const std::string & filename, bool chrome);
+
+#endif
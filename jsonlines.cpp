@@ -0,0 +1,298 @@
+/*
+ * File: jsonlines.cpp
+ * -------------------
+ * This file implements the JSON helpers with a recursive-descent
+ * parser over the characters of one line.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include "jsonlines.h"
+using namespace std;
+
+/* CONSTANTS */
+const int MAX_JSON_DEPTH = 64;
+
+
+/* Type: JsonReader
+ * ----------------
+ * The text being parsed and the position of the next character.
+ */
+
+struct JsonReader {
+    const string & text;
+    size_t next;
+
+    JsonReader(const string & text) : text(text), next(0) {}
+};
+
+static bool readValue(JsonReader & reader, JsonValue & value, int depth);
+
+
+/* Function: skipSpace
+ * Usage: skipSpace(reader);
+ * -------------------------
+ * Moves past any white space.
+ */
+
+static void skipSpace(JsonReader & reader) {
+    while (reader.next < reader.text.size()) {
+        char ch = reader.text[reader.next];
+        if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r') return;
+        reader.next++;
+    }
+}
+
+/* Function: readLiteral
+ * Usage: if (readLiteral(reader, "true")) ...
+ * -------------------------------------------
+ * Moves past word if the text continues with it.
+ */
+
+static bool readLiteral(JsonReader & reader, const string & word) {
+    if (reader.text.compare(reader.next, word.size(), word) != 0) return false;
+    reader.next += word.size();
+    return true;
+}
+
+/* Function: readHex
+ * Usage: if (readHex(reader, code)) ...
+ * -------------------------------------
+ * Reads the four hexadecimal digits of a \u escape.
+ */
+
+static bool readHex(JsonReader & reader, unsigned & code) {
+    if (reader.next + 4 > reader.text.size()) return false;
+    code = 0;
+    for (int i = 0; i < 4; i++) {
+        char ch = reader.text[reader.next++];
+        code <<= 4;
+        if (ch >= '0' && ch <= '9') {
+            code += ch - '0';
+        } else if (ch >= 'a' && ch <= 'f') {
+            code += ch - 'a' + 10;
+        } else if (ch >= 'A' && ch <= 'F') {
+            code += ch - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Function: appendUtf8
+ * Usage: appendUtf8(text, code);
+ * ------------------------------
+ * Appends the code point code to text in UTF-8.
+ */
+
+static void appendUtf8(string & text, unsigned code) {
+    if (code < 0x80) {
+        text += (char) code;
+    } else if (code < 0x800) {
+        text += (char) (0xC0 | (code >> 6));
+        text += (char) (0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        text += (char) (0xE0 | (code >> 12));
+        text += (char) (0x80 | ((code >> 6) & 0x3F));
+        text += (char) (0x80 | (code & 0x3F));
+    } else {
+        text += (char) (0xF0 | (code >> 18));
+        text += (char) (0x80 | ((code >> 12) & 0x3F));
+        text += (char) (0x80 | ((code >> 6) & 0x3F));
+        text += (char) (0x80 | (code & 0x3F));
+    }
+}
+
+/* Function: readString
+ * Usage: if (readString(reader, text)) ...
+ * ----------------------------------------
+ * Reads a quoted string, decoding its escapes. A \u escape for the
+ * first half of a surrogate pair is combined with the second.
+ */
+
+static bool readString(JsonReader & reader, string & text) {
+    if (reader.next >= reader.text.size() || reader.text[reader.next] != '"') return false;
+    reader.next++;
+    text.clear();
+    while (reader.next < reader.text.size()) {
+        char ch = reader.text[reader.next++];
+        if (ch == '"') return true;
+        if ((unsigned char) ch < ' ') return false;
+        if (ch != '\\') {
+            text += ch;
+            continue;
+        }
+        if (reader.next >= reader.text.size()) return false;
+        char escape = reader.text[reader.next++];
+        unsigned code;
+        switch (escape) {
+        case '"': case '\\': case '/': text += escape; break;
+        case 'b': text += '\b'; break;
+        case 'f': text += '\f'; break;
+        case 'n': text += '\n'; break;
+        case 'r': text += '\r'; break;
+        case 't': text += '\t'; break;
+        case 'u':
+            if (!readHex(reader, code)) return false;
+            if (code >= 0xD800 && code < 0xDC00 && readLiteral(reader, "\\u")) {
+                unsigned low;
+                if (!readHex(reader, low) || low < 0xDC00 || low >= 0xE000) return false;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            appendUtf8(text, code);
+            break;
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+/* Function: readNumber
+ * Usage: if (readNumber(reader, number, written)) ...
+ * ---------------------------------------------------
+ * Reads a number in JSON's syntax, keeping the text it was written
+ * as in written.
+ */
+
+static bool readNumber(JsonReader & reader, double & number, string & written) {
+    size_t start = reader.next;
+    const string & text = reader.text;
+    if (reader.next < text.size() && text[reader.next] == '-') reader.next++;
+    size_t digits = reader.next;
+    while (reader.next < text.size() && isdigit((unsigned char) text[reader.next])) reader.next++;
+    if (reader.next == digits) return false;
+    if (text[digits] == '0' && reader.next - digits > 1) return false;
+    if (reader.next < text.size() && text[reader.next] == '.') {
+        size_t fraction = ++reader.next;
+        while (reader.next < text.size() && isdigit((unsigned char) text[reader.next])) reader.next++;
+        if (reader.next == fraction) return false;
+    }
+    if (reader.next < text.size() && (text[reader.next] == 'e' || text[reader.next] == 'E')) {
+        reader.next++;
+        if (reader.next < text.size() && (text[reader.next] == '+' || text[reader.next] == '-')) reader.next++;
+        size_t exponent = reader.next;
+        while (reader.next < text.size() && isdigit((unsigned char) text[reader.next])) reader.next++;
+        if (reader.next == exponent) return false;
+    }
+    written = text.substr(start, reader.next - start);
+    number = strtod(written.c_str(), NULL);
+    return true;
+}
+
+/* Function: readArray
+ * Usage: if (readArray(reader, value, depth)) ...
+ * -----------------------------------------------
+ * Reads the elements of an array, whose opening bracket has been
+ * read, up to and including its closing bracket.
+ */
+
+static bool readArray(JsonReader & reader, JsonValue & value, int depth) {
+    value.type = JSON_ARRAY;
+    skipSpace(reader);
+    if (readLiteral(reader, "]")) return true;
+    while (true) {
+        value.items.push_back(JsonValue());
+        if (!readValue(reader, value.items.back(), depth + 1)) return false;
+        skipSpace(reader);
+        if (readLiteral(reader, "]")) return true;
+        if (!readLiteral(reader, ",")) return false;
+    }
+}
+
+/* Function: readObject
+ * Usage: if (readObject(reader, value, depth)) ...
+ * ------------------------------------------------
+ * Reads the members of an object, whose opening brace has been read,
+ * up to and including its closing brace.
+ */
+
+static bool readObject(JsonReader & reader, JsonValue & value, int depth) {
+    value.type = JSON_OBJECT;
+    skipSpace(reader);
+    if (readLiteral(reader, "}")) return true;
+    while (true) {
+        string key;
+        skipSpace(reader);
+        if (!readString(reader, key)) return false;
+        skipSpace(reader);
+        if (!readLiteral(reader, ":")) return false;
+        value.members.push_back(make_pair(key, JsonValue()));
+        if (!readValue(reader, value.members.back().second, depth + 1)) return false;
+        skipSpace(reader);
+        if (readLiteral(reader, "}")) return true;
+        if (!readLiteral(reader, ",")) return false;
+    }
+}
+
+/* Function: readValue
+ * Usage: if (readValue(reader, value, depth)) ...
+ * -----------------------------------------------
+ * Reads any value, refusing arrays and objects nested more than
+ * MAX_JSON_DEPTH deep so that a hostile line cannot overflow the
+ * stack.
+ */
+
+static bool readValue(JsonReader & reader, JsonValue & value, int depth) {
+    if (depth > MAX_JSON_DEPTH) return false;
+    skipSpace(reader);
+    if (reader.next >= reader.text.size()) return false;
+    char ch = reader.text[reader.next];
+    if (ch == '{') {
+        reader.next++;
+        return readObject(reader, value, depth);
+    }
+    if (ch == '[') {
+        reader.next++;
+        return readArray(reader, value, depth);
+    }
+    if (ch == '"') {
+        value.type = JSON_STRING;
+        return readString(reader, value.text);
+    }
+    if (readLiteral(reader, "true") || readLiteral(reader, "false")) {
+        value.type = JSON_BOOLEAN;
+        value.boolean = (ch == 't');
+        return true;
+    }
+    if (readLiteral(reader, "null")) {
+        value.type = JSON_NULL;
+        return true;
+    }
+    value.type = JSON_NUMBER;
+    return readNumber(reader, value.number, value.text);
+}
+
+const JsonValue *JsonValue::find(const string & key) const {
+    for (size_t i = 0; i < members.size(); i++) {
+        if (members[i].first == key) return &members[i].second;
+    }
+    return NULL;
+}
+
+bool parseJson(const string & text, JsonValue & value) {
+    JsonReader reader(text);
+    value = JsonValue();
+    if (!readValue(reader, value, 0)) return false;
+    skipSpace(reader);
+    return reader.next == text.size();
+}
+
+string jsonString(const string & text) {
+    ostringstream out;
+    out<<'"';
+    for (size_t i = 0; i < text.size(); i++) {
+        char ch = text[i];
+        if (ch == '"' || ch == '\\') {
+            out<<'\\'<<ch;
+        } else if ((unsigned char) ch < ' ') {
+            out<<"\\u00"<<"0123456789abcdef"[ch >> 4]<<"0123456789abcdef"[ch & 0xF];
+        } else {
+            out<<ch;
+        }
+    }
+    out<<'"';
+    return out.str();
+}
@@ -0,0 +1,70 @@
+/*
+ * File: jsonlines.h
+ * -----------------
+ * This file exports the small amount of JSON that the headless modes
+ * need: quoting a string for output, and reading one request line
+ * into a JsonValue tree. Numbers are read as doubles but also keep
+ * their text, and the members of an object keep the order they were
+ * written in.
+ */
+
+#ifndef _jsonlines_h
+#define _jsonlines_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Type: JsonType
+ * --------------
+ * The kinds of JSON value.
+ */
+
+enum JsonType { JSON_NULL, JSON_BOOLEAN, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+/* Type: JsonValue
+ * ---------------
+ * One parsed JSON value. Only the fields that match its type are
+ * used: boolean, number, text for a string or a number as written,
+ * items for an array and members for an object.
+ */
+
+struct JsonValue {
+    JsonType type;
+    bool boolean;
+    double number;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector< std::pair<std::string, JsonValue> > members;
+
+    JsonValue() : type(JSON_NULL), boolean(false), number(0) {}
+
+/* Method: find
+ * Usage: const JsonValue *field = value.find(key);
+ * ------------------------------------------------
+ * Returns the first member of an object with the given key, or NULL
+ * if there is none or the value is not an object.
+ */
+
+    const JsonValue *find(const std::string & key) const;
+};
+
+/* Function: parseJson
+ * Usage: if (parseJson(text, value)) ...
+ * --------------------------------------
+ * Parses text, which must hold exactly one JSON value apart from
+ * surrounding white space, into value. Returns false if text is not
+ * valid JSON.
+ */
+
+bool parseJson(const std::string & text, JsonValue & value);
+
+/* Function: jsonString
+ * Usage: out << jsonString(text);
+ * -------------------------------
+ * Returns text as a quoted JSON string literal.
+ */
+
+std::string jsonString(const std::string & text);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * File: linkcutforest.cpp
+ * -----------------------
+ * This file implements the LinkCutForest class. Each tree of the
+ * forest is split into preferred paths, and each path is kept in a
+ * splay tree ordered by depth. A splay tree's root points, through
+ * parent, to the node above the top of its path without being one of
+ * that node's children; isSplayRoot tells the two kinds of parent
+ * apart. Rerooting a tree reverses one path, which is recorded in a
+ * lazy flipped bit and pushed down before the children are used.
+ */
+
+#include <limits>
+#include "linkcutforest.h"
+using namespace std;
+
+/* CONSTANTS */
+const int NONE = LinkCutForest::NO_ELEMENT;
+const double NO_VALUE = -numeric_limits<double>::infinity();
+
+
+LinkCutForest::LinkCutForest(int size) {
+    reset(size);
+}
+
+void LinkCutForest::reset(int size) {
+    elements.clear();
+    grow(size);
+}
+
+void LinkCutForest::grow(int size) {
+    Element single = { { NONE, NONE }, NONE, false, NONE, NO_VALUE };
+    elements.resize(size, single);
+}
+
+int LinkCutForest::size() const {
+    return elements.size();
+}
+
+void LinkCutForest::setValue(int x, double value) {
+    access(x);
+    elements[x].value = value;
+    update(x);
+}
+
+void LinkCutForest::link(int x, int y) {
+    makeRoot(x);
+    elements[x].parent = y;
+}
+
+/* Method: cut
+ * -----------
+ * After x is made the root and y accessed, the path x-y is exactly
+ * y's splay tree with x as y's only smaller neighbor.
+ */
+
+void LinkCutForest::cut(int x, int y) {
+    makeRoot(x);
+    access(y);
+    int left = elements[y].child[0];
+    if (left != NONE) elements[left].parent = NONE;
+    elements[y].child[0] = NONE;
+    update(y);
+}
+
+bool LinkCutForest::connected(int x, int y) {
+    if (x == y) return true;
+    return findRoot(x) == findRoot(y);
+}
+
+int LinkCutForest::heaviestOnPath(int x, int y) {
+    makeRoot(x);
+    access(y);
+    int heaviest = elements[y].heaviest;
+    if (heaviest == NONE || elements[heaviest].value == NO_VALUE) return NONE;
+    return heaviest;
+}
+
+bool LinkCutForest::heavier(int x, int y) const {
+    if (y == NONE) return x != NONE;
+    if (x == NONE) return false;
+    if (elements[x].value != elements[y].value) return elements[x].value > elements[y].value;
+    return x > y;
+}
+
+bool LinkCutForest::isSplayRoot(int x) const {
+    int parent = elements[x].parent;
+    return parent == NONE || (elements[parent].child[0] != x && elements[parent].child[1] != x);
+}
+
+void LinkCutForest::pushDown(int x) {
+    Element & element = elements[x];
+    if (!element.flipped) return;
+    int left = element.child[0];
+    element.child[0] = element.child[1];
+    element.child[1] = left;
+    if (element.child[0] != NONE) elements[element.child[0]].flipped ^= true;
+    if (element.child[1] != NONE) elements[element.child[1]].flipped ^= true;
+    element.flipped = false;
+}
+
+void LinkCutForest::update(int x) {
+    int heaviest = x;
+    for (int side = 0; side < 2; side++) {
+        int child = elements[x].child[side];
+        if (child != NONE && heavier(elements[child].heaviest, heaviest)) {
+            heaviest = elements[child].heaviest;
+        }
+    }
+    elements[x].heaviest = heaviest;
+}
+
+/* Method: rotate
+ * --------------
+ * Moves x above its splay parent, which must already be pushed down.
+ */
+
+void LinkCutForest::rotate(int x) {
+    int parent = elements[x].parent;
+    int grandparent = elements[parent].parent;
+    int side = (elements[parent].child[1] == x) ? 1 : 0;
+    int moved = elements[x].child[1 - side];
+    if (!isSplayRoot(parent)) {
+        int parentSide = (elements[grandparent].child[1] == parent) ? 1 : 0;
+        elements[grandparent].child[parentSide] = x;
+    }
+    elements[x].parent = grandparent;
+    elements[x].child[1 - side] = parent;
+    elements[parent].parent = x;
+    elements[parent].child[side] = moved;
+    if (moved != NONE) elements[moved].parent = parent;
+    update(parent);
+    update(x);
+}
+
+/* Method: splay
+ * -------------
+ * Brings x to the root of its splay tree. The pending flips on the
+ * way up are pushed down first, top to bottom, so that the rotations
+ * see the true child order.
+ */
+
+void LinkCutForest::splay(int x) {
+    splayPath.clear();
+    int top = x;
+    splayPath.push_back(top);
+    while (!isSplayRoot(top)) {
+        top = elements[top].parent;
+        splayPath.push_back(top);
+    }
+    for (int i = splayPath.size() - 1; i >= 0; i--) {
+        pushDown(splayPath[i]);
+    }
+    while (!isSplayRoot(x)) {
+        int parent = elements[x].parent;
+        if (!isSplayRoot(parent)) {
+            int grandparent = elements[parent].parent;
+            bool zigZig = (elements[grandparent].child[0] == parent) == (elements[parent].child[0] == x);
+            rotate(zigZig ? parent : x);
+        }
+        rotate(x);
+    }
+}
+
+/* Method: access
+ * --------------
+ * Makes the path from the root of x's tree down to x preferred, so
+ * that it forms one splay tree rooted at x with nothing deeper.
+ */
+
+void LinkCutForest::access(int x) {
+    int last = NONE;
+    for (int y = x; y != NONE; y = elements[y].parent) {
+        splay(y);
+        elements[y].child[1] = last;
+        update(y);
+        last = y;
+    }
+    splay(x);
+}
+
+void LinkCutForest::makeRoot(int x) {
+    access(x);
+    elements[x].flipped ^= true;
+    pushDown(x);
+}
+
+int LinkCutForest::findRoot(int x) {
+    access(x);
+    int root = x;
+    pushDown(root);
+    while (elements[root].child[0] != NONE) {
+        root = elements[root].child[0];
+        pushDown(root);
+    }
+    splay(root);
+    return root;
+}
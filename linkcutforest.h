@@ -0,0 +1,132 @@
+/*
+ * File: linkcutforest.h
+ * ---------------------
+ * This file exports the LinkCutForest class, a dynamic forest over the
+ * integers [0, size) in which trees can be joined by an edge, split at
+ * an edge, and asked for the heaviest element on the path between two
+ * members. Every element carries a value; elements that should never
+ * be reported as the heaviest (such as the vertices of a graph whose
+ * edges are elements of their own) keep the default value -infinity.
+ * Each operation runs in O(log n) amortized time, using Sleator and
+ * Tarjan's splay-tree representation of preferred paths.
+ */
+
+#ifndef _linkcutforest_h
+#define _linkcutforest_h
+
+#include <vector>
+
+class LinkCutForest {
+
+public:
+
+/* Constant: NO_ELEMENT
+ * --------------------
+ * Returned by heaviestOnPath when the path has no valued element.
+ */
+
+    static const int NO_ELEMENT = -1;
+
+/* Constructor: LinkCutForest
+ * Usage: LinkCutForest forest(size);
+ * ----------------------------------
+ * Creates size single-element trees, one for each integer in
+ * [0, size), all with value -infinity.
+ */
+
+    LinkCutForest(int size = 0);
+
+/* Method: reset
+ * Usage: forest.reset(size);
+ * --------------------------
+ * Discards the current trees and starts over with size singletons.
+ */
+
+    void reset(int size);
+
+/* Method: grow
+ * Usage: forest.grow(size);
+ * -------------------------
+ * Adds singleton elements until there are size of them, leaving the
+ * existing trees alone.
+ */
+
+    void grow(int size);
+
+/* Method: size
+ * Usage: int n = forest.size();
+ * -----------------------------
+ * Returns the number of elements.
+ */
+
+    int size() const;
+
+/* Method: setValue
+ * Usage: forest.setValue(x, value);
+ * ---------------------------------
+ * Changes the value of x, which may be linked to others.
+ */
+
+    void setValue(int x, double value);
+
+/* Method: link
+ * Usage: forest.link(x, y);
+ * -------------------------
+ * Joins the trees containing x and y with an edge between them. The
+ * two must be in different trees.
+ */
+
+    void link(int x, int y);
+
+/* Method: cut
+ * Usage: forest.cut(x, y);
+ * ------------------------
+ * Removes the edge between x and y, which must have been linked.
+ */
+
+    void cut(int x, int y);
+
+/* Method: connected
+ * Usage: if (forest.connected(x, y)) ...
+ * --------------------------------------
+ * Returns true if x and y are in the same tree.
+ */
+
+    bool connected(int x, int y);
+
+/* Method: heaviestOnPath
+ * Usage: int heaviest = forest.heaviestOnPath(x, y);
+ * --------------------------------------------------
+ * Returns the element with the largest value on the tree path from x
+ * to y, which must be connected, breaking ties in favor of the larger
+ * element. Returns NO_ELEMENT if every value on the path is -infinity.
+ */
+
+    int heaviestOnPath(int x, int y);
+
+private:
+
+    struct Element {
+        int child[2];
+        int parent;
+        bool flipped;
+        int heaviest;
+        double value;
+    };
+
+    std::vector<Element> elements;
+    std::vector<int> splayPath;     /* scratch space for splay */
+
+    bool heavier(int x, int y) const;
+    bool isSplayRoot(int x) const;
+    void pushDown(int x);
+    void update(int x);
+    void rotate(int x);
+    void splay(int x);
+    void access(int x);
+    void makeRoot(int x);
+    int findRoot(int x);
+
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * File: maparena.cpp
+ * ------------------
+ * This file implements the MapArena class. Where mmap is available,
+ * regions are blocks of address space reserved with no access, pages
+ * are made writable in COMMIT_STEP chunks as the bump pointer passes
+ * them, and release hands the pages back to the system with a single
+ * madvise, however many objects they held. Elsewhere regions come
+ * from malloc.
+ */
+
+#include <cstdlib>
+#include <new>
+#include "maparena.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define PATHFINDER_HAS_MMAP 1
+#endif
+using namespace std;
+
+/* CONSTANTS */
+const size_t COMMIT_STEP = (size_t) 1 << 20;
+
+
+MapArena::MapArena() {
+    used = 0;
+}
+
+MapArena::~MapArena() {
+    for (size_t i = 0; i < regions.size(); i++) {
+        freeRegion(regions[i]);
+    }
+}
+
+void MapArena::reserve(size_t bytes) {
+    if (!makeRoom(bytes)) throw bad_alloc();
+}
+
+/* Method: makeRoom
+ * ----------------
+ * Adds a region when the last one has fewer than bytes left. Each
+ * new region is at least twice the size of the one before, so an
+ * arena that was not reserved for still needs only a few of them.
+ */
+
+bool MapArena::makeRoom(size_t bytes) {
+    if (!regions.empty() && regions.back().capacity - regions.back().used >= bytes) return true;
+    size_t capacity = regions.empty() ? COMMIT_STEP : 2 * regions.back().capacity;
+    if (capacity < bytes) capacity = bytes;
+    capacity = (capacity + COMMIT_STEP - 1) / COMMIT_STEP * COMMIT_STEP;
+#ifdef PATHFINDER_HAS_MMAP
+    void *address = mmap(NULL, capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (address == MAP_FAILED) return false;
+    Region region = { (char *) address, capacity, 0, 0 };
+#else
+    void *address = malloc(capacity);
+    if (address == NULL) return false;
+    Region region = { (char *) address, capacity, capacity, 0 };
+#endif
+    regions.push_back(region);
+    return true;
+}
+
+void MapArena::freeRegion(const Region & region) {
+#ifdef PATHFINDER_HAS_MMAP
+    munmap(region.base, region.capacity);
+#else
+    free(region.base);
+#endif
+}
+
+void *MapArena::allocate(size_t bytes, size_t alignment) {
+    if (!makeRoom(bytes + alignment - 1)) throw bad_alloc();
+    Region & region = regions.back();
+    size_t offset = (region.used + alignment - 1) / alignment * alignment;
+#ifdef PATHFINDER_HAS_MMAP
+    if (offset + bytes > region.committed) {
+        size_t wanted = (offset + bytes + COMMIT_STEP - 1) / COMMIT_STEP * COMMIT_STEP;
+        if (wanted > region.capacity) wanted = region.capacity;
+        if (mprotect(region.base + region.committed, wanted - region.committed,
+                     PROT_READ | PROT_WRITE) != 0) throw bad_alloc();
+        region.committed = wanted;
+    }
+#endif
+    used += offset + bytes - region.used;
+    region.used = offset + bytes;
+    return region.base + offset;
+}
+
+/* Method: release
+ * ---------------
+ * Only the last and largest region is kept. Its committed pages stay
+ * writable so the next map does not have to commit them again;
+ * MADV_DONTNEED drops their contents, and the system supplies fresh
+ * zero pages when they are next touched.
+ */
+
+void MapArena::release() {
+    if (regions.empty()) return;
+    for (size_t i = 0; i + 1 < regions.size(); i++) {
+        freeRegion(regions[i]);
+    }
+    regions.erase(regions.begin(), regions.end() - 1);
+    Region & last = regions.back();
+#ifdef PATHFINDER_HAS_MMAP
+    if (last.committed > 0) madvise(last.base, last.committed, MADV_DONTNEED);
+#endif
+    last.used = 0;
+    used = 0;
+}
+
+size_t MapArena::bytesUsed() const {
+    return used;
+}
@@ -0,0 +1,102 @@
+/*
+ * File: maparena.h
+ * ----------------
+ * This file exports the MapArena class, a bump allocator for objects
+ * of one kind. Objects are placed one after another in the order
+ * they are created, and everything the arena holds is freed in one
+ * step by release. A MapGraph keeps one arena for its nodes and one
+ * for its arcs, so a map's nodes sit next to each other in memory,
+ * as do its arcs.
+ */
+
+#ifndef _maparena_h
+#define _maparena_h
+
+#include <cstddef>
+#include <vector>
+
+class MapArena {
+
+public:
+
+/* Constructor: MapArena
+ * Usage: MapArena arena;
+ * ----------------------
+ * Creates an empty arena. Memory is reserved as it is needed.
+ */
+
+    MapArena();
+
+/* Destructor: ~MapArena
+ * Usage: (usually implicit)
+ * -------------------------
+ * Gives all of the arena's memory back to the system. The objects
+ * in it are not destroyed; that is the owner's job.
+ */
+
+    ~MapArena();
+
+/* Method: reserve
+ * Usage: arena.reserve(bytes);
+ * ----------------------------
+ * Makes sure the arena has room for this many more bytes in one
+ * piece, so that objects about to be created lie next to each other.
+ * Without it the arena grows as it fills.
+ */
+
+    void reserve(size_t bytes);
+
+/* Method: allocate
+ * Usage: void *memory = arena.allocate(bytes, alignment);
+ * -------------------------------------------------------
+ * Returns uninitialized memory for one object, valid until release.
+ * Throws bad_alloc if no memory can be had.
+ */
+
+    void *allocate(size_t bytes, size_t alignment);
+
+/* Method: release
+ * Usage: arena.release();
+ * -----------------------
+ * Frees everything the arena has allocated at once. Objects with
+ * destructors that matter must already have been destroyed.
+ */
+
+    void release();
+
+/* Method: bytesUsed
+ * Usage: size_t bytes = arena.bytesUsed();
+ * ----------------------------------------
+ * Returns the bytes allocated since the last release.
+ */
+
+    size_t bytesUsed() const;
+
+private:
+
+/* Type: Region
+ * ------------
+ * One block of memory. With mmap it is reserved with no access, and
+ * pages up to committed are readable and writable; used is the bump
+ * pointer. Only the last region is bumped.
+ */
+
+    struct Region {
+        char *base;
+        size_t capacity;
+        size_t committed;
+        size_t used;
+    };
+
+    std::vector<Region> regions;
+    size_t used;
+
+    bool makeRoom(size_t bytes);
+    void freeRegion(const Region & region);
+
+    MapArena(const MapArena &);
+    MapArena & operator=(const MapArena &);
+
+};
+
+#endif
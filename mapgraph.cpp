@@ -0,0 +1,114 @@
+/*
+ * File: mapgraph.cpp
+ * ------------------
+ * This file implements the MapGraph class. Nodes are constructed in
+ * place in the node arena and arcs in the arc arena. The name index
+ * views each node's own name, so no name is stored twice.
+ */
+
+#include <new>
+#include <type_traits>
+#include "mapgraph.h"
+using namespace std;
+
+static_assert(is_trivially_destructible<Arc>::value, "arcs are released without being destroyed");
+
+
+MapGraph::MapGraph() {
+    arcCount = 0;
+    nameBytes = 0;
+}
+
+MapGraph::~MapGraph() {
+    clear();
+}
+
+void MapGraph::reserve(size_t nodeCount, size_t arcCount) {
+    nodeArena.reserve(nodeCount * sizeof(Node));
+    arcArena.reserve(arcCount * sizeof(Arc));
+    nodes.reserve(nodes.size() + nodeCount);
+    nodeIndex.reserve(nodeIndex.size() + nodeCount);
+}
+
+/* Method: addNode
+ * ---------------
+ * A name that does not fit in the string's own buffer lives on the
+ * heap, which is counted in nameBytes.
+ */
+
+Node *MapGraph::addNode(string_view name, double x, double y) {
+    Node *node = new (nodeArena.allocate(sizeof(Node), alignof(Node))) Node;
+    node->name.assign(name.data(), name.size());
+    node->loc = GPoint(x, y);
+    const char *text = node->name.data();
+    if (text < (const char *) node || text >= (const char *) (node + 1)) {
+        nameBytes += node->name.capacity() + 1;
+    }
+    nodes.push_back(node);
+    nodeIndex[node->name] = node;
+    return node;
+}
+
+Arc *MapGraph::addArc(Node *start, Node *finish, double cost) {
+    Arc *arc = new (arcArena.allocate(sizeof(Arc), alignof(Arc))) Arc;
+    arc->start = start;
+    arc->finish = finish;
+    arc->cost = cost;
+    start->arcs.add(arc);
+    arcCount++;
+    return arc;
+}
+
+void MapGraph::removeArc(Arc *arc) {
+    arc->start->arcs.remove(arc);
+    arcCount--;
+}
+
+Node *MapGraph::getNode(string_view name) const {
+    unordered_map<string_view, Node *>::const_iterator entry = nodeIndex.find(name);
+    return (entry == nodeIndex.end()) ? NULL : entry->second;
+}
+
+const vector<Node *> & MapGraph::getNodes() const {
+    return nodes;
+}
+
+int MapGraph::size() const {
+    return nodes.size();
+}
+
+bool MapGraph::isEmpty() const {
+    return nodes.empty();
+}
+
+/* Method: clear
+ * -------------
+ * The index is cleared first because its keys view the names the
+ * node destructors free.
+ */
+
+void MapGraph::clear() {
+    nodeIndex.clear();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i]->~Node();
+    }
+    nodes.clear();
+    nodeArena.release();
+    arcArena.release();
+    arcCount = 0;
+    nameBytes = 0;
+}
+
+MapGraphStats MapGraph::getStats() const {
+    MapGraphStats stats;
+    stats.nodeCount = nodes.size();
+    stats.arcCount = arcCount;
+    stats.nodeBytes = nodeArena.bytesUsed();
+    stats.arcBytes = arcArena.bytesUsed();
+    stats.nameBytes = nameBytes;
+    return stats;
+}
+
+size_t MapGraph::totalBytes() const {
+    return nodeArena.bytesUsed() + arcArena.bytesUsed() + nameBytes;
+}
@@ -0,0 +1,165 @@
+/*
+ * File: mapgraph.h
+ * ----------------
+ * This file exports the MapGraph class, the graph of cities and roads
+ * that a map is loaded into. It offers the part of the library's
+ * Graph interface that Pathfinder uses, but it owns its nodes and
+ * arcs in two MapArenas (see maparena.h) instead of allocating each
+ * one with new. Nodes and arcs are laid out in the order they are
+ * added, and clearing the graph frees them all at once.
+ */
+
+#ifndef _mapgraph_h
+#define _mapgraph_h
+
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "graphtypes.h"
+#include "maparena.h"
+
+/* Type: MapGraphStats
+ * -------------------
+ * Counts what a graph holds. The node and arc bytes are the space
+ * used in its arenas; the name bytes are the heap space taken by
+ * city names too long to fit inside their Node.
+ */
+
+struct MapGraphStats {
+    int nodeCount;
+    int arcCount;
+    size_t nodeBytes;
+    size_t arcBytes;
+    size_t nameBytes;
+};
+
+class MapGraph {
+
+public:
+
+/* Constructor: MapGraph
+ * Usage: MapGraph graph;
+ * ----------------------
+ * Creates an empty graph.
+ */
+
+    MapGraph();
+
+/* Destructor: ~MapGraph
+ * Usage: (usually implicit)
+ * -------------------------
+ * Frees the graph's nodes and arcs.
+ */
+
+    ~MapGraph();
+
+/* Method: reserve
+ * Usage: graph.reserve(nodeCount, arcCount);
+ * ------------------------------------------
+ * Makes room for this many more nodes and arcs, so that a map about
+ * to be loaded lies in one piece of each arena.
+ */
+
+    void reserve(size_t nodeCount, size_t arcCount);
+
+/* Method: addNode
+ * Usage: Node *node = graph.addNode(name, x, y);
+ * ----------------------------------------------
+ * Creates a node with the given name and location and adds it to the
+ * graph. A later node with the same name replaces the earlier one in
+ * lookups by name.
+ */
+
+    Node *addNode(std::string_view name, double x, double y);
+
+/* Method: addArc
+ * Usage: Arc *arc = graph.addArc(start, finish, cost);
+ * ----------------------------------------------------
+ * Creates an arc from start to finish with the given cost and adds
+ * it to the arcs of start.
+ */
+
+    Arc *addArc(Node *start, Node *finish, double cost);
+
+/* Method: removeArc
+ * Usage: graph.removeArc(arc);
+ * ----------------------------
+ * Takes arc out of the arcs of its start node. Its memory is reused
+ * only when the graph is cleared, so the pointer stays readable.
+ */
+
+    void removeArc(Arc *arc);
+
+/* Method: getNode
+ * Usage: Node *node = graph.getNode(name);
+ * ----------------------------------------
+ * Returns the node with the given name, or NULL if there is none.
+ */
+
+    Node *getNode(std::string_view name) const;
+
+/* Method: getNodes
+ * Usage: foreach (Node *node in graph.getNodes()) ...
+ * ---------------------------------------------------
+ * Returns the nodes in the order they were added.
+ */
+
+    const std::vector<Node *> & getNodes() const;
+
+/* Method: size
+ * Usage: int count = graph.size();
+ * --------------------------------
+ * Returns the number of nodes.
+ */
+
+    int size() const;
+
+/* Method: isEmpty
+ * Usage: if (graph.isEmpty()) ...
+ * -------------------------------
+ * Returns true if the graph has no nodes.
+ */
+
+    bool isEmpty() const;
+
+/* Method: clear
+ * Usage: graph.clear();
+ * ---------------------
+ * Removes and frees every node and arc. Each node's destructor runs
+ * to free its set of arcs; the arena memory is released in one step.
+ */
+
+    void clear();
+
+/* Method: getStats
+ * Usage: MapGraphStats stats = graph.getStats();
+ * ----------------------------------------------
+ * Returns the counts and bytes for what the graph holds now.
+ */
+
+    MapGraphStats getStats() const;
+
+/* Method: totalBytes
+ * Usage: size_t bytes = graph.totalBytes();
+ * -----------------------------------------
+ * Returns the node, arc and name bytes together.
+ */
+
+    size_t totalBytes() const;
+
+private:
+
+    MapArena nodeArena;
+    MapArena arcArena;
+    std::vector<Node *> nodes;
+    std::unordered_map<std::string_view, Node *> nodeIndex;
+    int arcCount;
+    size_t nameBytes;
+
+    MapGraph(const MapGraph &);
+    MapGraph & operator=(const MapGraph &);
+
+};
+
+#endif
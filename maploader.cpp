@@ -0,0 +1,240 @@
+/*
+ * File: maploader.cpp
+ * -------------------
+ * This file implements the map file reader. The file is mapped into
+ * memory with MappedFile and tokenized in place: city names are
+ * viewed where they lie in the file, numbers are converted with
+ * std::from_chars, and the only strings allocated are the ones the
+ * Node structs keep. Every line is split on runs of whitespace, which
+ * reads both the single-space arcs of Small.txt and USA.txt and the
+ * column-aligned arcs of MiddleEarth.txt (whose distances the old
+ * fixed-column parser cut off after two characters).
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "maploader.h"
+#include "instrumentation.h"
+#include "mappedfile.h"
+using namespace std;
+
+/* CONSTANTS */
+const string_view NODES_HEADER = "NODES";
+const string_view ARCS_HEADER = "ARCS";
+
+
+/* Type: MapCursor
+ * ---------------
+ * The unread part of the mapped file.
+ */
+
+struct MapCursor {
+    const char *position;
+    const char *end;
+};
+
+
+/* Function prototypes */
+void processNodes(MapCursor & cursor, MapGraph & graph);
+void processArcs(MapCursor & cursor, MapGraph & graph);
+void addArcBetween(Node *one, Node *two, double distance, MapGraph & graph);
+
+
+/* Function: isSpace
+ * Usage: if (isSpace(ch)) ...
+ * ---------------------------
+ * Returns true for the blanks that separate tokens on a line.
+ */
+
+static inline bool isSpace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+/* Function: nextLine
+ * Usage: string_view line = nextLine(cursor);
+ * -------------------------------------------
+ * Returns the next line without its newline and advances past it.
+ */
+
+static string_view nextLine(MapCursor & cursor) {
+    const char *start = cursor.position;
+    const char *newline = (const char *) memchr(start, '\n', cursor.end - start);
+    const char *stop = (newline == NULL) ? cursor.end : newline;
+    cursor.position = (newline == NULL) ? cursor.end : newline + 1;
+    while (stop > start && isSpace(stop[-1])) stop--;
+    return string_view(start, stop - start);
+}
+
+/* Function: nextToken
+ * Usage: string_view token = nextToken(line);
+ * -------------------------------------------
+ * Removes and returns the first whitespace-delimited token of line.
+ * Returns an empty view when the line has no more tokens.
+ */
+
+static string_view nextToken(string_view & line) {
+    size_t first = 0;
+    while (first < line.size() && isSpace(line[first])) first++;
+    size_t last = first;
+    while (last < line.size() && !isSpace(line[last])) last++;
+    string_view token = line.substr(first, last - first);
+    line.remove_prefix(last);
+    return token;
+}
+
+/* Function: parseNumber
+ * Usage: if (parseNumber(token, value)) ...
+ * -----------------------------------------
+ * Converts token to a double. Returns false if it is not a number.
+ */
+
+static bool parseNumber(string_view token, double & value) {
+    if (!token.empty() && token[0] == '+') token.remove_prefix(1);
+    from_chars_result result = from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == errc() && result.ptr == token.data() + token.size();
+}
+
+/* Function: countSectionLines
+ * Usage: countSectionLines(cursor, nodeLines, arcLines);
+ * ------------------------------------------------------
+ * Counts the lines before the ARCS header, which hold at most one
+ * city each, and the lines after it, which hold at most one road
+ * each, without moving cursor.
+ */
+
+static void countSectionLines(MapCursor cursor, size_t & nodeLines, size_t & arcLines) {
+    nodeLines = 0;
+    while (cursor.position < cursor.end) {
+        string_view line = nextLine(cursor);
+        if (nextToken(line) == ARCS_HEADER) break;
+        nodeLines++;
+    }
+    arcLines = count(cursor.position, cursor.end, '\n') + 1;
+}
+
+
+/* Function: loadMapFile
+ * Usage: string imageName = loadMapFile(graph, mapName);
+ * ------------------------------------------------------
+ * This function maps the file, reads the image name from the first
+ * line, and then calls processNodes and processArcs to store the
+ * info in the relevant data structures. Every city and every road
+ * takes a line of its own, so countSectionLines bounds how much the
+ * graph has to reserve.
+ */
+
+string loadMapFile(MapGraph & graph, string mapName) {
+    PhaseTimer timer("parse");
+    MappedFile file;
+    if (!file.open(mapName) || file.size() == 0) return "";
+    MapCursor cursor = { file.data(), file.data() + file.size() };
+    size_t nodeLines, arcLines;
+    countSectionLines(cursor, nodeLines, arcLines);
+    graph.reserve(nodeLines, 2 * arcLines);
+    string imageName(nextLine(cursor));
+    processNodes(cursor, graph);
+    processArcs(cursor, graph);
+    timer.setArg("bytes", file.size());
+    timer.setArg("cities", graph.size());
+    return imageName;
+}
+
+
+/* Function: scanMapFile
+ * Usage: string imageName = scanMapFile(mapName, onCity, onRoad);
+ * ---------------------------------------------------------------
+ * This function reads the file with the same tokenizer as
+ * loadMapFile and skips the same malformed lines, but hands each
+ * line to a callback instead of the graph.
+ */
+
+string scanMapFile(const string & mapName, function<void(string_view, double, double)> onCity,
+                   function<void(string_view, string_view, double)> onRoad) {
+    PhaseTimer timer("scan");
+    MappedFile file;
+    if (!file.open(mapName) || file.size() == 0) return "";
+    MapCursor cursor = { file.data(), file.data() + file.size() };
+    string imageName(nextLine(cursor));
+    bool inArcs = false;
+    while (cursor.position < cursor.end) {
+        string_view line = nextLine(cursor);
+        string_view first = nextToken(line);
+        if (first.empty() || (!inArcs && first == NODES_HEADER)) continue;
+        if (!inArcs && first == ARCS_HEADER) {
+            inArcs = true;
+            continue;
+        }
+        string_view second = nextToken(line);
+        if (inArcs) {
+            double distance;
+            if (parseNumber(nextToken(line), distance)) onRoad(first, second, distance);
+        } else {
+            double xCoord, yCoord;
+            if (parseNumber(second, xCoord) && parseNumber(nextToken(line), yCoord)) onCity(first, xCoord, yCoord);
+        }
+    }
+    timer.setArg("bytes", file.size());
+    return imageName;
+}
+
+
+/* Function: processNodes
+ * Usage: processNodes(cursor, graph);
+ * -----------------------------------
+ * This function goes through each line of the NODES section, extracts
+ * the city name and location, and adds the node to the graph. Lines
+ * that do not hold a name and two numbers are skipped.
+ */
+
+void processNodes(MapCursor & cursor, MapGraph & graph) {
+    while (cursor.position < cursor.end) {
+        string_view line = nextLine(cursor);
+        string_view city = nextToken(line);
+        if (city == NODES_HEADER || city.empty()) continue;
+        if (city == ARCS_HEADER) return;
+        double xCoord, yCoord;
+        if (!parseNumber(nextToken(line), xCoord) || !parseNumber(nextToken(line), yCoord)) continue;
+        graph.addNode(city, xCoord, yCoord);
+    }
+}
+
+
+/* Function: processArcs
+ * Usage: processArcs(cursor, graph);
+ * ----------------------------------
+ * This function reads the "city city distance" lines of the ARCS
+ * section, looks both cities up by name, and adds the road
+ * to the graph. Lines naming an unknown city are skipped rather than
+ * producing arcs with missing endpoints.
+ */
+
+void processArcs(MapCursor & cursor, MapGraph & graph) {
+    while (cursor.position < cursor.end) {
+        string_view line = nextLine(cursor);
+        string_view first = nextToken(line);
+        if (first.empty()) continue;
+        string_view second = nextToken(line);
+        double distance;
+        if (!parseNumber(nextToken(line), distance)) continue;
+        Node *one = graph.getNode(first);
+        Node *two = graph.getNode(second);
+        if (one == NULL || two == NULL) continue;
+        addArcBetween(one, two, distance, graph);
+    }
+}
+
+
+/* Function: addArcBetween
+ * Usage: addArcBetween(one, two, distance, graph);
+ * ------------------------------------------------
+ * This function adds an Arc* in each direction between two nodes,
+ * since every road can be traveled both ways.
+ */
+
+void addArcBetween(Node *one, Node *two, double distance, MapGraph & graph) {
+    graph.addArc(one, two, distance);
+    graph.addArc(two, one, distance);
+}
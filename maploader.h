@@ -0,0 +1,48 @@
+/*
+ * File: maploader.h
+ * -----------------
+ * This file exports the functions that read a Pathfinder map file
+ * into a MapGraph. A map file starts with the name of its
+ * background image, then a NODES section with one "city x y" line per
+ * city, then an ARCS section with one "city city distance" line per
+ * road. Tokens on a line may be separated by any run of blanks.
+ * Loading does not touch the graphics window, so the same code serves
+ * the interactive program and the headless batch mode.
+ */
+
+#ifndef _maploader_h
+#define _maploader_h
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include "graphtypes.h"
+#include "mapgraph.h"
+
+/* Function: loadMapFile
+ * Usage: string imageName = loadMapFile(graph, mapName);
+ * ------------------------------------------------------
+ * Adds the nodes and arcs described in the file mapName to graph and
+ * returns the name of the map's background image. Returns the empty
+ * string if the file cannot be opened or is empty.
+ */
+
+std::string loadMapFile(MapGraph & graph, std::string mapName);
+
+/* Function: scanMapFile
+ * Usage: string imageName = scanMapFile(mapName, onCity, onRoad);
+ * ---------------------------------------------------------------
+ * Reads the file mapName line by line without building a graph,
+ * calling onCity(city, x, y) for each city of the NODES section and
+ * onRoad(one, two, distance) for each road of the ARCS section. The
+ * names are views into the file that only last until scanMapFile
+ * returns, and roads are reported even if their cities are unknown.
+ * Returns the name of the background image, or the empty string if
+ * the file cannot be opened or is empty.
+ */
+
+std::string scanMapFile(const std::string & mapName,
+                        std::function<void(std::string_view, double, double)> onCity,
+                        std::function<void(std::string_view, std::string_view, double)> onRoad);
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * File: mappedfile.cpp
+ * --------------------
+ * This file implements the MappedFile class.
+ */
+
+#include <fstream>
+#include "mappedfile.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PATHFINDER_HAS_MMAP 1
+#endif
+using namespace std;
+
+MappedFile::MappedFile() {
+    start = NULL;
+    length = 0;
+    mapped = false;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+/* Method: open
+ * ------------
+ * The descriptor can be closed as soon as the mapping exists. Empty
+ * files cannot be mapped, so they simply open with no data.
+ */
+
+bool MappedFile::open(const string & filename) {
+    close();
+#ifdef PATHFINDER_HAS_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    length = info.st_size;
+    if (length > 0) {
+        void *address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        madvise(address, length, MADV_SEQUENTIAL);
+        start = (const char *) address;
+        mapped = true;
+    }
+    ::close(fd);
+    return true;
+#else
+    ifstream infile(filename.c_str(), ios::binary);
+    if (infile.fail()) return false;
+    buffer.assign(istreambuf_iterator<char>(infile), istreambuf_iterator<char>());
+    length = buffer.size();
+    start = buffer.empty() ? NULL : &buffer[0];
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef PATHFINDER_HAS_MMAP
+    if (mapped) munmap((void *) start, length);
+#endif
+    buffer.clear();
+    start = NULL;
+    length = 0;
+    mapped = false;
+}
+
+const char *MappedFile::data() const {
+    return start;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,81 @@
+/*
+ * File: mappedfile.h
+ * ------------------
+ * This file exports the MappedFile class, which makes the contents
+ * of a file available as one read-only block of memory. On POSIX
+ * systems the file is memory-mapped, so pages are only read from disk
+ * when they are touched; elsewhere it is read into a buffer.
+ */
+
+#ifndef _mappedfile_h
+#define _mappedfile_h
+
+#include <string>
+#include <vector>
+
+class MappedFile {
+
+public:
+
+/* Constructor: MappedFile
+ * Usage: MappedFile file;
+ * -----------------------
+ * Creates a MappedFile that has no file open.
+ */
+
+    MappedFile();
+
+/* Destructor: ~MappedFile
+ * -----------------------
+ * Unmaps the file, if one is open.
+ */
+
+    ~MappedFile();
+
+/* Method: open
+ * Usage: if (file.open(filename)) ...
+ * -----------------------------------
+ * Maps filename into memory, closing any file already open. Returns
+ * false if the file cannot be read.
+ */
+
+    bool open(const std::string & filename);
+
+/* Method: close
+ * Usage: file.close();
+ * --------------------
+ * Unmaps the file. Pointers returned by data become invalid.
+ */
+
+    void close();
+
+/* Method: data
+ * Usage: const char *start = file.data();
+ * ---------------------------------------
+ * Returns the first byte of the file, or NULL if it is empty or no
+ * file is open.
+ */
+
+    const char *data() const;
+
+/* Method: size
+ * Usage: size_t bytes = file.size();
+ * ----------------------------------
+ * Returns the length of the file in bytes.
+ */
+
+    size_t size() const;
+
+private:
+
+    const char *start;
+    size_t length;
+    bool mapped;
+    std::vector<char> buffer;       /* used when mmap is unavailable */
+
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+
+};
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ * File: mapsnapshot.cpp
+ * ---------------------
+ * This file implements the binary map snapshot. The file is a fixed
+ * header followed by these sections, each padded to 8 bytes so the
+ * arrays can be used in place in the mapped file:
+ *
+ *      double      xCoord[nodeCount]
+ *      double      yCoord[nodeCount]
+ *      int32_t     arcOffset[nodeCount + 1]
+ *      int32_t     arcTarget[arcCount]
+ *      double      arcCost[arcCount]
+ *      uint32_t    nameOffset[nodeCount + 1]
+ *      char        names[nameBytes]
+ *      char        imageName[imageBytes]
+ *
+ * Cities are stored in the order of the map file, not in the order
+ * the GraphSnapshot gives them, so a warm load builds the graph in
+ * the same order as a cold one and the original IDs of the two
+ * agree. Numbers are stored in the machine's own byte order; the
+ * header records a marker so a snapshot from a different machine is
+ * simply rejected and rebuilt.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "mapsnapshot.h"
+#include "instrumentation.h"
+#include "maploader.h"
+#include "mappedfile.h"
+using namespace std;
+
+/* CONSTANTS */
+const char SNAPSHOT_MAGIC[8] = { 'P', 'F', 'S', 'N', 'A', 'P', '\r', '\n' };
+const uint32_t SNAPSHOT_VERSION = 2;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const string SNAPSHOT_EXTENSION = ".pfsnap";
+const string TEMPORARY_EXTENSION = ".tmp";
+const uint64_t CHECKSUM_SEED = 14695981039346656037ULL;
+const uint64_t CHECKSUM_PRIME = 1099511628211ULL;
+const size_t SECTION_ALIGNMENT = 8;
+
+
+/* Type: SnapshotHeader
+ * --------------------
+ * The fixed-size start of every snapshot file. checksum covers every
+ * byte after the header.
+ */
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t checksum;
+    uint32_t nodeCount;
+    uint32_t arcCount;
+    uint64_t nameBytes;
+    uint64_t imageBytes;
+};
+
+
+/* Function: padded
+ * Usage: size_t bytes = padded(size);
+ * -----------------------------------
+ * Rounds size up to a multiple of SECTION_ALIGNMENT.
+ */
+
+static inline size_t padded(size_t size) {
+    return (size + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+/* Function: payloadSize
+ * Usage: size_t bytes = payloadSize(header);
+ * ------------------------------------------
+ * Returns the number of bytes that follow the header.
+ */
+
+static size_t payloadSize(const SnapshotHeader & header) {
+    size_t nodes = header.nodeCount;
+    size_t arcs = header.arcCount;
+    return 2 * padded(nodes * sizeof(double))
+         + padded((nodes + 1) * sizeof(int32_t))
+         + padded(arcs * sizeof(int32_t))
+         + padded(arcs * sizeof(double))
+         + padded((nodes + 1) * sizeof(uint32_t))
+         + padded(header.nameBytes)
+         + padded(header.imageBytes);
+}
+
+/* Function: computeChecksum
+ * Usage: uint64_t sum = computeChecksum(data, size);
+ * --------------------------------------------------
+ * Returns an FNV-style hash of size bytes (a multiple of 8), mixed a
+ * word at a time so that verifying a large snapshot stays cheap.
+ */
+
+static uint64_t computeChecksum(const char *data, size_t size) {
+    uint64_t sum = CHECKSUM_SEED;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        sum = (sum ^ word) * CHECKSUM_PRIME;
+    }
+    return sum;
+}
+
+/* Function: getSourceStamp
+ * Usage: if (getSourceStamp(mapName, size, time)) ...
+ * ---------------------------------------------------
+ * Reads the size and modification time of the text map file.
+ */
+
+static bool getSourceStamp(const string & mapName, uint64_t & size, int64_t & time) {
+    error_code error;
+    size = filesystem::file_size(mapName, error);
+    if (error) return false;
+    filesystem::file_time_type modified = filesystem::last_write_time(mapName, error);
+    if (error) return false;
+    time = modified.time_since_epoch().count();
+    return true;
+}
+
+/* Function: appendSection
+ * Usage: appendSection(payload, data, bytes);
+ * -------------------------------------------
+ * Appends bytes of data to payload followed by zero padding.
+ */
+
+static void appendSection(vector<char> & payload, const void *data, size_t bytes) {
+    const char *start = (const char *) data;
+    payload.insert(payload.end(), start, start + bytes);
+    payload.resize(payload.size() + padded(bytes) - bytes, 0);
+}
+
+
+string mapSnapshotName(const string & mapName) {
+    return mapName + SNAPSHOT_EXTENSION;
+}
+
+string loadMap(MapGraph & graph, string mapName) {
+    PhaseTimer timer("load");
+    string imageName;
+    if (readMapSnapshot(graph, mapName, imageName)) {
+        refreshGraphSnapshot(graph);
+        return imageName;
+    }
+    imageName = loadMapFile(graph, mapName);
+    refreshGraphSnapshot(graph);
+    if (!imageName.empty()) writeMapSnapshot(getGraphSnapshot(), imageName, mapName);
+    return imageName;
+}
+
+bool writeMapSnapshot(const GraphSnapshot & snapshot, const string & imageName, const string & mapName) {
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    if (!getSourceStamp(mapName, header.sourceSize, header.sourceTime)) return false;
+    int nodeCount = snapshot.nodeCount();
+    header.nodeCount = nodeCount;
+    header.arcCount = snapshot.arcCount();
+    header.imageBytes = imageName.size();
+
+    vector<double> xCoord(nodeCount), yCoord(nodeCount);
+    vector<int32_t> arcOffset(nodeCount + 1, 0), arcTarget;
+    vector<double> arcCost;
+    vector<uint32_t> nameOffset(nodeCount + 1, 0);
+    string names;
+    arcTarget.reserve(header.arcCount);
+    arcCost.reserve(header.arcCount);
+    for (int i = 0; i < nodeCount; i++) {
+        int id = snapshot.snapshotIds[i];
+        xCoord[i] = snapshot.xCoord[id];
+        yCoord[i] = snapshot.yCoord[id];
+        for (int a = snapshot.arcOffset[id]; a < snapshot.arcOffset[id + 1]; a++) {
+            arcTarget.push_back(snapshot.originalIds[snapshot.arcTarget[a]]);
+            arcCost.push_back(snapshot.arcCost[a]);
+        }
+        arcOffset[i + 1] = arcTarget.size();
+        names += snapshot.names[id];
+        nameOffset[i + 1] = names.size();
+    }
+    header.nameBytes = names.size();
+
+    vector<char> payload;
+    payload.reserve(payloadSize(header));
+    appendSection(payload, xCoord.data(), nodeCount * sizeof(double));
+    appendSection(payload, yCoord.data(), nodeCount * sizeof(double));
+    appendSection(payload, arcOffset.data(), (nodeCount + 1) * sizeof(int32_t));
+    appendSection(payload, arcTarget.data(), header.arcCount * sizeof(int32_t));
+    appendSection(payload, arcCost.data(), header.arcCount * sizeof(double));
+    appendSection(payload, nameOffset.data(), (nodeCount + 1) * sizeof(uint32_t));
+    appendSection(payload, names.data(), names.size());
+    appendSection(payload, imageName.data(), imageName.size());
+    header.checksum = computeChecksum(payload.data(), payload.size());
+
+    string finalName = mapSnapshotName(mapName);
+    string temporaryName = finalName + TEMPORARY_EXTENSION;
+    ofstream outfile(temporaryName.c_str(), ios::binary | ios::trunc);
+    if (outfile.fail()) return false;
+    outfile.write((const char *) &header, sizeof(header));
+    outfile.write(payload.data(), payload.size());
+    outfile.close();
+    if (outfile.fail()) {
+        remove(temporaryName.c_str());
+        return false;
+    }
+    return rename(temporaryName.c_str(), finalName.c_str()) == 0;
+}
+
+/* Function: readMapSnapshot
+ * -------------------------
+ * The whole file is validated before the graph is changed: header
+ * fields, the exact file length, the checksum, and that the offsets
+ * and arc targets are in range. Nodes are then created in the order
+ * of the map file, and each node's arcs after them.
+ */
+
+bool readMapSnapshot(MapGraph & graph, const string & mapName, string & imageName) {
+    PhaseTimer timer("read snapshot");
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (!getSourceStamp(mapName, sourceSize, sourceTime)) return false;
+    MappedFile file;
+    if (!file.open(mapSnapshotName(mapName)) || file.size() < sizeof(SnapshotHeader)) return false;
+    SnapshotHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) return false;
+    if (header.version != SNAPSHOT_VERSION || header.byteOrder != BYTE_ORDER_MARK) return false;
+    if (header.sourceSize != sourceSize || header.sourceTime != sourceTime) return false;
+    if (file.size() != sizeof(header) + payloadSize(header)) return false;
+    const char *payload = file.data() + sizeof(header);
+    if (computeChecksum(payload, payloadSize(header)) != header.checksum) return false;
+
+    size_t nodeCount = header.nodeCount;
+    size_t arcCount = header.arcCount;
+    const double *xCoord = (const double *) payload;
+    const double *yCoord = (const double *) (payload + padded(nodeCount * sizeof(double)));
+    const char *cursor = payload + 2 * padded(nodeCount * sizeof(double));
+    const int32_t *arcOffset = (const int32_t *) cursor;
+    cursor += padded((nodeCount + 1) * sizeof(int32_t));
+    const int32_t *arcTarget = (const int32_t *) cursor;
+    cursor += padded(arcCount * sizeof(int32_t));
+    const double *arcCost = (const double *) cursor;
+    cursor += padded(arcCount * sizeof(double));
+    const uint32_t *nameOffset = (const uint32_t *) cursor;
+    cursor += padded((nodeCount + 1) * sizeof(uint32_t));
+    const char *names = cursor;
+    const char *image = cursor + padded(header.nameBytes);
+
+    if (arcOffset[0] != 0 || (size_t) arcOffset[nodeCount] != arcCount) return false;
+    if (nameOffset[0] != 0 || nameOffset[nodeCount] != header.nameBytes) return false;
+    for (size_t i = 0; i < nodeCount; i++) {
+        if (arcOffset[i] > arcOffset[i + 1] || nameOffset[i] > nameOffset[i + 1]) return false;
+    }
+    for (size_t a = 0; a < arcCount; a++) {
+        if (arcTarget[a] < 0 || (size_t) arcTarget[a] >= nodeCount) return false;
+    }
+
+    graph.reserve(nodeCount, arcCount);
+    vector<Node *> nodes(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        string_view name(names + nameOffset[i], nameOffset[i + 1] - nameOffset[i]);
+        nodes[i] = graph.addNode(name, xCoord[i], yCoord[i]);
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        for (int32_t a = arcOffset[i]; a < arcOffset[i + 1]; a++) {
+            graph.addArc(nodes[i], nodes[arcTarget[a]], arcCost[a]);
+        }
+    }
+    imageName.assign(image, header.imageBytes);
+    return true;
+}
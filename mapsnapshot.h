@@ -0,0 +1,64 @@
+/*
+ * File: mapsnapshot.h
+ * -------------------
+ * This file exports the binary map snapshot, a cache of a parsed map
+ * file stored next to it as <map>.pfsnap. The snapshot holds the
+ * background image name, the city names and coordinates in the
+ * order of the map file, and the arcs in CSR form with their costs.
+ * Later loads memory-map it and rebuild the graph straight from its
+ * arrays instead of parsing text.
+ *
+ * A snapshot is used only if its format version matches, it records
+ * the current size and modification time of the text file, and the
+ * checksum of its contents is correct. Otherwise the text is parsed
+ * again and the snapshot rewritten.
+ */
+
+#ifndef _mapsnapshot_h
+#define _mapsnapshot_h
+
+#include <string>
+#include "graphsnapshot.h"
+#include "mapgraph.h"
+
+/* Function: loadMap
+ * Usage: string imageName = loadMap(graph, mapName);
+ * --------------------------------------------------
+ * Fills graph from the map file mapName, using its binary snapshot
+ * when one is valid and writing a fresh snapshot otherwise, then
+ * rebuilds the current GraphSnapshot. Returns the name of the map's
+ * background image, or the empty string if the map cannot be read.
+ */
+
+std::string loadMap(MapGraph & graph, std::string mapName);
+
+/* Function: readMapSnapshot
+ * Usage: if (readMapSnapshot(graph, mapName, imageName)) ...
+ * ----------------------------------------------------------
+ * Fills graph from the snapshot of mapName and sets imageName.
+ * Returns false, leaving graph untouched, if there is no valid
+ * snapshot.
+ */
+
+bool readMapSnapshot(MapGraph & graph, const std::string & mapName, std::string & imageName);
+
+/* Function: writeMapSnapshot
+ * Usage: if (writeMapSnapshot(snapshot, imageName, mapName)) ...
+ * --------------------------------------------------------------
+ * Writes the snapshot of mapName from a GraphSnapshot of its graph.
+ * The file is written under a temporary name and then renamed, so a
+ * reader never sees a partial snapshot. Returns false on failure.
+ */
+
+bool writeMapSnapshot(const GraphSnapshot & snapshot, const std::string & imageName,
+                      const std::string & mapName);
+
+/* Function: mapSnapshotName
+ * Usage: string snapshotName = mapSnapshotName(mapName);
+ * ------------------------------------------------------
+ * Returns the name of the snapshot file for mapName.
+ */
+
+std::string mapSnapshotName(const std::string & mapName);
+
+#endif
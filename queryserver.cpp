@@ -0,0 +1,1129 @@
+/*
+ * File: queryserver.cpp
+ * ---------------------
+ * This file implements the server and client modes. One reader thread
+ * per input turns lines into ServerRequests, resolving city names
+ * against the immutable snapshots, and queues them. The main thread
+ * takes the queue a batch at a time, groups the searches of the batch
+ * by source, runs them on the shared ThreadPool with one SearchState
+ * per worker and map, and queues the answers on each connection's
+ * outbox. Sockets are non-blocking: the main thread writes what each
+ * socket takes and retries the rest between batches, so a client that
+ * reads slowly delays no one else, and one whose outbox grows past
+ * MAX_OUTBOX_BYTES is dropped. Only the main thread writes to the
+ * clients, so a connection needs no lock; it is closed once its
+ * reader, its requests and its unsent answers have let go of it.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "queryserver.h"
+#include "graphsnapshot.h"
+#include "jsonlines.h"
+#include "mapsnapshot.h"
+#include "shortestpath.h"
+#include "spanningtree.h"
+#include "threadpool.h"
+using namespace std;
+
+/* CONSTANTS */
+const int COST_PRECISION = 12;
+const int DEFAULT_BATCH_WINDOW_MS = 2;
+const size_t MAX_BATCH_REQUESTS = 4096;
+const size_t LATENCY_SAMPLES = 8192;
+const size_t MAX_REQUEST_BYTES = 1 << 20;
+const size_t READ_CHUNK = 1 << 16;
+const int POLL_INTERVAL_MS = 100;
+const int OUTBOX_RETRY_MS = 5;
+const int SHUTDOWN_FLUSH_MS = 2000;
+const size_t MAX_OUTBOX_BYTES = 64 << 20;
+const int LISTEN_BACKLOG = 16;
+const string STATUS_OK = "ok";
+const string STATUS_UNREACHABLE = "unreachable";
+const string STATUS_UNKNOWN_CITY = "unknown city";
+const string STATUS_UNKNOWN_MAP = "unknown map";
+const string STATUS_BAD_REQUEST = "bad request";
+
+
+/* Type: ServedMap
+ * ---------------
+ * A map the server answers on: the name requests use for it, its
+ * graph and snapshot, and its minimum spanning tree once a request
+ * has asked for it.
+ */
+
+struct ServedMap {
+    string name;
+    MapGraph graph;
+    GraphSnapshot snapshot;
+    bool treeBuilt;
+    Path tree;
+};
+
+/* Type: Connection
+ * ----------------
+ * The file descriptor a client's answers are written to, and the
+ * answers not yet written: outbox from sent onward. A dropped
+ * connection takes no more answers. Descriptors the server opened are
+ * closed when the last reference goes.
+ */
+
+struct Connection {
+    int fd;
+    bool owned;
+    bool dropped;
+    bool waiting;               /* in ServerState::backlog */
+    string outbox;
+    size_t sent;
+
+    Connection(int fd, bool owned) : fd(fd), owned(owned), dropped(false), waiting(false), sent(0) {}
+    ~Connection() { if (owned) close(fd); }
+};
+
+/* Type: RequestType
+ * -----------------
+ * The kinds of request, with INVALID_REQUEST for a line that is not
+ * one of them.
+ */
+
+enum RequestType { ROUTE_REQUEST, MATRIX_REQUEST, MST_REQUEST, STATS_REQUEST, SHUTDOWN_REQUEST, INVALID_REQUEST };
+
+/* Type: ServerRequest
+ * -------------------
+ * One request and, once its batch has run, its answer. id is the
+ * request's id already written as JSON, or empty. A route has one
+ * source and one target; a matrix has any number of each, and costs
+ * holds its answer in row-major order. status is STATUS_OK unless the
+ * request cannot be answered, and detail then names the unknown city
+ * or map or says what is wrong.
+ */
+
+struct ServerRequest {
+    shared_ptr<Connection> client;
+    chrono::steady_clock::time_point arrival;
+    RequestType type;
+    string id;
+    string status;
+    string detail;
+    int mapIndex;
+    vector<string> sourceNames;
+    vector<string> targetNames;
+    vector<int> sources;
+    vector<int> targets;
+    vector<double> costs;
+    Path path;
+};
+
+/* Type: SourceSearch
+ * ------------------
+ * One search of a batch: a source city of a map, every target the
+ * batch asks for from it, and the requests that use it, each with the
+ * matrix row it fills or -1 for a route.
+ */
+
+struct SourceSearch {
+    int mapIndex;
+    int source;
+    vector<int> targets;
+    vector< pair<int, int> > uses;
+};
+
+/* Type: ServerOptions
+ * -------------------
+ * The settings parsed from the command line.
+ */
+
+struct ServerOptions {
+    vector< pair<string, string> > maps;        /* name and file */
+    string socketPath;
+    int batchWindowMs;
+    NodeOrder nodeOrder;
+};
+
+
+/* Class: RequestQueue
+ * -------------------
+ * The requests waiting for the main thread. The readers push onto it
+ * and the main thread takes a batch at a time; it also tracks the
+ * deepest it has been.
+ */
+
+class RequestQueue {
+
+public:
+
+    RequestQueue() : closed(false), maxDepth(0) {}
+
+/* Method: push
+ * Usage: queue.push(request);
+ * ---------------------------
+ * Adds a request and wakes the main thread.
+ */
+
+    void push(const ServerRequest & request) {
+        lock_guard<mutex> guard(lock);
+        waiting.push_back(request);
+        maxDepth = max(maxDepth, (int) waiting.size());
+        ready.notify_one();
+    }
+
+/* Method: close
+ * Usage: queue.close();
+ * ---------------------
+ * Says that no more requests will come, so that takeBatch returns
+ * false once the queue is empty.
+ */
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        ready.notify_one();
+    }
+
+/* Method: takeBatch
+ * Usage: if (queue.takeBatch(batch, windowMs, idleMs)) ...
+ * --------------------------------------------------------
+ * Waits for a request, then until windowMs after it arrived unless
+ * MAX_BATCH_REQUESTS are waiting first, and moves up to that many
+ * into batch. If idleMs is not negative and no request comes within
+ * idleMs, batch is left empty. Returns false if the queue is closed
+ * and empty.
+ */
+
+    bool takeBatch(vector<ServerRequest> & batch, int windowMs, int idleMs = -1) {
+        unique_lock<mutex> guard(lock);
+        batch.clear();
+        auto pending = [this]() { return !waiting.empty() || closed; };
+        if (idleMs < 0) {
+            ready.wait(guard, pending);
+        } else if (!ready.wait_for(guard, chrono::milliseconds(idleMs), pending)) {
+            return true;
+        }
+        if (waiting.empty()) return false;
+        chrono::steady_clock::time_point deadline = waiting.front().arrival + chrono::milliseconds(windowMs);
+        ready.wait_until(guard, deadline, [this]() { return closed || waiting.size() >= MAX_BATCH_REQUESTS; });
+        size_t count = min(waiting.size(), MAX_BATCH_REQUESTS);
+        batch.assign(waiting.begin(), waiting.begin() + count);
+        waiting.erase(waiting.begin(), waiting.begin() + count);
+        return true;
+    }
+
+/* Method: getDepth
+ * Usage: int depth = queue.getDepth();
+ * ------------------------------------
+ * Returns how many requests are waiting.
+ */
+
+    int getDepth() {
+        lock_guard<mutex> guard(lock);
+        return waiting.size();
+    }
+
+/* Method: getMaxDepth
+ * Usage: int depth = queue.getMaxDepth();
+ * ---------------------------------------
+ * Returns the most requests that have been waiting at once.
+ */
+
+    int getMaxDepth() {
+        lock_guard<mutex> guard(lock);
+        return maxDepth;
+    }
+
+private:
+
+    mutex lock;
+    condition_variable ready;
+    deque<ServerRequest> waiting;
+    bool closed;
+    int maxDepth;
+
+};
+
+/* Type: ServerState
+ * -----------------
+ * Everything the threads of a running server share: the maps, the
+ * queue, the flag that stops the readers, and the main thread's
+ * per-worker search scratch, connections with unsent answers and
+ * statistics. latencies is a ring of the last LATENCY_SAMPLES answer
+ * times in seconds.
+ */
+
+struct ServerState {
+    deque<ServedMap> maps;
+    RequestQueue queue;
+    atomic<bool> stopping;
+    vector< vector<SearchState> > states;           /* by map, then worker */
+    vector< vector< vector<char> > > targetMarks;   /* by map, then worker */
+    vector< shared_ptr<Connection> > backlog;
+    vector<double> latencies;
+    size_t nextLatency;
+    long long requests;
+    long long batches;
+    long long searches;
+    long long droppedClients;
+};
+
+
+/* Function: mapNameOf
+ * Usage: string name = mapNameOf(fileName);
+ * -----------------------------------------
+ * Returns fileName without its directory or extension.
+ */
+
+static string mapNameOf(const string & fileName) {
+    size_t slash = fileName.find_last_of('/');
+    string name = (slash == string::npos) ? fileName : fileName.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return (dot == string::npos || dot == 0) ? name : name.substr(0, dot);
+}
+
+/* Function: printServerUsage
+ * Usage: printServerUsage(programName);
+ * -------------------------------------
+ * Describes the command-line arguments on standard error.
+ */
+
+static void printServerUsage(const string & programName) {
+    cerr<<"Usage: "<<programName<<" --serve --map [NAME=]FILE [--map [NAME=]FILE ...] [--socket PATH]"
+        <<" [--batch-ms N] [--order graph|hilbert|bfs]"<<endl;
+    cerr<<"       "<<programName<<" --client PATH"<<endl;
+}
+
+/* Function: parseMilliseconds
+ * Usage: if (parseMilliseconds(value, ms)) ...
+ * --------------------------------------------
+ * Reads value as a whole number of milliseconds. Returns false if it
+ * is not made of digits alone or is too large for an int.
+ */
+
+static bool parseMilliseconds(const string & value, int & ms) {
+    if (value.empty() || value.find_first_not_of("0123456789") != string::npos) return false;
+    errno = 0;
+    char *end;
+    long number = strtol(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || number > INT_MAX) return false;
+    ms = (int) number;
+    return true;
+}
+
+/* Function: parseServerOptions
+ * Usage: if (parseServerOptions(argc, argv, options)) ...
+ * -------------------------------------------------------
+ * Fills options from the command line. Returns false if the
+ * arguments are not valid or name no map.
+ */
+
+static bool parseServerOptions(int argc, char *argv[], ServerOptions & options) {
+    options.batchWindowMs = DEFAULT_BATCH_WINDOW_MS;
+    options.nodeOrder = DEFAULT_NODE_ORDER;
+    for (int i = 2; i < argc; i += 2) {
+        string flag = argv[i];
+        if (i + 1 >= argc) return false;
+        string value = argv[i + 1];
+        if (flag == "--map" && !value.empty()) {
+            size_t equals = value.find('=');
+            if (equals == string::npos) {
+                options.maps.push_back(make_pair(mapNameOf(value), value));
+            } else {
+                options.maps.push_back(make_pair(value.substr(0, equals), value.substr(equals + 1)));
+            }
+        } else if (flag == "--socket" && !value.empty()) {
+            options.socketPath = value;
+        } else if (flag == "--batch-ms" && parseMilliseconds(value, options.batchWindowMs)) {
+            continue;
+        } else if (flag == "--order" && parseNodeOrder(value, options.nodeOrder)) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return !options.maps.empty();
+}
+
+/* Function: loadServedMaps
+ * Usage: if (loadServedMaps(options, state)) ...
+ * ----------------------------------------------
+ * Loads every map into state, keeping a copy of each snapshot, and
+ * then drops the program-wide snapshot, which the server does not
+ * use. Returns false, after saying which on standard error, if a map
+ * cannot be read or two share a name.
+ */
+
+static bool loadServedMaps(const ServerOptions & options, ServerState & state) {
+    for (size_t i = 0; i < options.maps.size(); i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (options.maps[j].first == options.maps[i].first) {
+                cerr<<"Two maps are named "<<options.maps[i].first<<endl;
+                return false;
+            }
+        }
+        state.maps.emplace_back();
+        ServedMap & served = state.maps.back();
+        served.name = options.maps[i].first;
+        served.treeBuilt = false;
+        if (loadMap(served.graph, options.maps[i].second).empty() && served.graph.isEmpty()) {
+            cerr<<"Could not read map "<<options.maps[i].second<<endl;
+            return false;
+        }
+        served.snapshot = getGraphSnapshot();
+        cerr<<"Loaded "<<served.name<<": "<<served.snapshot.nodeCount()<<" nodes, "
+            <<served.snapshot.arcCount()<<" arcs, "<<served.graph.totalBytes()<<" bytes"<<endl;
+    }
+    clearGraphSnapshot();
+    return true;
+}
+
+/* Function: jsonNumber
+ * Usage: out << jsonNumber(number);
+ * ---------------------------------
+ * Returns number as JSON, or null if it is infinite.
+ */
+
+static string jsonNumber(double number) {
+    if (number == INFINITE_DISTANCE) return "null";
+    ostringstream out;
+    out.precision(COST_PRECISION);
+    out<<number;
+    return out.str();
+}
+
+/* Function: readNames
+ * Usage: if (readNames(request, key, names)) ...
+ * ----------------------------------------------
+ * Stores the strings of the request's array member key in names.
+ * Returns false if there is no such array or it holds anything but
+ * strings.
+ */
+
+static bool readNames(const JsonValue & request, const string & key, vector<string> & names) {
+    const JsonValue *list = request.find(key);
+    if (list == NULL || list->type != JSON_ARRAY) return false;
+    for (size_t i = 0; i < list->items.size(); i++) {
+        if (list->items[i].type != JSON_STRING) return false;
+        names.push_back(list->items[i].text);
+    }
+    return true;
+}
+
+/* Function: readName
+ * Usage: if (readName(request, key, names)) ...
+ * ---------------------------------------------
+ * Appends the request's string member key to names. Returns false if
+ * there is no such string.
+ */
+
+static bool readName(const JsonValue & request, const string & key, vector<string> & names) {
+    const JsonValue *field = request.find(key);
+    if (field == NULL || field->type != JSON_STRING) return false;
+    names.push_back(field->text);
+    return true;
+}
+
+/* Function: resolveCities
+ * Usage: if (resolveCities(snapshot, names, ids, request)) ...
+ * ------------------------------------------------------------
+ * Looks up the node IDs of names, marking request with the first
+ * name that is not a city of the snapshot.
+ */
+
+static bool resolveCities(const GraphSnapshot & snapshot, const vector<string> & names, vector<int> & ids,
+                          ServerRequest & request) {
+    for (size_t i = 0; i < names.size(); i++) {
+        ids.push_back(snapshotNodeId(snapshot, names[i]));
+        if (ids.back() == NO_NODE) {
+            request.status = STATUS_UNKNOWN_CITY;
+            request.detail = names[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Function: parseRequest
+ * Usage: ServerRequest request = parseRequest(line, maps);
+ * --------------------------------------------------------
+ * Turns one line into a request, finding its map and the node IDs of
+ * its cities. A line that cannot be answered becomes a request with
+ * a status other than STATUS_OK.
+ */
+
+static ServerRequest parseRequest(const string & line, const deque<ServedMap> & maps) {
+    ServerRequest request;
+    request.type = INVALID_REQUEST;
+    request.status = STATUS_BAD_REQUEST;
+    request.mapIndex = 0;
+    JsonValue value;
+    if (!parseJson(line, value) || value.type != JSON_OBJECT) {
+        request.detail = "not a JSON object";
+        return request;
+    }
+    const JsonValue *id = value.find("id");
+    if (id != NULL && id->type == JSON_STRING) request.id = jsonString(id->text);
+    if (id != NULL && id->type == JSON_NUMBER) request.id = id->text;
+    const JsonValue *type = value.find("type");
+    string typeName = (type != NULL && type->type == JSON_STRING) ? type->text : "";
+    if (typeName == "route") {
+        request.type = ROUTE_REQUEST;
+    } else if (typeName == "matrix") {
+        request.type = MATRIX_REQUEST;
+    } else if (typeName == "mst") {
+        request.type = MST_REQUEST;
+    } else if (typeName == "stats") {
+        request.type = STATS_REQUEST;
+    } else if (typeName == "shutdown") {
+        request.type = SHUTDOWN_REQUEST;
+    } else {
+        request.detail = "unknown type";
+        return request;
+    }
+    request.status = STATUS_OK;
+    if (request.type == STATS_REQUEST || request.type == SHUTDOWN_REQUEST) return request;
+
+    bool valid = true;
+    if (request.type == ROUTE_REQUEST) {
+        valid = readName(value, "start", request.sourceNames) && readName(value, "finish", request.targetNames);
+    } else if (request.type == MATRIX_REQUEST) {
+        valid = readNames(value, "sources", request.sourceNames) && readNames(value, "targets", request.targetNames);
+    }
+    if (!valid) {
+        request.status = STATUS_BAD_REQUEST;
+        request.detail = (request.type == ROUTE_REQUEST) ? "route needs start and finish"
+                                                         : "matrix needs sources and targets";
+        return request;
+    }
+
+    const JsonValue *mapName = value.find("map");
+    if (mapName == NULL && maps.size() != 1) {
+        request.status = STATUS_BAD_REQUEST;
+        request.detail = "no map";
+        return request;
+    }
+    if (mapName != NULL) {
+        request.mapIndex = -1;
+        for (size_t i = 0; i < maps.size(); i++) {
+            if (mapName->type == JSON_STRING && maps[i].name == mapName->text) request.mapIndex = i;
+        }
+        if (request.mapIndex < 0) {
+            request.status = STATUS_UNKNOWN_MAP;
+            request.detail = (mapName->type == JSON_STRING) ? mapName->text : "";
+            return request;
+        }
+    }
+    const GraphSnapshot & snapshot = maps[request.mapIndex].snapshot;
+    if (resolveCities(snapshot, request.sourceNames, request.sources, request)) {
+        resolveCities(snapshot, request.targetNames, request.targets, request);
+    }
+    return request;
+}
+
+/* Function: waitReadable
+ * Usage: int ready = waitReadable(fd);
+ * ------------------------------------
+ * Waits up to POLL_INTERVAL_MS for fd to have input or reach its end.
+ * Returns a positive number if it has, 0 if the time ran out, and -1
+ * on an error other than an interrupted wait.
+ */
+
+static int waitReadable(int fd) {
+    struct pollfd poller;
+    poller.fd = fd;
+    poller.events = POLLIN;
+    poller.revents = 0;
+    int ready = poll(&poller, 1, POLL_INTERVAL_MS);
+    if (ready < 0 && errno == EINTR) return 0;
+    return ready;
+}
+
+/* Function: writeAll
+ * Usage: if (writeAll(fd, text)) ...
+ * ----------------------------------
+ * Writes all of text to fd. Returns false if the other end has gone.
+ */
+
+static bool writeAll(int fd, const string & text) {
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t count = write(fd, text.data() + written, text.size() - written);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        written += count;
+    }
+    return true;
+}
+
+/* Function: queueLine
+ * Usage: queueLine(line, client, arrival, state);
+ * -----------------------------------------------
+ * Queues the request on line, whose answer goes to client, unless the
+ * line is blank.
+ */
+
+static void queueLine(const string & line, shared_ptr<Connection> client,
+                      chrono::steady_clock::time_point arrival, ServerState & state) {
+    if (line.find_first_not_of(" \t\r") == string::npos) return;
+    ServerRequest request = parseRequest(line, state.maps);
+    request.client = client;
+    request.arrival = arrival;
+    state.queue.push(request);
+}
+
+/* Function: readRequests
+ * Usage: readRequests(inputFd, client, state);
+ * --------------------------------------------
+ * Queues a request for every non-blank line read from inputFd, whose
+ * answers go to client, until the input ends or the server stops.
+ * Waiting in short polls lets it notice the stop. A last line without
+ * a newline is still a request if the input ends. A line longer than
+ * MAX_REQUEST_BYTES is discarded and answered as a bad request.
+ */
+
+static void readRequests(int inputFd, shared_ptr<Connection> client, ServerState & state) {
+    string pending;
+    bool discarding = false;
+    vector<char> chunk(READ_CHUNK);
+    while (!state.stopping) {
+        int ready = waitReadable(inputFd);
+        if (ready == 0) continue;
+        ssize_t count = (ready > 0) ? read(inputFd, chunk.data(), chunk.size()) : -1;
+        if (count < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (count <= 0) break;
+        chrono::steady_clock::time_point arrival = chrono::steady_clock::now();
+        pending.append(chunk.data(), count);
+        size_t start = 0;
+        for (size_t newline; (newline = pending.find('\n', start)) != string::npos; start = newline + 1) {
+            string line = pending.substr(start, newline - start);
+            if (discarding) {
+                discarding = false;
+                continue;
+            }
+            queueLine(line, client, arrival, state);
+        }
+        pending.erase(0, start);
+        if (pending.size() > MAX_REQUEST_BYTES) {
+            if (!discarding) {
+                ServerRequest request;
+                request.type = INVALID_REQUEST;
+                request.status = STATUS_BAD_REQUEST;
+                request.detail = "request too long";
+                request.client = client;
+                request.arrival = arrival;
+                state.queue.push(request);
+            }
+            discarding = true;
+            pending.clear();
+        }
+    }
+    if (!discarding && !state.stopping) queueLine(pending, client, chrono::steady_clock::now(), state);
+}
+
+/* Function: runSearches
+ * Usage: runSearches(batch, state);
+ * ---------------------------------
+ * Answers the route and matrix requests of a batch. Requests from
+ * the same city of the same map are gathered into one SourceSearch,
+ * which runs searchToTargets once for all their targets; the
+ * searches are spread over the shared ThreadPool. A route keeps the
+ * path to its target; a matrix row copies its costs.
+ */
+
+static void runSearches(vector<ServerRequest> & batch, ServerState & state) {
+    vector<SourceSearch> searches;
+    map<pair<int, int>, int> searchIndex;
+    for (size_t r = 0; r < batch.size(); r++) {
+        ServerRequest & request = batch[r];
+        if (request.status != STATUS_OK) continue;
+        if (request.type != ROUTE_REQUEST && request.type != MATRIX_REQUEST) continue;
+        request.costs.assign(request.sources.size() * request.targets.size(), INFINITE_DISTANCE);
+        for (size_t i = 0; i < request.sources.size(); i++) {
+            pair<int, int> key(request.mapIndex, request.sources[i]);
+            if (searchIndex.count(key) == 0) {
+                searchIndex[key] = searches.size();
+                SourceSearch search;
+                search.mapIndex = request.mapIndex;
+                search.source = request.sources[i];
+                searches.push_back(search);
+            }
+            SourceSearch & search = searches[searchIndex[key]];
+            search.targets.insert(search.targets.end(), request.targets.begin(), request.targets.end());
+            search.uses.push_back(make_pair(r, (request.type == ROUTE_REQUEST) ? -1 : (int) i));
+        }
+    }
+    state.searches += searches.size();
+    getSharedThreadPool().parallelFor(searches.size(), [&](int index, int worker) {
+        const SourceSearch & search = searches[index];
+        const GraphSnapshot & snapshot = state.maps[search.mapIndex].snapshot;
+        SearchState & searchState = state.states[search.mapIndex][worker];
+        vector<char> & isTarget = state.targetMarks[search.mapIndex][worker];
+        prepareSearchState(snapshot, searchState);
+        isTarget.resize(snapshot.nodeCount(), false);
+        int targetCount = 0;
+        for (size_t t = 0; t < search.targets.size(); t++) {
+            if (!isTarget[search.targets[t]]) targetCount++;
+            isTarget[search.targets[t]] = true;
+        }
+        searchToTargets(snapshot, searchState, search.source, isTarget, targetCount);
+        for (size_t t = 0; t < search.targets.size(); t++) {
+            isTarget[search.targets[t]] = false;
+        }
+        for (size_t u = 0; u < search.uses.size(); u++) {
+            ServerRequest & request = batch[search.uses[u].first];
+            int row = search.uses[u].second;
+            if (row < 0) {
+                int target = request.targets[0];
+                request.costs[0] = searchState.distance[target];
+                if (request.costs[0] != INFINITE_DISTANCE) {
+                    request.path = buildSearchPath(snapshot, searchState, target);
+                }
+                continue;
+            }
+            for (size_t j = 0; j < request.targets.size(); j++) {
+                request.costs[row * request.targets.size() + j] = searchState.distance[request.targets[j]];
+            }
+        }
+    });
+}
+
+/* Function: latencyPercentile
+ * Usage: double seconds = latencyPercentile(sorted, fraction);
+ * ------------------------------------------------------------
+ * Returns the sample below which fraction of the sorted samples lie,
+ * or 0 if there are none.
+ */
+
+static double latencyPercentile(const vector<double> & sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    size_t index = min(sorted.size() - 1, (size_t) (fraction * sorted.size()));
+    return sorted[index];
+}
+
+/* Function: describeStats
+ * Usage: string fields = describeStats(state);
+ * --------------------------------------------
+ * Returns the server's statistics as JSON members: the requests,
+ * batches and searches so far, the current and deepest queue, the
+ * clients dropped for not reading, and the percentiles of the recent
+ * latencies in milliseconds.
+ */
+
+static string describeStats(ServerState & state) {
+    vector<double> sorted = state.latencies;
+    sort(sorted.begin(), sorted.end());
+    ostringstream out;
+    out.precision(COST_PRECISION);
+    out<<"\"requests\":"<<state.requests<<",\"batches\":"<<state.batches<<",\"searches\":"<<state.searches
+       <<",\"queueDepth\":"<<state.queue.getDepth()<<",\"maxQueueDepth\":"<<state.queue.getMaxDepth()
+       <<",\"droppedClients\":"<<state.droppedClients
+       <<",\"latencyMs\":{\"samples\":"<<sorted.size()
+       <<",\"p50\":"<<1000 * latencyPercentile(sorted, 0.50)
+       <<",\"p90\":"<<1000 * latencyPercentile(sorted, 0.90)
+       <<",\"p99\":"<<1000 * latencyPercentile(sorted, 0.99)
+       <<",\"max\":"<<1000 * (sorted.empty() ? 0 : sorted.back())<<"}";
+    return out.str();
+}
+
+/* Function: describeAnswer
+ * Usage: string line = describeAnswer(request, state);
+ * ----------------------------------------------------
+ * Returns the JSON line that answers a request of a finished batch.
+ */
+
+static string describeAnswer(ServerRequest & request, ServerState & state) {
+    static const char *TYPE_NAMES[] = { "route", "matrix", "mst", "stats", "shutdown", "error" };
+    ostringstream out;
+    out.precision(COST_PRECISION);
+    out<<"{";
+    if (!request.id.empty()) out<<"\"id\":"<<request.id<<",";
+    string status = request.status;
+    if (request.type == ROUTE_REQUEST && status == STATUS_OK && request.costs[0] == INFINITE_DISTANCE) {
+        status = STATUS_UNREACHABLE;
+    }
+    out<<"\"type\":\""<<TYPE_NAMES[request.type]<<"\",\"status\":"<<jsonString(status);
+    if (status == STATUS_UNKNOWN_CITY) {
+        out<<",\"city\":"<<jsonString(request.detail);
+    } else if (status == STATUS_UNKNOWN_MAP) {
+        out<<",\"map\":"<<jsonString(request.detail);
+    } else if (status == STATUS_BAD_REQUEST) {
+        out<<",\"error\":"<<jsonString(request.detail);
+    }
+    if (request.type == ROUTE_REQUEST) {
+        if (!request.sourceNames.empty()) out<<",\"start\":"<<jsonString(request.sourceNames[0]);
+        if (!request.targetNames.empty()) out<<",\"finish\":"<<jsonString(request.targetNames[0]);
+        if (status == STATUS_OK) {
+            out<<",\"cost\":"<<jsonNumber(request.costs[0])<<",\"path\":["<<jsonString(request.sourceNames[0]);
+            for (int i = 0; i < request.path.size(); i++) {
+                out<<","<<jsonString(request.path.getArc(i)->finish->name);
+            }
+            out<<"]";
+        }
+    } else if (request.type == MATRIX_REQUEST && status == STATUS_OK) {
+        out<<",\"sources\":[";
+        for (size_t i = 0; i < request.sourceNames.size(); i++) {
+            out<<(i > 0 ? "," : "")<<jsonString(request.sourceNames[i]);
+        }
+        out<<"],\"targets\":[";
+        for (size_t j = 0; j < request.targetNames.size(); j++) {
+            out<<(j > 0 ? "," : "")<<jsonString(request.targetNames[j]);
+        }
+        out<<"],\"costs\":[";
+        for (size_t i = 0; i < request.sources.size(); i++) {
+            out<<(i > 0 ? ",[" : "[");
+            for (size_t j = 0; j < request.targets.size(); j++) {
+                out<<(j > 0 ? "," : "")<<jsonNumber(request.costs[i * request.targets.size() + j]);
+            }
+            out<<"]";
+        }
+        out<<"]";
+    } else if (request.type == MST_REQUEST && status == STATUS_OK) {
+        const Path & tree = state.maps[request.mapIndex].tree;
+        out<<",\"cost\":"<<tree.totalCost()<<",\"edges\":[";
+        for (int i = 0; i < tree.size(); i++) {
+            out<<(i > 0 ? ",[" : "[")<<jsonString(tree.getArc(i)->start->name)<<","
+               <<jsonString(tree.getArc(i)->finish->name)<<"]";
+        }
+        out<<"]";
+    } else if (request.type == STATS_REQUEST) {
+        out<<","<<describeStats(state);
+    }
+    out<<"}"<<'\n';
+    return out.str();
+}
+
+/* Function: recordLatency
+ * Usage: recordLatency(state, seconds);
+ * -------------------------------------
+ * Adds one answer time to the ring of recent latencies.
+ */
+
+static void recordLatency(ServerState & state, double seconds) {
+    if (state.latencies.size() < LATENCY_SAMPLES) {
+        state.latencies.push_back(seconds);
+    } else {
+        state.latencies[state.nextLatency] = seconds;
+    }
+    state.nextLatency = (state.nextLatency + 1) % LATENCY_SAMPLES;
+}
+
+/* Function: dropClient
+ * Usage: dropClient(client, state);
+ * ---------------------------------
+ * Discards the unsent answers of a client that has gone or stopped
+ * reading and shuts its socket, which also ends its reader.
+ */
+
+static void dropClient(Connection & client, ServerState & state) {
+    if (client.dropped) return;
+    client.dropped = true;
+    string().swap(client.outbox);
+    client.sent = 0;
+    if (client.owned) shutdown(client.fd, SHUT_RDWR);
+    state.droppedClients++;
+}
+
+/* Function: flushOutbox
+ * Usage: if (flushOutbox(client, state)) ...
+ * ------------------------------------------
+ * Writes as much of a client's outbox as its descriptor takes without
+ * blocking. Returns true if answers are still waiting.
+ */
+
+static bool flushOutbox(Connection & client, ServerState & state) {
+    while (!client.dropped && client.sent < client.outbox.size()) {
+        ssize_t count = write(client.fd, client.outbox.data() + client.sent, client.outbox.size() - client.sent);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (count <= 0) dropClient(client, state);
+        if (count > 0) client.sent += count;
+    }
+    client.outbox.clear();
+    client.sent = 0;
+    return false;
+}
+
+/* Function: sendAnswers
+ * Usage: sendAnswers(client, text, state);
+ * ----------------------------------------
+ * Adds text to a client's outbox and writes what it can. A client
+ * whose unsent answers would pass MAX_OUTBOX_BYTES is dropped; one
+ * with answers left over joins the backlog.
+ */
+
+static void sendAnswers(const shared_ptr<Connection> & client, const string & text, ServerState & state) {
+    if (client->dropped) return;
+    if (client->outbox.size() - client->sent + text.size() > MAX_OUTBOX_BYTES) {
+        dropClient(*client, state);
+        return;
+    }
+    client->outbox.append(text);
+    if (flushOutbox(*client, state) && !client->waiting) {
+        client->waiting = true;
+        state.backlog.push_back(client);
+    }
+}
+
+/* Function: flushBacklog
+ * Usage: flushBacklog(state);
+ * ---------------------------
+ * Retries the clients with unsent answers and forgets those that are
+ * done or dropped.
+ */
+
+static void flushBacklog(ServerState & state) {
+    size_t kept = 0;
+    for (size_t i = 0; i < state.backlog.size(); i++) {
+        shared_ptr<Connection> client = state.backlog[i];
+        if (flushOutbox(*client, state)) {
+            state.backlog[kept++] = client;
+        } else {
+            client->waiting = false;
+        }
+    }
+    state.backlog.resize(kept);
+}
+
+/* Function: drainBacklog
+ * Usage: drainBacklog(state);
+ * ---------------------------
+ * Waits up to SHUTDOWN_FLUSH_MS for the backlog to be written when
+ * the server stops, and drops the clients still behind after that.
+ */
+
+static void drainBacklog(ServerState & state) {
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now()
+                                              + chrono::milliseconds(SHUTDOWN_FLUSH_MS);
+    while (!state.backlog.empty() && chrono::steady_clock::now() < deadline) {
+        vector<struct pollfd> pollers(state.backlog.size());
+        for (size_t i = 0; i < pollers.size(); i++) {
+            pollers[i].fd = state.backlog[i]->fd;
+            pollers[i].events = POLLOUT;
+            pollers[i].revents = 0;
+        }
+        poll(pollers.data(), pollers.size(), POLL_INTERVAL_MS);
+        flushBacklog(state);
+    }
+    for (size_t i = 0; i < state.backlog.size(); i++) {
+        dropClient(*state.backlog[i], state);
+        state.backlog[i]->waiting = false;
+    }
+    state.backlog.clear();
+}
+
+/* Function: answerBatch
+ * Usage: answerBatch(batch, state);
+ * ---------------------------------
+ * Runs the searches of a batch, builds the spanning trees it asks
+ * for, and sends each client's answers in the order its requests
+ * arrived, one write per client. A shutdown request sets the stop
+ * flag.
+ */
+
+static void answerBatch(vector<ServerRequest> & batch, ServerState & state) {
+    state.batches++;
+    state.requests += batch.size();
+    runSearches(batch, state);
+    vector< shared_ptr<Connection> > clients;
+    map<Connection *, string> answers;
+    for (size_t r = 0; r < batch.size(); r++) {
+        ServerRequest & request = batch[r];
+        if (request.type == MST_REQUEST && request.status == STATUS_OK) {
+            ServedMap & served = state.maps[request.mapIndex];
+            if (!served.treeBuilt) served.tree = findMinimumSpanningTree(served.snapshot);
+            served.treeBuilt = true;
+        }
+        if (request.type == SHUTDOWN_REQUEST) state.stopping = true;
+        Connection *client = request.client.get();
+        if (client->dropped) continue;
+        if (answers.count(client) == 0) clients.push_back(request.client);
+        answers[client] += describeAnswer(request, state);
+    }
+    for (size_t c = 0; c < clients.size(); c++) {
+        sendAnswers(clients[c], answers[clients[c].get()], state);
+    }
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    for (size_t r = 0; r < batch.size(); r++) {
+        chrono::duration<double> latency = now - batch[r].arrival;
+        recordLatency(state, latency.count());
+    }
+}
+
+/* Function: openListener
+ * Usage: int fd = openListener(path);
+ * -----------------------------------
+ * Listens on a Unix domain socket at path, replacing any socket file
+ * left there by an earlier run. Returns -1 on failure.
+ */
+
+static int openListener(const string & path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    unlink(path.c_str());
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(fd, LISTEN_BACKLOG) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Function: acceptClients
+ * Usage: acceptClients(listenFd, state);
+ * --------------------------------------
+ * Starts a reader thread for every client that connects, making its
+ * socket non-blocking, until the server stops, and then waits for the
+ * readers. A reader lets go of
+ * its connection as soon as its input ends, so that the connection
+ * closes once the last answer is written; the finished thread itself
+ * is joined when the next client arrives.
+ */
+
+static void acceptClients(int listenFd, ServerState & state) {
+    vector< pair<thread, shared_ptr< atomic<bool> > > > readers;
+    while (!state.stopping) {
+        if (waitReadable(listenFd) <= 0) continue;
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) continue;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        for (size_t i = readers.size(); i-- > 0; ) {
+            if (!*readers[i].second) continue;
+            readers[i].first.join();
+            readers.erase(readers.begin() + i);
+        }
+        shared_ptr< atomic<bool> > finished(new atomic<bool>(false));
+        shared_ptr<Connection> client(new Connection(fd, true));
+        readers.push_back(make_pair(thread([fd, client, finished, &state]() mutable {
+            readRequests(fd, client, state);
+            client.reset();
+            *finished = true;
+        }), finished));
+    }
+    for (size_t i = 0; i < readers.size(); i++) {
+        readers[i].first.join();
+    }
+}
+
+int runServerMode(int argc, char *argv[]) {
+    ServerOptions options;
+    if (!parseServerOptions(argc, argv, options)) {
+        printServerUsage(argv[0]);
+        return 1;
+    }
+    setNodeOrder(options.nodeOrder);
+    ServerState state;
+    state.stopping = false;
+    state.nextLatency = 0;
+    state.requests = state.batches = state.searches = state.droppedClients = 0;
+    if (!loadServedMaps(options, state)) return 1;
+    int workers = getSharedThreadPool().size();
+    state.states.resize(state.maps.size());
+    state.targetMarks.resize(state.maps.size());
+    for (size_t m = 0; m < state.maps.size(); m++) {
+        state.states[m].resize(workers);
+        state.targetMarks[m].resize(workers);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = -1;
+    thread input;
+    if (options.socketPath.empty()) {
+        cerr<<"Serving "<<state.maps.size()<<" maps on standard input"<<endl;
+        input = thread([&state]() {
+            readRequests(STDIN_FILENO, shared_ptr<Connection>(new Connection(STDOUT_FILENO, false)), state);
+            state.queue.close();
+        });
+    } else {
+        listenFd = openListener(options.socketPath);
+        if (listenFd < 0) {
+            cerr<<"Could not listen on "<<options.socketPath<<endl;
+            return 1;
+        }
+        cerr<<"Serving "<<state.maps.size()<<" maps on "<<options.socketPath<<endl;
+        input = thread([listenFd, &state]() { acceptClients(listenFd, state); });
+    }
+
+    vector<ServerRequest> batch;
+    while (!state.stopping
+           && state.queue.takeBatch(batch, options.batchWindowMs, state.backlog.empty() ? -1 : OUTBOX_RETRY_MS)) {
+        if (!batch.empty()) answerBatch(batch, state);
+        flushBacklog(state);
+    }
+    state.stopping = true;
+    input.join();
+    state.queue.close();
+    while (state.queue.takeBatch(batch, 0)) {
+        answerBatch(batch, state);
+    }
+    drainBacklog(state);
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(options.socketPath.c_str());
+    }
+    vector<double> sorted = state.latencies;
+    sort(sorted.begin(), sorted.end());
+    cerr<<"Answered "<<state.requests<<" requests in "<<state.batches<<" batches with "<<state.searches
+        <<" searches; latency p50 "<<1000 * latencyPercentile(sorted, 0.50)<<" ms, p99 "
+        <<1000 * latencyPercentile(sorted, 0.99)<<" ms; queue depth up to "<<state.queue.getMaxDepth()<<"; "<<state.droppedClients<<" clients dropped"<<endl;
+    return 0;
+}
+
+int runClientMode(int argc, char *argv[]) {
+    if (argc != 3) {
+        printServerUsage(argv[0]);
+        return 1;
+    }
+    string path = argv[2];
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool connected = fd >= 0 && path.size() < sizeof(address.sun_path);
+    if (connected) {
+        strcpy(address.sun_path, path.c_str());
+        connected = connect(fd, (struct sockaddr *) &address, sizeof(address)) == 0;
+    }
+    if (!connected) {
+        cerr<<"Could not connect to "<<path<<endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    thread sender([fd]() {
+        vector<char> chunk(READ_CHUNK);
+        ssize_t count;
+        while ((count = read(STDIN_FILENO, chunk.data(), chunk.size())) > 0) {
+            if (!writeAll(fd, string(chunk.data(), count))) break;
+        }
+        shutdown(fd, SHUT_WR);
+    });
+    sender.detach();
+    vector<char> chunk(READ_CHUNK);
+    ssize_t count;
+    while ((count = read(fd, chunk.data(), chunk.size())) > 0) {
+        if (!writeAll(STDOUT_FILENO, string(chunk.data(), count))) break;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * File: queryserver.h
+ * -------------------
+ * This file exports the server mode of Pathfinder, which loads one or
+ * more maps once and then answers requests for as long as it runs,
+ * and a client mode for talking to it from the command line.
+ *
+ * Usage: Pathfinder --serve --map FILE [--map NAME=FILE ...]
+ *                   [--socket PATH] [--batch-ms N]
+ *                   [--order graph|hilbert|bfs]
+ *        Pathfinder --client PATH
+ *
+ * Requests are JSON objects, one per line, read from standard input
+ * or, with --socket, from any number of clients of a Unix domain
+ * socket. Each gets one JSON line back, on standard output or on its
+ * own connection, carrying the request's "id" if it had one:
+ *
+ *   {"id":1,"type":"route","map":"USA","start":"A","finish":"B"}
+ *   {"id":2,"type":"matrix","sources":["A"],"targets":["B","C"]}
+ *   {"id":3,"type":"mst"}
+ *   {"id":4,"type":"stats"}
+ *   {"id":5,"type":"shutdown"}
+ *
+ * A map is named by its file name without directory or extension
+ * unless --map gives NAME=FILE, and "map" may be left out when only
+ * one map is served. Route, matrix and spanning tree answers have the
+ * same fields as in batch mode (see batchmode.h); the status says why
+ * a request could not be answered.
+ *
+ * Requests that arrive within --batch-ms (default 2) of the first
+ * one waiting are answered as a batch. Route and matrix requests in a
+ * batch that start from the same city of the same map share one
+ * one-to-many search, and the searches are spread over the shared
+ * ThreadPool. A stats request reports the latency percentiles of the
+ * most recent requests and the depth of the request queue.
+ * A client that stops reading its answers is dropped once more than
+ * 64 MB of them are waiting, so it cannot hold up the others.
+ * A shutdown request, or the end of standard input, stops the server
+ * once the requests already queued have been answered.
+ *
+ * The client mode sends its standard input to the server listening
+ * at PATH and copies the answers to standard output.
+ */
+
+#ifndef _queryserver_h
+#define _queryserver_h
+
+/* Function: runServerMode
+ * Usage: return runServerMode(argc, argv);
+ * ----------------------------------------
+ * Runs the server with the program's command-line arguments and
+ * returns the exit status for main.
+ */
+
+int runServerMode(int argc, char *argv[]);
+
+/* Function: runClientMode
+ * Usage: return runClientMode(argc, argv);
+ * ----------------------------------------
+ * Runs the client with the program's command-line arguments and
+ * returns the exit status for main.
+ */
+
+int runClientMode(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * File: radixheap.cpp
+ * -------------------
+ * This file implements the RadixHeap class. Bucket 0 holds keys equal
+ * to the last key popped and bucket i > 0 holds keys whose highest
+ * differing bit is bit i - 1. When bucket 0 runs out, the first
+ * nonempty bucket is emptied into lower ones around its smallest key,
+ * which becomes the new last key.
+ */
+
+#include "radixheap.h"
+using namespace std;
+
+/* Function: bitWidth
+ * Usage: int bits = bitWidth(value);
+ * ----------------------------------
+ * Returns the number of bits needed to write value, which is 0 for 0.
+ * GCC and Clang count the leading zeros in one instruction; elsewhere
+ * the width is found by halving.
+ */
+
+static inline int bitWidth(unsigned long long value) {
+#if defined(__GNUC__)
+    return (value == 0) ? 0 : 64 - __builtin_clzll(value);
+#else
+    int bits = 0;
+    for (int shift = 32; shift > 0; shift /= 2) {
+        if (value >> shift) {
+            value >>= shift;
+            bits += shift;
+        }
+    }
+    return bits + (int) value;
+#endif
+}
+
+RadixHeap::RadixHeap() {
+    lastKey = 0;
+    count = 0;
+}
+
+void RadixHeap::clear() {
+    for (int i = 0; i < 65; i++) {
+        buckets[i].clear();
+    }
+    lastKey = 0;
+    count = 0;
+}
+
+bool RadixHeap::isEmpty() const {
+    return count == 0;
+}
+
+void RadixHeap::push(int id, unsigned long long key) {
+    Entry entry = { key, id };
+    buckets[bucketFor(key)].push_back(entry);
+    count++;
+}
+
+int RadixHeap::popMin(unsigned long long & key) {
+    if (buckets[0].empty()) {
+        int i = 1;
+        while (buckets[i].empty()) {
+            i++;
+        }
+        vector<Entry> & source = buckets[i];
+        unsigned long long smallest = source[0].key;
+        for (size_t j = 1; j < source.size(); j++) {
+            if (source[j].key < smallest) smallest = source[j].key;
+        }
+        lastKey = smallest;
+        for (size_t j = 0; j < source.size(); j++) {
+            buckets[bucketFor(source[j].key)].push_back(source[j]);
+        }
+        source.clear();
+    }
+    Entry entry = buckets[0].back();
+    buckets[0].pop_back();
+    count--;
+    key = entry.key;
+    return entry.id;
+}
+
+int RadixHeap::bucketFor(unsigned long long key) const {
+    return bitWidth(key ^ lastKey);
+}
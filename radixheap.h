@@ -0,0 +1,80 @@
+/*
+ * File: radixheap.h
+ * -----------------
+ * This file exports the RadixHeap class, a monotone priority queue
+ * over unsigned integer keys. Monotone means no key pushed may be
+ * smaller than the last key popped, which always holds in Dijkstra's
+ * algorithm. Entries live in 65 buckets by the highest bit in which
+ * their key differs from the last key popped, so each entry moves
+ * down at most 64 times and no keys are ever compared in a heap.
+ */
+
+#ifndef _radixheap_h
+#define _radixheap_h
+
+#include <cstddef>
+#include <vector>
+
+class RadixHeap {
+
+public:
+
+/* Constructor: RadixHeap
+ * Usage: RadixHeap heap;
+ * ----------------------
+ * Creates an empty heap whose last popped key is 0.
+ */
+
+    RadixHeap();
+
+/* Method: clear
+ * Usage: heap.clear();
+ * --------------------
+ * Removes every entry and resets the last popped key to 0.
+ */
+
+    void clear();
+
+/* Method: isEmpty
+ * Usage: if (heap.isEmpty()) ...
+ * ------------------------------
+ * Returns true if the heap has no entries.
+ */
+
+    bool isEmpty() const;
+
+/* Method: push
+ * Usage: heap.push(id, key);
+ * --------------------------
+ * Adds id with the given key, which must not be less than the last
+ * key popped. An ID may be pushed more than once; callers skip the
+ * stale copies when they come out.
+ */
+
+    void push(int id, unsigned long long key);
+
+/* Method: popMin
+ * Usage: int id = heap.popMin(key);
+ * ---------------------------------
+ * Removes an entry with the smallest key, stores the key in key, and
+ * returns its ID. The heap must not be empty.
+ */
+
+    int popMin(unsigned long long & key);
+
+private:
+
+    struct Entry {
+        unsigned long long key;
+        int id;
+    };
+
+    std::vector<Entry> buckets[65];
+    unsigned long long lastKey;
+    size_t count;
+
+    int bucketFor(unsigned long long key) const;
+
+};
+
+#endif
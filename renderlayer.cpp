@@ -0,0 +1,216 @@
+/*
+ * File: renderlayer.cpp
+ * ---------------------
+ * This file implements the render layer. Colors are interned into a
+ * small palette so each element's state is a pair of integers: the
+ * color requested and the color on screen. Elements whose pair
+ * differs are queued once in a dirty list, which flushRenderLayer
+ * drains.
+ */
+
+#include <unordered_map>
+#include <vector>
+#include "renderlayer.h"
+#include "graphsnapshot.h"
+#include "instrumentation.h"
+using namespace std;
+
+/* CONSTANTS */
+const int NO_COLOR = -1;
+
+
+/* Type: ElementColors
+ * -------------------
+ * The requested and displayed color of each of a set of elements,
+ * with the queue of those that differ.
+ */
+
+struct ElementColors {
+    vector<int> wanted;
+    vector<int> drawn;
+    vector<char> queued;
+    vector<int> dirty;
+};
+
+/* Type: RenderState
+ * -----------------
+ * Everything the layer knows about the display. Roads are numbered
+ * separately from arcs: arcEdge maps each snapshot arc to its road,
+ * and edgeArc names one arc per road to draw it with.
+ */
+
+struct RenderState {
+    int version;
+    vector<int> arcEdge;
+    vector<int> edgeArc;
+    vector<int> edgeStart;
+    ElementColors nodes;
+    ElementColors edges;
+    vector<string> palette;
+    RenderState() : version(-1) { }
+};
+
+static RenderState renderState;
+
+
+/* Function: colorIndex
+ * Usage: int color = colorIndex(name);
+ * ------------------------------------
+ * Returns the palette index of a color name, adding it if it is new.
+ * A map only ever uses a handful of colors, so a linear search wins.
+ */
+
+static int colorIndex(const string & name) {
+    for (size_t i = 0; i < renderState.palette.size(); i++) {
+        if (renderState.palette[i] == name) return i;
+    }
+    renderState.palette.push_back(name);
+    return renderState.palette.size() - 1;
+}
+
+/* Function: resizeColors
+ * Usage: resizeColors(colors, count);
+ * -----------------------------------
+ * Sizes colors for count elements, none of them on screen.
+ */
+
+static void resizeColors(ElementColors & colors, int count) {
+    colors.wanted.assign(count, NO_COLOR);
+    colors.drawn.assign(count, NO_COLOR);
+    colors.queued.assign(count, 0);
+    colors.dirty.clear();
+}
+
+/* Function: requestColor
+ * Usage: requestColor(colors, id, color);
+ * ---------------------------------------
+ * Records that element id should be color, queueing it if that is
+ * not what is on screen.
+ */
+
+static inline void requestColor(ElementColors & colors, int id, int color) {
+    colors.wanted[id] = color;
+    if (color != colors.drawn[id] && !colors.queued[id]) {
+        colors.queued[id] = 1;
+        colors.dirty.push_back(id);
+    }
+}
+
+/* Function: syncRenderState
+ * Usage: const GraphSnapshot & snapshot = syncRenderState();
+ * ----------------------------------------------------------
+ * Resets the layer if the current snapshot has changed since it was
+ * last matched, and returns the snapshot.
+ */
+
+static const GraphSnapshot & syncRenderState() {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    if (renderState.version != snapshot.version) resetRenderLayer();
+    return snapshot;
+}
+
+/* Function: resetRenderLayer
+ * --------------------------
+ * Pairs each arc u -> v with the road between u and v, keyed by the
+ * unordered pair of endpoints, so that opposite arcs and duplicate
+ * arcs between the same cities share one line on screen.
+ */
+
+void resetRenderLayer() {
+    const GraphSnapshot & snapshot = getGraphSnapshot();
+    int nodeCount = snapshot.nodeCount();
+    int arcCount = snapshot.arcCount();
+    renderState.version = snapshot.version;
+    renderState.arcEdge.assign(arcCount, 0);
+    renderState.edgeArc.clear();
+    renderState.edgeStart.clear();
+    unordered_map<long long, int> edgeIds;
+    edgeIds.reserve(arcCount / 2 + 1);
+    for (int u = 0; u < nodeCount; u++) {
+        for (int arc = snapshot.arcOffset[u]; arc < snapshot.arcOffset[u + 1]; arc++) {
+            int v = snapshot.arcTarget[arc];
+            long long key = (long long) min(u, v) * nodeCount + max(u, v);
+            unordered_map<long long, int>::iterator found = edgeIds.find(key);
+            if (found == edgeIds.end()) {
+                found = edgeIds.insert(make_pair(key, (int) renderState.edgeArc.size())).first;
+                renderState.edgeArc.push_back(arc);
+                renderState.edgeStart.push_back(u);
+            }
+            renderState.arcEdge[arc] = found->second;
+        }
+    }
+    resizeColors(renderState.nodes, nodeCount);
+    resizeColors(renderState.edges, renderState.edgeArc.size());
+}
+
+void setNodeColor(Node *node, const string & color) {
+    const GraphSnapshot & snapshot = syncRenderState();
+    int id = snapshotNodeId(snapshot, node);
+    if (id != NO_NODE) requestColor(renderState.nodes, id, colorIndex(color));
+}
+
+void setAllNodeColors(const string & color) {
+    syncRenderState();
+    int index = colorIndex(color);
+    for (size_t id = 0; id < renderState.nodes.wanted.size(); id++) {
+        requestColor(renderState.nodes, id, index);
+    }
+}
+
+void setArcColor(Arc *arc, const string & color) {
+    const GraphSnapshot & snapshot = syncRenderState();
+    int start = snapshotNodeId(snapshot, arc->start);
+    if (start == NO_NODE) return;
+    for (int slot = snapshot.arcOffset[start]; slot < snapshot.arcOffset[start + 1]; slot++) {
+        if (snapshot.arcs[slot] == arc) {
+            requestColor(renderState.edges, renderState.arcEdge[slot], colorIndex(color));
+            return;
+        }
+    }
+}
+
+void setAllArcColors(const string & color) {
+    syncRenderState();
+    int index = colorIndex(color);
+    for (size_t edge = 0; edge < renderState.edges.wanted.size(); edge++) {
+        requestColor(renderState.edges, edge, index);
+    }
+}
+
+int flushRenderLayer() {
+    PhaseTimer timer("render");
+    const GraphSnapshot & snapshot = syncRenderState();
+    ElementColors & edges = renderState.edges;
+    ElementColors & nodes = renderState.nodes;
+    int drawn = 0;
+    for (size_t i = 0; i < edges.dirty.size(); i++) {
+        int edge = edges.dirty[i];
+        edges.queued[edge] = 0;
+        if (edges.wanted[edge] == edges.drawn[edge]) continue;
+        int arc = renderState.edgeArc[edge];
+        int start = renderState.edgeStart[edge];
+        int finish = snapshot.arcTarget[arc];
+        drawPathfinderArc(snapshot.nodes[start]->loc, snapshot.nodes[finish]->loc,
+                          renderState.palette[edges.wanted[edge]]);
+        edges.drawn[edge] = edges.wanted[edge];
+        drawn++;
+        nodes.drawn[start] = NO_COLOR;
+        nodes.drawn[finish] = NO_COLOR;
+        requestColor(nodes, start, nodes.wanted[start]);
+        requestColor(nodes, finish, nodes.wanted[finish]);
+    }
+    edges.dirty.clear();
+    for (size_t i = 0; i < nodes.dirty.size(); i++) {
+        int id = nodes.dirty[i];
+        nodes.queued[id] = 0;
+        if (nodes.wanted[id] == nodes.drawn[id]) continue;
+        Node *node = snapshot.nodes[id];
+        drawPathfinderNode(node->loc, renderState.palette[nodes.wanted[id]], node->name);
+        nodes.drawn[id] = nodes.wanted[id];
+        drawn++;
+    }
+    nodes.dirty.clear();
+    if (drawn > 0) repaintPathfinderDisplay();
+    timer.setArg("drawn", drawn);
+    return drawn;
+}
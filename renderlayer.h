@@ -0,0 +1,73 @@
+/*
+ * File: renderlayer.h
+ * -------------------
+ * This file exports the render layer that sits between Pathfinder and
+ * the gpathfinder drawing functions. Callers say what color each city
+ * and road should be; the layer remembers what is already on screen
+ * and, when flushed, redraws only the elements whose color changed,
+ * followed by a single repaint. The two arcs loadMapFile stores for
+ * each road are drawn as one line.
+ */
+
+#ifndef _renderlayer_h
+#define _renderlayer_h
+
+#include <string>
+#include "gpathfinder.h"
+
+/* Function: resetRenderLayer
+ * Usage: resetRenderLayer();
+ * --------------------------
+ * Forgets everything drawn so far and matches the layer to the
+ * current GraphSnapshot. Call it after drawPathfinderMap has cleared
+ * the display.
+ */
+
+void resetRenderLayer();
+
+/* Function: setNodeColor
+ * Usage: setNodeColor(node, color);
+ * ---------------------------------
+ * Asks for node to be drawn in color at the next flush.
+ */
+
+void setNodeColor(Node *node, const std::string & color);
+
+/* Function: setAllNodeColors
+ * Usage: setAllNodeColors(color);
+ * -------------------------------
+ * Asks for every node to be drawn in color at the next flush.
+ */
+
+void setAllNodeColors(const std::string & color);
+
+/* Function: setArcColor
+ * Usage: setArcColor(arc, color);
+ * -------------------------------
+ * Asks for the road arc belongs to, in both directions, to be drawn
+ * in color at the next flush.
+ */
+
+void setArcColor(Arc *arc, const std::string & color);
+
+/* Function: setAllArcColors
+ * Usage: setAllArcColors(color);
+ * ------------------------------
+ * Asks for every road to be drawn in color at the next flush.
+ */
+
+void setAllArcColors(const std::string & color);
+
+/* Function: flushRenderLayer
+ * Usage: int drawn = flushRenderLayer();
+ * --------------------------------------
+ * Draws the roads and then the cities whose requested color differs
+ * from the one on screen, and repaints the display once if anything
+ * was drawn. Cities at either end of a redrawn road are drawn again
+ * so that they stay on top of it. Returns the number of elements
+ * drawn.
+ */
+
+int flushRenderLayer();
+
+#endif
@@ -0,0 +1,682 @@
+/*
+ * File: shortestpath.cpp
+ * ----------------------
+ * This file implements the shortest-path engine. Instead of pushing a
+ * copy of the partial Path onto the priority queue for every arc it
+ * relaxes, the search stores one distance and one parent arc per node
+ * and lowers keys in an IndexedHeap, so each relaxation is O(log n)
+ * and no strings are compared while searching. The graph is read from
+ * the CSR arrays of the current GraphSnapshot. The integer search
+ * keeps the same arrays but replaces the heap with a monotone queue
+ * over whole-number distances, pushing a node again when its distance
+ * drops and skipping the stale copies as they come out.
+ */
+
+#include <cmath>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "shortestpath.h"
+#include "allpairs.h"
+#include "contraction.h"
+#include "dialqueue.h"
+#include "dynamicshortestpaths.h"
+#include "graphsnapshot.h"
+#include "indexedheap.h"
+#include "instrumentation.h"
+#include "radixheap.h"
+using namespace std;
+
+/* CONSTANTS */
+const int NO_ARC = -1;
+const size_t PATH_CACHE_CAPACITY = 4096;
+const int RETAINED_TREES = 4;
+const unsigned DIAL_MAX_ARC_UNITS = 1u << 16;
+
+
+/* Type: CachedPath
+ * ----------------
+ * One entry of the path cache: the key packs the source, target and
+ * search mode, and arcs holds the arcs of the result (empty if the
+ * target was unreachable). The arcs belong to the snapshot version
+ * the cache was filled for.
+ */
+
+struct CachedPath {
+    unsigned long long key;
+    vector<Arc *> arcs;
+};
+
+/* Type: RetainedTree
+ * ------------------
+ * A Dijkstra search kept after its query so that later queries from
+ * the same source can use it. pendingNode is the target that ended
+ * the last search; it is settled but its arcs have not been relaxed.
+ */
+
+struct RetainedTree {
+    int source;
+    int pendingNode;
+    long long lastUse;
+    SearchState state;
+
+    RetainedTree() : source(NO_NODE), pendingNode(NO_NODE), lastUse(0) {}
+};
+
+
+static SearchState searchState;
+static SearchState backwardState;
+static SearchStats lastSearchStats;
+static list<CachedPath> cachedPaths;       /* most recently used first */
+static unordered_map<unsigned long long, list<CachedPath>::iterator> cachedPathIndex;
+static int cachedPathVersion = 0;
+static RetainedTree retainedTrees[RETAINED_TREES];
+static long long treeUseClock = 0;
+static PathCacheStats pathCacheStats;
+static bool pathCacheEnabled = true;
+static function<bool(int)> searchObserver;
+static RadixHeap radixHeap;
+static DialQueue dialQueue;
+
+
+long long prepareSearchState(const GraphSnapshot & snapshot, SearchState & state) {
+    if (state.version == snapshot.version && state.distance.size() == (size_t) snapshot.nodeCount()) return 0;
+    int nodeCount = snapshot.nodeCount();
+    state.distance.assign(nodeCount, INFINITE_DISTANCE);
+    state.parentArc.assign(nodeCount, NO_ARC);
+    state.parent.assign(nodeCount, NO_NODE);
+    state.touched.clear();
+    state.heap.resize(nodeCount);
+    state.version = snapshot.version;
+    return (long long) nodeCount * (sizeof(double) + 3 * sizeof(int));
+}
+
+void resetSearchState(SearchState & state) {
+    for (size_t i = 0; i < state.touched.size(); i++) {
+        int id = state.touched[i];
+        state.distance[id] = INFINITE_DISTANCE;
+        state.parentArc[id] = NO_ARC;
+        state.parent[id] = NO_NODE;
+    }
+    state.touched.clear();
+    state.heap.clear();
+}
+
+/* Function: observeSettled
+ * Usage: if (!observeSettled(node, stats)) ...
+ * --------------------------------------------
+ * Reports a settled node to the search observer, if there is one.
+ * Returns false, marking stats as cancelled, if the observer asks
+ * the search to stop.
+ */
+
+static inline bool observeSettled(int node, SearchStats & stats) {
+    if (!searchObserver || searchObserver(node)) return true;
+    stats.cancelled = true;
+    return false;
+}
+
+/* Function: relaxArcs
+ * Usage: relaxArcs(graph, state, current, scale, targetX, targetY, stats);
+ * ------------------------------------------------------------------------
+ * Lowers the distance of every neighbor of the just-settled node
+ * current that can be reached more cheaply through it. Each improved
+ * neighbor is keyed by its distance plus scale times its straight-line
+ * distance to (targetX, targetY), so a scale of 0 gives Dijkstra.
+ * The arcs scanned and nodes pushed are added to stats.
+ */
+
+static inline void relaxArcs(const GraphSnapshot & graph, SearchState & state, int current,
+                             double scale, double targetX, double targetY, SearchStats & stats) {
+    double base = state.distance[current];
+    int end = graph.arcOffset[current + 1];
+    stats.relaxedArcs += end - graph.arcOffset[current];
+    for (int arc = graph.arcOffset[current]; arc < end; arc++) {
+        int next = graph.arcTarget[arc];
+        double candidate = base + graph.arcCost[arc];
+        if (candidate < state.distance[next]) {
+            if (state.distance[next] == INFINITE_DISTANCE) {
+                state.touched.push_back(next);
+                stats.heapPushes++;
+            }
+            state.distance[next] = candidate;
+            state.parent[next] = current;
+            state.parentArc[next] = arc;
+            double key = candidate;
+            if (scale != 0) {
+                double dx = graph.xCoord[next] - targetX;
+                double dy = graph.yCoord[next] - targetY;
+                key += scale * sqrt(dx * dx + dy * dy);
+            }
+            state.heap.pushOrDecrease(next, key);
+        }
+    }
+}
+
+/* Function: continueSearch
+ * Usage: bool found = continueSearch(graph, state, target, scale, stats);
+ * -----------------------------------------------------------------------
+ * Settles nodes from the heap of state until target is popped or the
+ * heap runs out, and returns true in the first case. The arcs of
+ * target itself are left unrelaxed.
+ */
+
+static bool continueSearch(const GraphSnapshot & graph, SearchState & state, int target,
+                           double scale, SearchStats & stats) {
+    size_t touchedCapacity = state.touched.capacity();
+    double targetX = graph.xCoord[target];
+    double targetY = graph.yCoord[target];
+    bool found = false;
+    while (!state.heap.isEmpty()) {
+        int current = state.heap.popMin();
+        stats.settledNodes++;
+        if (!observeSettled(current, stats)) break;
+        if (current == target) {
+            found = true;
+            break;
+        }
+        relaxArcs(graph, state, current, scale, targetX, targetY, stats);
+    }
+    stats.heapPops = stats.settledNodes;
+    stats.allocatedBytes += (state.touched.capacity() - touchedCapacity) * sizeof(int);
+    return found;
+}
+
+/* Function: runSearch
+ * Usage: bool found = runSearch(graph, state, source, target, mode, stats);
+ * -------------------------------------------------------------------------
+ * Runs Dijkstra's algorithm from source until target is settled or
+ * every reachable node has been. Returns true if target was reached.
+ * In ASTAR_SEARCH mode each node is keyed by its distance plus the
+ * scaled straight-line distance to target. Because the scale never
+ * lets an arc look cheaper than the drop in the heuristic across it,
+ * the heuristic is consistent and the first time target is popped
+ * its distance is final, exactly as in the unguided search.
+ */
+
+static bool runSearch(const GraphSnapshot & graph, SearchState & state, int source, int target,
+                      SearchMode mode, SearchStats & stats) {
+    resetSearchState(state);
+    state.distance[source] = 0;
+    state.touched.push_back(source);
+    state.heap.pushOrDecrease(source, 0);
+    stats.heapPushes++;
+    double scale = (mode == ASTAR_SEARCH) ? graph.heuristicScale : 0;
+    return continueSearch(graph, state, target, scale, stats);
+}
+
+/* Function: runIntegerSearch
+ * Usage: bool found = runIntegerSearch(graph, state, queue, source, target, stats);
+ * --------------------------------------------------------------------------------
+ * Runs Dijkstra's algorithm on graph.arcUnits with the monotone queue
+ * given, which must be empty. The distances left in state count units
+ * rather than cost; they stay exact in a double up to 2^53.
+ */
+
+template <typename MonotoneQueue>
+static bool runIntegerSearch(const GraphSnapshot & graph, SearchState & state, MonotoneQueue & queue,
+                             int source, int target, SearchStats & stats) {
+    resetSearchState(state);
+    size_t touchedCapacity = state.touched.capacity();
+    state.distance[source] = 0;
+    state.touched.push_back(source);
+    queue.push(source, 0);
+    stats.heapPushes++;
+    bool found = false;
+    while (!queue.isEmpty()) {
+        unsigned long long key;
+        int current = queue.popMin(key);
+        stats.heapPops++;
+        if (key != (unsigned long long) state.distance[current]) continue;
+        stats.settledNodes++;
+        if (!observeSettled(current, stats)) break;
+        if (current == target) {
+            found = true;
+            break;
+        }
+        int end = graph.arcOffset[current + 1];
+        stats.relaxedArcs += end - graph.arcOffset[current];
+        for (int arc = graph.arcOffset[current]; arc < end; arc++) {
+            int next = graph.arcTarget[arc];
+            unsigned long long candidate = key + graph.arcUnits[arc];
+            if (candidate < state.distance[next]) {
+                if (state.distance[next] == INFINITE_DISTANCE) state.touched.push_back(next);
+                state.distance[next] = candidate;
+                state.parent[next] = current;
+                state.parentArc[next] = arc;
+                queue.push(next, candidate);
+                stats.heapPushes++;
+            }
+        }
+    }
+    stats.allocatedBytes += (state.touched.capacity() - touchedCapacity) * sizeof(int);
+    return found;
+}
+
+/* Function: settleFromSource
+ * Usage: int settled = settleFromSource(graph, state, source, isTarget, targetCount);
+ * -----------------------------------------------------------------------------------
+ * A plain Dijkstra search that counts down the marked targets as
+ * they are settled, so a one-to-many query stops as soon as the last
+ * of them is final rather than exploring the whole map. With no
+ * isTarget it settles every node it can reach.
+ */
+
+static int settleFromSource(const GraphSnapshot & graph, SearchState & state, int source,
+                            const vector<char> *isTarget, int targetCount) {
+    resetSearchState(state);
+    state.distance[source] = 0;
+    state.touched.push_back(source);
+    state.heap.pushOrDecrease(source, 0);
+    SearchStats stats = SearchStats();
+    stats.heapPushes = 1;
+    int remaining = targetCount;
+    while (!state.heap.isEmpty() && (isTarget == NULL || remaining > 0)) {
+        int current = state.heap.popMin();
+        stats.settledNodes++;
+        if (isTarget != NULL && (*isTarget)[current]) remaining--;
+        relaxArcs(graph, state, current, 0, 0, 0, stats);
+    }
+    if (isInstrumentationEnabled()) {
+        addToCounter(COUNTER_SETTLED_NODES, stats.settledNodes);
+        addToCounter(COUNTER_HEAP_PUSHES, stats.heapPushes);
+        addToCounter(COUNTER_HEAP_POPS, stats.settledNodes);
+        addToCounter(COUNTER_RELAXED_ARCS, stats.relaxedArcs);
+    }
+    return stats.settledNodes;
+}
+
+int searchToTargets(const GraphSnapshot & graph, SearchState & state, int source,
+                    const vector<char> & isTarget, int targetCount) {
+    return settleFromSource(graph, state, source, &isTarget, targetCount);
+}
+
+int searchAllNodes(const GraphSnapshot & graph, SearchState & state, int source) {
+    return settleFromSource(graph, state, source, NULL, 0);
+}
+
+/* Function: findArcBetween
+ * Usage: int arc = findArcBetween(graph, from, to, cost);
+ * -------------------------------------------------------
+ * Returns the index of an arc from node from to node to with the
+ * given cost, or the cheapest such arc if none costs exactly that.
+ * Returns NO_ARC if the nodes are not joined.
+ */
+
+static int findArcBetween(const GraphSnapshot & graph, int from, int to, double cost) {
+    int best = NO_ARC;
+    for (int arc = graph.arcOffset[from]; arc < graph.arcOffset[from + 1]; arc++) {
+        if (graph.arcTarget[arc] != to) continue;
+        if (graph.arcCost[arc] == cost) return arc;
+        if (best == NO_ARC || graph.arcCost[arc] < graph.arcCost[best]) best = arc;
+    }
+    return best;
+}
+
+/* Type: Meeting
+ * -------------
+ * The best connection found so far between the two searches: the
+ * forward search reaches fromNode, one arc of cost arcCost leads to
+ * toNode, and the backward search reaches the target from there.
+ */
+
+struct Meeting {
+    double cost;
+    int fromNode;
+    int toNode;
+    double arcCost;
+};
+
+/* Function: advanceDirection
+ * Usage: int settled = advanceDirection(graph, self, other, forward, meeting, stats);
+ * ----------------------------------------------------------------------------------
+ * Settles the closest node of one direction, relaxes its arcs, and
+ * checks every neighbor the other direction has already labeled for
+ * a cheaper connection. Returns the node settled. Because arcs come
+ * in symmetric pairs, the backward search can follow the stored arcs
+ * as if reversed.
+ */
+
+static int advanceDirection(const GraphSnapshot & graph, SearchState & self, const SearchState & other,
+                            bool forward, Meeting & meeting, SearchStats & stats) {
+    int current = self.heap.popMin();
+    stats.settledNodes++;
+    relaxArcs(graph, self, current, 0, 0, 0, stats);
+    double base = self.distance[current];
+    int end = graph.arcOffset[current + 1];
+    for (int arc = graph.arcOffset[current]; arc < end; arc++) {
+        int next = graph.arcTarget[arc];
+        if (other.distance[next] == INFINITE_DISTANCE) continue;
+        double total = base + graph.arcCost[arc] + other.distance[next];
+        if (total < meeting.cost) {
+            meeting.cost = total;
+            meeting.fromNode = forward ? current : next;
+            meeting.toNode = forward ? next : current;
+            meeting.arcCost = graph.arcCost[arc];
+        }
+    }
+    return current;
+}
+
+/* Function: runBidirectionalSearch
+ * Usage: bool found = runBidirectionalSearch(graph, forward, backward, source, target, meeting, stats);
+ * ----------------------------------------------------------------------------------------------------
+ * Grows a Dijkstra search from source and another from target,
+ * always advancing the one whose next node is closer. Any path not
+ * yet seen must leave both settled regions, so it costs at least the
+ * sum of the two smallest heap keys; once that sum reaches the best
+ * connection found, the connection is a shortest path. Returns true
+ * if target was reached.
+ */
+
+static bool runBidirectionalSearch(const GraphSnapshot & graph, SearchState & forward, SearchState & backward,
+                                   int source, int target, Meeting & meeting, SearchStats & stats) {
+    resetSearchState(forward);
+    resetSearchState(backward);
+    size_t touchedCapacity = forward.touched.capacity() + backward.touched.capacity();
+    forward.distance[source] = 0;
+    forward.touched.push_back(source);
+    forward.heap.pushOrDecrease(source, 0);
+    backward.distance[target] = 0;
+    backward.touched.push_back(target);
+    backward.heap.pushOrDecrease(target, 0);
+    stats.heapPushes += 2;
+    meeting.cost = INFINITE_DISTANCE;
+    while (!forward.heap.isEmpty() && !backward.heap.isEmpty()) {
+        if (forward.heap.minKey() + backward.heap.minKey() >= meeting.cost) break;
+        int settled;
+        if (forward.heap.minKey() <= backward.heap.minKey()) {
+            settled = advanceDirection(graph, forward, backward, true, meeting, stats);
+        } else {
+            settled = advanceDirection(graph, backward, forward, false, meeting, stats);
+        }
+        if (!observeSettled(settled, stats)) {
+            meeting.cost = INFINITE_DISTANCE;
+            break;
+        }
+    }
+    stats.heapPops = stats.settledNodes;
+    size_t grown = forward.touched.capacity() + backward.touched.capacity() - touchedCapacity;
+    stats.allocatedBytes += grown * sizeof(int);
+    return meeting.cost != INFINITE_DISTANCE;
+}
+
+/* Function: buildBidirectionalPath
+ * Usage: Path path = buildBidirectionalPath(graph, forward, backward, meeting);
+ * ----------------------------------------------------------------------------
+ * Joins the forward path to the meeting arc and the backward search's
+ * parent chain, replacing each backward arc by its reverse.
+ */
+
+static Path buildBidirectionalPath(const GraphSnapshot & graph, const SearchState & forward,
+                                   const SearchState & backward, const Meeting & meeting) {
+    Path path = buildSearchPath(graph, forward, meeting.fromNode);
+    path.add(graph.arcs[findArcBetween(graph, meeting.fromNode, meeting.toNode, meeting.arcCost)]);
+    for (int id = meeting.toNode; backward.parent[id] != NO_NODE; id = backward.parent[id]) {
+        double cost = graph.arcCost[backward.parentArc[id]];
+        path.add(graph.arcs[findArcBetween(graph, id, backward.parent[id], cost)]);
+    }
+    return path;
+}
+
+Path buildSearchPath(const GraphSnapshot & graph, const SearchState & state, int target) {
+    vector<Arc *> reversed;
+    for (int id = target; state.parent[id] != NO_NODE; id = state.parent[id]) {
+        reversed.push_back(graph.arcs[state.parentArc[id]]);
+    }
+    Path path;
+    for (int i = reversed.size() - 1; i >= 0; i--) {
+        path.add(reversed[i]);
+    }
+    return path;
+}
+
+/* Function: reportSearch
+ * Usage: reportSearch(timer, mode, stats);
+ * ----------------------------------------
+ * Adds the work of one query to the instrumentation counters and
+ * attaches it to the query's phase.
+ */
+
+static void reportSearch(PhaseTimer & timer, SearchMode mode, const SearchStats & stats) {
+    if (!isInstrumentationEnabled()) return;
+    addToCounter(COUNTER_SETTLED_NODES, stats.settledNodes);
+    addToCounter(COUNTER_HEAP_PUSHES, stats.heapPushes);
+    addToCounter(COUNTER_HEAP_POPS, stats.heapPops);
+    addToCounter(COUNTER_RELAXED_ARCS, stats.relaxedArcs);
+    addToCounter(COUNTER_ALLOCATED_BYTES, stats.allocatedBytes);
+    timer.setArg("mode", mode);
+    timer.setArg("settledNodes", stats.settledNodes);
+    timer.setArg("heapPushes", stats.heapPushes);
+    timer.setArg("heapPops", stats.heapPops);
+    timer.setArg("relaxedArcs", stats.relaxedArcs);
+    timer.setArg("allocatedBytes", stats.allocatedBytes);
+}
+
+/* Function: pathCacheKey
+ * Usage: unsigned long long key = pathCacheKey(source, target, mode);
+ * -------------------------------------------------------------------
+ * Packs a query into the key of its path cache entry, leaving three
+ * bits for the mode.
+ */
+
+static unsigned long long pathCacheKey(int source, int target, SearchMode mode) {
+    return ((unsigned long long) source << 35) | ((unsigned long long) target << 3) | mode;
+}
+
+/* Function: findCachedPath
+ * Usage: if (findCachedPath(graph, key, path)) ...
+ * ------------------------------------------------
+ * Copies the cached result for key into path and marks it as the
+ * most recently used. Returns false if there is none. Entries from
+ * an older snapshot are dropped first.
+ */
+
+static bool findCachedPath(const GraphSnapshot & graph, unsigned long long key, Path & path) {
+    if (cachedPathVersion != graph.version) {
+        cachedPaths.clear();
+        cachedPathIndex.clear();
+        cachedPathVersion = graph.version;
+        return false;
+    }
+    unordered_map<unsigned long long, list<CachedPath>::iterator>::iterator entry = cachedPathIndex.find(key);
+    if (entry == cachedPathIndex.end()) return false;
+    cachedPaths.splice(cachedPaths.begin(), cachedPaths, entry->second);
+    const vector<Arc *> & arcs = entry->second->arcs;
+    for (size_t i = 0; i < arcs.size(); i++) {
+        path.add(arcs[i]);
+    }
+    return true;
+}
+
+/* Function: storeCachedPath
+ * Usage: storeCachedPath(key, path);
+ * ----------------------------------
+ * Adds the result of a search to the path cache, evicting the least
+ * recently used entry when the cache is full.
+ */
+
+static void storeCachedPath(unsigned long long key, const Path & path) {
+    if (cachedPaths.size() >= PATH_CACHE_CAPACITY) {
+        cachedPathIndex.erase(cachedPaths.back().key);
+        cachedPaths.pop_back();
+    }
+    cachedPaths.push_front(CachedPath());
+    CachedPath & entry = cachedPaths.front();
+    entry.key = key;
+    entry.arcs.reserve(path.size());
+    for (int i = 0; i < path.size(); i++) {
+        entry.arcs.push_back(path.getArc(i));
+    }
+    cachedPathIndex[key] = cachedPaths.begin();
+}
+
+/* Function: searchRetainedTree
+ * Usage: bool found = searchRetainedTree(graph, source, target, state);
+ * ---------------------------------------------------------------------
+ * Answers a Dijkstra query from the retained tree for source. If that
+ * tree has already settled target, no search is needed; otherwise the
+ * tree's search resumes where it stopped. Without a tree for source,
+ * the least recently used one is restarted from source. Sets state to
+ * the tree the path should be read from and returns true if target
+ * was reached.
+ */
+
+static bool searchRetainedTree(const GraphSnapshot & graph, int source, int target, SearchState *& state) {
+    RetainedTree *tree = NULL;
+    for (int i = 0; i < RETAINED_TREES; i++) {
+        RetainedTree & candidate = retainedTrees[i];
+        if (candidate.source == source && candidate.state.version == graph.version) {
+            tree = &candidate;
+            break;
+        }
+        if (tree == NULL || candidate.lastUse < tree->lastUse) tree = &candidate;
+    }
+    tree->lastUse = ++treeUseClock;
+    state = &tree->state;
+    if (tree->source != source || tree->state.version != graph.version) {
+        pathCacheStats.treeMisses++;
+        tree->source = source;
+        lastSearchStats.allocatedBytes = prepareSearchState(graph, tree->state);
+        bool found = runSearch(graph, tree->state, source, target, DIJKSTRA_SEARCH, lastSearchStats);
+        tree->pendingNode = found ? target : NO_NODE;
+        return found;
+    }
+    SearchState & retained = tree->state;
+    if (retained.distance[target] != INFINITE_DISTANCE && !retained.heap.contains(target)) {
+        pathCacheStats.treeHits++;
+        return true;
+    }
+    pathCacheStats.treeResumes++;
+    if (tree->pendingNode != NO_NODE) {
+        relaxArcs(graph, retained, tree->pendingNode, 0, 0, 0, lastSearchStats);
+    }
+    bool found = continueSearch(graph, retained, target, 0, lastSearchStats);
+    tree->pendingNode = found ? target : NO_NODE;
+    return found;
+}
+
+/* Function: searchPath
+ * Usage: Path path = searchPath(graph, source, target, mode);
+ * -----------------------------------------------------------
+ * Runs the search for one uncached query and fills lastSearchStats.
+ */
+
+static Path searchPath(const GraphSnapshot & graph, int source, int target, SearchMode mode) {
+    Path path;
+    ContractionHierarchy & hierarchy = getContractionHierarchy();
+    if (mode == HIERARCHY_SEARCH && hierarchy.isBuiltFor(graph)) {
+        vector<int> arcs;
+        bool found = hierarchy.findPath(source, target, arcs);
+        lastSearchStats.settledNodes = hierarchy.getLastSettledCount();
+        if (!found) return path;
+        for (size_t i = 0; i < arcs.size(); i++) {
+            path.add(graph.arcs[arcs[i]]);
+        }
+        return path;
+    }
+    AllPairsTable & table = getAllPairsTable();
+    if (mode == ALL_PAIRS_SEARCH && table.isBuiltFor(graph)) {
+        vector<int> arcs;
+        if (table.findPath(source, target, arcs)) {
+            lastSearchStats.settledNodes = arcs.size() + 1;
+            for (size_t i = 0; i < arcs.size(); i++) {
+                path.add(graph.arcs[arcs[i]]);
+            }
+            return path;
+        }
+        if (table.getDistance(source, target) == INFINITE_DISTANCE) return path;
+        mode = DIJKSTRA_SEARCH;
+    }
+    if (mode == BIDIRECTIONAL_SEARCH) {
+        lastSearchStats.allocatedBytes = prepareSearchState(graph, searchState);
+        lastSearchStats.allocatedBytes += prepareSearchState(graph, backwardState);
+        Meeting meeting;
+        if (runBidirectionalSearch(graph, searchState, backwardState, source, target, meeting, lastSearchStats)) {
+            path = buildBidirectionalPath(graph, searchState, backwardState, meeting);
+            lastSearchStats.allocatedBytes += path.size() * sizeof(Arc *);
+        }
+        return path;
+    }
+    if (mode == DIJKSTRA_SEARCH && getDynamicShortestPaths().findPath(graph, source, target, path)) {
+        lastSearchStats.allocatedBytes = path.size() * sizeof(Arc *);
+        return path;
+    }
+    SearchState *state = &searchState;
+    bool found;
+    if (mode == INTEGER_SEARCH && !graph.arcUnits.empty()) {
+        lastSearchStats.allocatedBytes = prepareSearchState(graph, searchState);
+        if (graph.maxArcUnits <= DIAL_MAX_ARC_UNITS) {
+            dialQueue.reset(graph.maxArcUnits);
+            found = runIntegerSearch(graph, searchState, dialQueue, source, target, lastSearchStats);
+        } else {
+            radixHeap.clear();
+            found = runIntegerSearch(graph, searchState, radixHeap, source, target, lastSearchStats);
+        }
+    } else if (mode == ASTAR_SEARCH || !pathCacheEnabled || searchObserver) {
+        lastSearchStats.allocatedBytes = prepareSearchState(graph, searchState);
+        found = runSearch(graph, searchState, source, target, mode, lastSearchStats);
+    } else {
+        found = searchRetainedTree(graph, source, target, state);
+    }
+    if (found) {
+        path = buildSearchPath(graph, *state, target);
+        lastSearchStats.allocatedBytes += path.size() * sizeof(Arc *);
+    }
+    return path;
+}
+
+Path findShortestPath(Node *start, Node *finish, SearchMode mode) {
+    PhaseTimer timer("search");
+    Path path;
+    lastSearchStats = SearchStats();
+    if (start == finish) return path;
+    const GraphSnapshot & graph = getGraphSnapshot();
+    int source = snapshotNodeId(graph, start);
+    int target = snapshotNodeId(graph, finish);
+    if (source == NO_NODE || target == NO_NODE) return path;
+    if (!pathCacheEnabled || searchObserver) {
+        path = searchPath(graph, source, target, mode);
+        reportSearch(timer, mode, lastSearchStats);
+        return path;
+    }
+    unsigned long long key = pathCacheKey(source, target, mode);
+    bool hit = findCachedPath(graph, key, path);
+    if (hit) {
+        pathCacheStats.pathHits++;
+    } else {
+        pathCacheStats.pathMisses++;
+        path = searchPath(graph, source, target, mode);
+        if (!lastSearchStats.cancelled) storeCachedPath(key, path);
+    }
+    if (isInstrumentationEnabled()) {
+        addToCounter(hit ? COUNTER_PATH_CACHE_HITS : COUNTER_PATH_CACHE_MISSES, 1);
+        timer.setArg("cacheHit", hit);
+    }
+    reportSearch(timer, mode, lastSearchStats);
+    return path;
+}
+
+SearchStats getLastSearchStats() {
+    return lastSearchStats;
+}
+
+PathCacheStats getPathCacheStats() {
+    return pathCacheStats;
+}
+
+void clearPathCache() {
+    cachedPaths.clear();
+    cachedPathIndex.clear();
+    for (int i = 0; i < RETAINED_TREES; i++) {
+        retainedTrees[i] = RetainedTree();
+    }
+}
+
+void setPathCacheEnabled(bool enabled) {
+    pathCacheEnabled = enabled;
+}
+
+void setSearchObserver(function<bool(int)> observer) {
+    searchObserver = observer;
+}
@@ -0,0 +1,219 @@
+/*
+ * File: shortestpath.h
+ * --------------------
+ * This file exports the shortest-path engine used by the Dijkstra
+ * and A* buttons. The engine searches the current GraphSnapshot by
+ * node ID, keeps tentative distances and parent arcs in flat arrays,
+ * and only builds a Path once the search has finished. Recent
+ * results are cached: exact repeats are answered from a bounded LRU
+ * of paths, and Dijkstra queries from a recent source continue that
+ * source's retained shortest-path tree instead of starting over.
+ * Dijkstra queries from a source tracked by DynamicShortestPaths (see
+ * dynamicshortestpaths.h) are read straight off its maintained tree.
+ */
+
+#ifndef _shortestpath_h
+#define _shortestpath_h
+
+#include <functional>
+#include <vector>
+#include "graphsnapshot.h"
+#include "graphtypes.h"
+#include "indexedheap.h"
+#include "path.h"
+
+/* Type: SearchMode
+ * ----------------
+ * Selects the algorithm findShortestPath uses. ASTAR_SEARCH guides
+ * Dijkstra's algorithm with the scaled straight-line distance to the
+ * finish (see calibrateHeuristicScale in graphsnapshot.h); it returns
+ * paths of the same cost while settling fewer nodes.
+ * HIERARCHY_SEARCH queries the shared ContractionHierarchy (see
+ * contraction.h) and falls back to Dijkstra if it has not been built
+ * for the current map. BIDIRECTIONAL_SEARCH runs Dijkstra from both
+ * ends at once until the two searches prove they have met on a
+ * shortest path; it relies on every arc having a reverse arc of the
+ * same cost, which loadMapFile guarantees. INTEGER_SEARCH runs
+ * Dijkstra on the snapshot's quantized arc units (see
+ * setCostResolution in graphsnapshot.h) with a DialQueue when units
+ * are small and a RadixHeap otherwise, and falls back to Dijkstra if
+ * the costs were not quantized. Its paths are shortest whenever the
+ * snapshot's units are exact; otherwise each arc may be misjudged by
+ * up to the snapshot's quantizationError. ALL_PAIRS_SEARCH reads the
+ * path off the shared AllPairsTable (see allpairs.h) and, like
+ * HIERARCHY_SEARCH, falls back to Dijkstra if the table has not been
+ * built for the current map or cannot walk a route (see findPath in
+ * allpairs.h).
+ */
+
+enum SearchMode {
+    DIJKSTRA_SEARCH, ASTAR_SEARCH, HIERARCHY_SEARCH, BIDIRECTIONAL_SEARCH, INTEGER_SEARCH, ALL_PAIRS_SEARCH
+};
+
+/* Type: SearchStats
+ * -----------------
+ * Describes the work done by one call to findShortestPath. Pushes
+ * count nodes entering the heap, not decreases of their keys, and
+ * allocatedBytes counts what the search allocated for its arrays
+ * and result. A hierarchy query reports only settledNodes, and an
+ * all-pairs query reports as settled the nodes on the path it walks.
+ * cancelled is set if a search observer stopped the search.
+ */
+
+struct SearchStats {
+    int settledNodes;
+    int heapPushes;
+    int heapPops;
+    long long relaxedArcs;
+    long long allocatedBytes;
+    bool cancelled;
+};
+
+/* Function: findShortestPath
+ * Usage: Path path = findShortestPath(start, finish);
+ *        Path path = findShortestPath(start, finish, mode);
+ * ---------------------------------------------------------
+ * Finds the shortest path between the nodes start and finish using
+ * the given search mode, which defaults to plain Dijkstra. The
+ * returned path is empty if start and finish are the same node or if
+ * no path exists.
+ */
+
+Path findShortestPath(Node *start, Node *finish, SearchMode mode = DIJKSTRA_SEARCH);
+
+/* Function: getLastSearchStats
+ * Usage: SearchStats stats = getLastSearchStats();
+ * ------------------------------------------------
+ * Returns the statistics of the most recent findShortestPath call.
+ */
+
+SearchStats getLastSearchStats();
+
+/* Type: PathCacheStats
+ * --------------------
+ * Counts how findShortestPath calls were answered. A path hit reuses
+ * a cached result for the same start, finish and mode; otherwise the
+ * call is a path miss. Each Dijkstra miss is then a tree hit if the
+ * retained tree for its start already settled the finish, a tree
+ * resume if that tree had to be grown further, or a tree miss.
+ */
+
+struct PathCacheStats {
+    long long pathHits;
+    long long pathMisses;
+    long long treeHits;
+    long long treeResumes;
+    long long treeMisses;
+};
+
+/* Function: getPathCacheStats
+ * Usage: PathCacheStats stats = getPathCacheStats();
+ * --------------------------------------------------
+ * Returns the cache counts accumulated since the program started.
+ */
+
+PathCacheStats getPathCacheStats();
+
+/* Function: clearPathCache
+ * Usage: clearPathCache();
+ * ------------------------
+ * Forgets every cached path and retained tree. The snapshot calls
+ * this whenever it is rebuilt, so results never outlive their map.
+ */
+
+void clearPathCache();
+
+/* Function: setPathCacheEnabled
+ * Usage: setPathCacheEnabled(false);
+ * ----------------------------------
+ * Turns the caches on or off; they start on. Timing code turns them
+ * off so that repeated pairs measure the search itself.
+ */
+
+void setPathCacheEnabled(bool enabled);
+
+/* Function: setSearchObserver
+ * Usage: setSearchObserver(observer);
+ * -----------------------------------
+ * Calls observer with the node ID of every node that later Dijkstra,
+ * A*, bidirectional and integer searches settle, until it is
+ * replaced; an empty function removes it. If observer returns false
+ * the search stops and findShortestPath returns an empty path with
+ * cancelled set in its stats. Observed queries neither use the path
+ * cache nor resume retained search trees, so every node they settle
+ * is reported. This is how a search on a background thread
+ * shows its progress and is cancelled (see backgroundworker.h).
+ */
+
+void setSearchObserver(std::function<bool(int)> observer);
+
+/* Type: SearchState
+ * -----------------
+ * The per-node arrays of a search over a GraphSnapshot. A state is
+ * sized for one snapshot version and reused across queries; touched
+ * lists the nodes whose entries were written so that resetting costs
+ * only as much as the last search. Code that searches from several
+ * threads gives each thread its own state.
+ */
+
+struct SearchState {
+    std::vector<double> distance;
+    std::vector<int> parentArc;     /* index into the snapshot's arcs */
+    std::vector<int> parent;
+    std::vector<int> touched;
+    IndexedHeap heap;
+    int version;
+
+    SearchState() : version(0) {}
+};
+
+/* Function: prepareSearchState
+ * Usage: prepareSearchState(graph, state);
+ * ----------------------------------------
+ * Resizes the arrays in state if they were sized for a different
+ * snapshot. Returns the number of bytes this allocated.
+ */
+
+long long prepareSearchState(const GraphSnapshot & graph, SearchState & state);
+
+/* Function: resetSearchState
+ * Usage: resetSearchState(state);
+ * -------------------------------
+ * Restores the entries written by the previous search.
+ */
+
+void resetSearchState(SearchState & state);
+
+/* Function: searchToTargets
+ * Usage: int settled = searchToTargets(graph, state, source, isTarget, targetCount);
+ * ----------------------------------------------------------------------------------
+ * Runs Dijkstra's algorithm from source until the targetCount nodes
+ * marked in isTarget have all been settled, or nothing more can be
+ * reached. Afterwards state.distance holds their final distances
+ * (INFINITE_DISTANCE if unreachable). Returns the number of nodes
+ * settled.
+ */
+
+int searchToTargets(const GraphSnapshot & graph, SearchState & state, int source,
+                    const std::vector<char> & isTarget, int targetCount);
+
+/* Function: searchAllNodes
+ * Usage: int settled = searchAllNodes(graph, state, source);
+ * ----------------------------------------------------------
+ * Runs Dijkstra's algorithm from source until every node it can
+ * reach has been settled, leaving the full shortest-path tree in
+ * state. Returns the number of nodes settled.
+ */
+
+int searchAllNodes(const GraphSnapshot & graph, SearchState & state, int source);
+
+/* Function: buildSearchPath
+ * Usage: Path path = buildSearchPath(graph, state, target);
+ * ---------------------------------------------------------
+ * Walks the parent arcs of a finished search back from target and
+ * adds them to a Path in start-to-finish order.
+ */
+
+Path buildSearchPath(const GraphSnapshot & graph, const SearchState & state, int target);
+
+#endif
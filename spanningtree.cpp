@@ -0,0 +1,231 @@
+/*
+ * File: spanningtree.cpp
+ * ----------------------
+ * This file implements the minimum spanning tree algorithms. Edges
+ * are ordered by cost, then by the IDs of their endpoints, then by
+ * their position in the edge list; with a strict order like this the
+ * minimum spanning tree is unique, which is why Kruskal and Boruvka
+ * return the same arcs.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "spanningtree.h"
+#include "disjointset.h"
+#include "instrumentation.h"
+using namespace std;
+
+/* CONSTANTS */
+const int PARALLEL_MST_EDGE_THRESHOLD = 200000;
+const int BORUVKA_TASK_EDGES = 16384;
+const int NO_EDGE = -1;
+
+
+/* Type: SpanningEdge
+ * ------------------
+ * One undirected edge. The endpoints are node IDs with u < v, and
+ * arc is the graph arc running from u to v.
+ */
+
+struct SpanningEdge {
+    double cost;
+    int u;
+    int v;
+    Arc *arc;
+};
+
+
+/* Function: collectUndirectedEdges
+ * Usage: collectUndirectedEdges(graph, edges);
+ * --------------------------------------------
+ * Fills edges with one entry per undirected edge of the snapshot,
+ * keeping only the arc whose start has the smaller ID.
+ */
+
+static void collectUndirectedEdges(const GraphSnapshot & graph, vector<SpanningEdge> & edges) {
+    edges.clear();
+    edges.reserve(graph.arcCount() / 2);
+    for (int u = 0; u < graph.nodeCount(); u++) {
+        for (int arc = graph.arcOffset[u]; arc < graph.arcOffset[u + 1]; arc++) {
+            int v = graph.arcTarget[arc];
+            if (u < v) {
+                SpanningEdge edge = { graph.arcCost[arc], u, v, graph.arcs[arc] };
+                edges.push_back(edge);
+            }
+        }
+    }
+}
+
+/* Function: lighter
+ * Usage: if (lighter(edges, a, b)) ...
+ * ------------------------------------
+ * Returns true if edge a comes before edge b in the strict order
+ * described at the top of this file.
+ */
+
+static inline bool lighter(const vector<SpanningEdge> & edges, int a, int b) {
+    const SpanningEdge & x = edges[a];
+    const SpanningEdge & y = edges[b];
+    if (x.cost != y.cost) return x.cost < y.cost;
+    if (x.u != y.u) return x.u < y.u;
+    if (x.v != y.v) return x.v < y.v;
+    return a < b;
+}
+
+/* Function: buildTreePath
+ * Usage: Path tree = buildTreePath(edges, accepted);
+ * --------------------------------------------------
+ * Sorts the accepted edge indices into Kruskal order and adds their
+ * arcs to a Path.
+ */
+
+static Path buildTreePath(const vector<SpanningEdge> & edges, vector<int> & accepted) {
+    sort(accepted.begin(), accepted.end(), [&edges](int a, int b) { return lighter(edges, a, b); });
+    Path tree;
+    for (size_t i = 0; i < accepted.size(); i++) {
+        tree.add(edges[accepted[i]].arc);
+    }
+    return tree;
+}
+
+/* Function: offerEdge
+ * Usage: offerEdge(edges, best[c], e);
+ * ------------------------------------
+ * Makes e the candidate in slot unless the slot already holds a
+ * lighter edge. Threads offering edges for the same component retry
+ * the compare-exchange until one of them wins with the lightest.
+ */
+
+static inline void offerEdge(const vector<SpanningEdge> & edges, atomic<int> & slot, int e) {
+    int current = slot.load(memory_order_relaxed);
+    while ((current == NO_EDGE || lighter(edges, e, current))
+           && !slot.compare_exchange_weak(current, e, memory_order_relaxed)) {
+    }
+}
+
+/* Function: reportUnionFind
+ * Usage: reportUnionFind(components);
+ * -----------------------------------
+ * Adds the union-find work of one spanning tree to the counters.
+ */
+
+static void reportUnionFind(const DisjointSet & components) {
+    addToCounter(COUNTER_FIND_CALLS, components.getFindCount());
+    addToCounter(COUNTER_UNION_CALLS, components.getUniteCount());
+}
+
+Path findMinimumSpanningTree(const GraphSnapshot & graph) {
+    PhaseTimer timer("mst");
+    timer.setArg("edges", graph.arcCount() / 2);
+    ThreadPool & pool = getSharedThreadPool();
+    if (pool.size() > 1 && graph.arcCount() / 2 >= PARALLEL_MST_EDGE_THRESHOLD) {
+        return boruvkaSpanningTree(graph, pool);
+    }
+    return kruskalSpanningTree(graph);
+}
+
+Path kruskalSpanningTree(const GraphSnapshot & graph) {
+    return kruskalSpanningTree(graph, function<bool(Arc *)>());
+}
+
+Path kruskalSpanningTree(const GraphSnapshot & graph, function<bool(Arc *)> accepted) {
+    vector<SpanningEdge> edges;
+    collectUndirectedEdges(graph, edges);
+    int nodeCount = graph.nodeCount();
+    vector<int> order(edges.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&edges](int a, int b) { return lighter(edges, a, b); });
+    DisjointSet components(nodeCount);
+    vector<int> tree;
+    for (size_t i = 0; i < order.size(); i++) {
+        const SpanningEdge & edge = edges[order[i]];
+        if (components.unite(edge.u, edge.v)) {
+            tree.push_back(order[i]);
+            if (accepted && !accepted(edge.arc)) break;
+            if (components.countSets() == 1) break;
+        }
+    }
+    reportUnionFind(components);
+    return buildTreePath(edges, tree);
+}
+
+/* Function: boruvkaSpanningTree
+ * -----------------------------
+ * The live edges are cut into tasks of BORUVKA_TASK_EDGES, and each
+ * round runs two parallelFor calls on the pool:
+ *
+ *      1) Every task offers each of its edges to the components at
+ *         both ends; best keeps, per component, the lightest edge
+ *         offered, so no per-thread copies have to be reduced.
+ *
+ *      2) After the candidates are merged in a DisjointSet (on the
+ *         calling thread, since that part is cheap), every task
+ *         drops its edges that now lie inside a single component.
+ *
+ * The number of components at least halves every round, so there
+ * are at most log2(n) rounds.
+ */
+
+Path boruvkaSpanningTree(const GraphSnapshot & graph, ThreadPool & pool) {
+    vector<SpanningEdge> edges;
+    collectUndirectedEdges(graph, edges);
+    int nodeCount = graph.nodeCount();
+    vector<int> live(edges.size());
+    for (size_t i = 0; i < live.size(); i++) {
+        live[i] = i;
+    }
+    vector<int> component(nodeCount);
+    vector<atomic<int>> best(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        component[i] = i;
+        best[i].store(NO_EDGE, memory_order_relaxed);
+    }
+    DisjointSet components(nodeCount);
+    vector< vector<int> > survivors;
+    vector<int> accepted;
+
+    while (!live.empty()) {
+        int liveCount = live.size();
+        int taskCount = (liveCount + BORUVKA_TASK_EDGES - 1) / BORUVKA_TASK_EDGES;
+        pool.parallelFor(taskCount, [&](int task, int) {
+            int end = min(liveCount, (task + 1) * BORUVKA_TASK_EDGES);
+            for (int i = task * BORUVKA_TASK_EDGES; i < end; i++) {
+                int e = live[i];
+                offerEdge(edges, best[component[edges[e].u]], e);
+                offerEdge(edges, best[component[edges[e].v]], e);
+            }
+        });
+        bool merged = false;
+        for (int c = 0; c < nodeCount; c++) {
+            if (component[c] != c) continue;
+            int e = best[c].load(memory_order_relaxed);
+            best[c].store(NO_EDGE, memory_order_relaxed);
+            if (e != NO_EDGE && components.unite(edges[e].u, edges[e].v)) {
+                accepted.push_back(e);
+                merged = true;
+            }
+        }
+        if (!merged) break;
+        for (int i = 0; i < nodeCount; i++) {
+            component[i] = components.find(i);
+        }
+        survivors.assign(taskCount, vector<int>());
+        pool.parallelFor(taskCount, [&](int task, int) {
+            vector<int> & kept = survivors[task];
+            int end = min(liveCount, (task + 1) * BORUVKA_TASK_EDGES);
+            for (int i = task * BORUVKA_TASK_EDGES; i < end; i++) {
+                int e = live[i];
+                if (component[edges[e].u] != component[edges[e].v]) kept.push_back(e);
+            }
+        });
+        live.clear();
+        for (int task = 0; task < taskCount; task++) {
+            live.insert(live.end(), survivors[task].begin(), survivors[task].end());
+        }
+    }
+    reportUnionFind(components);
+    return buildTreePath(edges, accepted);
+}
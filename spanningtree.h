@@ -0,0 +1,56 @@
+/*
+ * File: spanningtree.h
+ * --------------------
+ * This file exports the minimum spanning tree algorithms used by the
+ * Kruskal button. Both algorithms treat each pair of opposite arcs
+ * created by loadMapFile as a single undirected edge and break ties
+ * between equal costs the same way, so they always agree on the tree.
+ */
+
+#ifndef _spanningtree_h
+#define _spanningtree_h
+
+#include <functional>
+#include "graphsnapshot.h"
+#include "path.h"
+#include "threadpool.h"
+
+/* Function: findMinimumSpanningTree
+ * Usage: Path tree = findMinimumSpanningTree(graph);
+ * --------------------------------------------------
+ * Returns the arcs of a minimum spanning forest of the snapshot graph
+ * (usually getGraphSnapshot()), one arc per
+ * undirected edge. Small graphs are handled by kruskalSpanningTree;
+ * graphs with many edges use boruvkaSpanningTree on the shared
+ * ThreadPool.
+ */
+
+Path findMinimumSpanningTree(const GraphSnapshot & graph);
+
+/* Function: kruskalSpanningTree
+ * Usage: Path tree = kruskalSpanningTree(graph);
+ *        Path tree = kruskalSpanningTree(graph, accepted);
+ * --------------------------------------------------------
+ * Sorts the undirected edges by cost and accepts each one that joins
+ * two different components of a DisjointSet. The arcs are returned in
+ * the order they were accepted. If accepted is given it is called
+ * with each arc as it joins the tree, and returning false stops the
+ * algorithm, which then returns the part of the tree found so far.
+ */
+
+Path kruskalSpanningTree(const GraphSnapshot & graph);
+Path kruskalSpanningTree(const GraphSnapshot & graph, std::function<bool(Arc *)> accepted);
+
+/* Function: boruvkaSpanningTree
+ * Usage: Path tree = boruvkaSpanningTree(graph, pool);
+ * ----------------------------------------------------
+ * Computes the same tree as kruskalSpanningTree with Boruvka's
+ * algorithm: in each round, the workers of pool find the cheapest
+ * edge leaving every component, those edges are merged, and edges
+ * that became internal are filtered out. The arcs are returned in
+ * the same order Kruskal would accept them.
+ */
+
+Path boruvkaSpanningTree(const GraphSnapshot & graph, ThreadPool & pool);
+
+#endif
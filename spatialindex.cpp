@@ -0,0 +1,175 @@
+/*
+ * File: spatialindex.cpp
+ * ----------------------
+ * This file implements the SpatialIndex class. The cells are stored
+ * like the arcs of a GraphSnapshot: cellNodes holds the node IDs of
+ * every cell back to back, and cellStart[c] is where cell c begins.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include "spatialindex.h"
+using namespace std;
+
+/* CONSTANTS */
+const double NODES_PER_CELL = 2;
+const size_t MAX_CELLS_PER_NODE = 4;
+
+
+SpatialIndex::SpatialIndex() {
+    clear();
+}
+
+void SpatialIndex::clear() {
+    xCoord.clear();
+    yCoord.clear();
+    cellStart.assign(1, 0);
+    cellNodes.clear();
+    minX = minY = 0;
+    cellSize = 1;
+    columns = rows = 0;
+    snapshotVersion = -1;
+}
+
+/* Method: build
+ * -------------
+ * Cells are sized for NODES_PER_CELL nodes each over the bounding
+ * box. A long, thin box would still need far more cells than nodes
+ * along its long side, so the cell size is doubled until the grid has
+ * at most MAX_CELLS_PER_NODE cells per node.
+ */
+
+void SpatialIndex::build(const GraphSnapshot & snapshot) {
+    clear();
+    int nodeCount = snapshot.nodeCount();
+    snapshotVersion = snapshot.version;
+    if (nodeCount == 0) return;
+    xCoord = snapshot.xCoord;
+    yCoord = snapshot.yCoord;
+    minX = *min_element(xCoord.begin(), xCoord.end());
+    minY = *min_element(yCoord.begin(), yCoord.end());
+    double width = *max_element(xCoord.begin(), xCoord.end()) - minX;
+    double height = *max_element(yCoord.begin(), yCoord.end()) - minY;
+    double area = max(width, 1.0) * max(height, 1.0);
+    cellSize = sqrt(area * NODES_PER_CELL / nodeCount);
+    double maxCells = min((size_t) INT_MAX - 1, MAX_CELLS_PER_NODE * nodeCount);
+    while ((floor(width / cellSize) + 1) * (floor(height / cellSize) + 1) > maxCells) {
+        cellSize *= 2;
+    }
+    columns = (int) (width / cellSize) + 1;
+    rows = (int) (height / cellSize) + 1;
+
+    size_t cellCount = (size_t) columns * rows;
+    cellStart.assign(cellCount + 1, 0);
+    vector<int> cellOf(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        cellOf[i] = rowOf(yCoord[i]) * columns + columnOf(xCoord[i]);
+        cellStart[cellOf[i] + 1]++;
+    }
+    for (size_t c = 0; c < cellCount; c++) {
+        cellStart[c + 1] += cellStart[c];
+    }
+    vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    cellNodes.resize(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        cellNodes[fill[cellOf[i]]++] = i;
+    }
+}
+
+bool SpatialIndex::isBuiltFor(const GraphSnapshot & snapshot) const {
+    return snapshotVersion == snapshot.version;
+}
+
+/* Method: nearestNode
+ * -------------------
+ * Scans square rings of cells around the cell nearest (x, y). Every
+ * cell in ring r + 1 is at least r cell widths from the point, so the
+ * scan stops once the best node found is closer than that or the
+ * rings have passed the edge of the range or of the grid.
+ */
+
+int SpatialIndex::nearestNode(double x, double y, double range) const {
+    if (cellNodes.empty()) return NO_NODE;
+    int column = columnOf(x);
+    int row = rowOf(y);
+    double bestSquared = range * range;
+    int best = NO_NODE;
+    int lastRing = max(max(column, columns - 1 - column), max(row, rows - 1 - row));
+    for (int ring = 0; ring <= lastRing; ring++) {
+        double reach = (ring - 1) * cellSize;
+        if (ring > 0 && reach * reach > bestSquared) break;
+        for (int r = row - ring; r <= row + ring; r++) {
+            if (r < 0 || r >= rows) continue;
+            bool edgeRow = (r == row - ring || r == row + ring);
+            int step = edgeRow ? 1 : 2 * ring;
+            for (int c = column - ring; c <= column + ring; c += max(step, 1)) {
+                if (c >= 0 && c < columns) scanCell(c, r, x, y, bestSquared, best);
+            }
+        }
+    }
+    return best;
+}
+
+vector<int> SpatialIndex::nodesInRange(double x, double y, double range) const {
+    vector<int> found;
+    if (cellNodes.empty()) return found;
+    double rangeSquared = range * range;
+    int firstColumn = columnOf(x - range), lastColumn = columnOf(x + range);
+    int firstRow = rowOf(y - range), lastRow = rowOf(y + range);
+    for (int r = firstRow; r <= lastRow; r++) {
+        for (int c = firstColumn; c <= lastColumn; c++) {
+            int cell = r * columns + c;
+            for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                int id = cellNodes[k];
+                double dx = xCoord[id] - x;
+                double dy = yCoord[id] - y;
+                if (dx * dx + dy * dy < rangeSquared) found.push_back(id);
+            }
+        }
+    }
+    sort(found.begin(), found.end());
+    return found;
+}
+
+/* Method: columnOf, rowOf
+ * -----------------------
+ * Return the grid column or row containing a coordinate, clamped to
+ * the grid so that points off the map use its nearest edge cells.
+ */
+
+int SpatialIndex::columnOf(double x) const {
+    double column = floor((x - minX) / cellSize);
+    return (int) max(0.0, min(column, (double) columns - 1));
+}
+
+int SpatialIndex::rowOf(double y) const {
+    double row = floor((y - minY) / cellSize);
+    return (int) max(0.0, min(row, (double) rows - 1));
+}
+
+/* Method: scanCell
+ * ----------------
+ * Updates best and bestSquared with any node in the cell that is
+ * closer to (x, y), preferring the lower ID on a tie.
+ */
+
+void SpatialIndex::scanCell(int column, int row, double x, double y,
+                            double & bestSquared, int & best) const {
+    int cell = row * columns + column;
+    for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+        int id = cellNodes[k];
+        double dx = xCoord[id] - x;
+        double dy = yCoord[id] - y;
+        double squared = dx * dx + dy * dy;
+        if (squared < bestSquared || (squared == bestSquared && best != NO_NODE && id < best)) {
+            bestSquared = squared;
+            best = id;
+        }
+    }
+}
+
+SpatialIndex & getSpatialIndex() {
+    static SpatialIndex index;
+    return index;
+}
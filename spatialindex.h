@@ -0,0 +1,106 @@
+/*
+ * File: spatialindex.h
+ * --------------------
+ * This file exports the SpatialIndex class, a uniform grid over the
+ * node locations of a GraphSnapshot. Each cell lists the nodes that
+ * fall inside it, so finding the city nearest a point only examines
+ * the few cells around it instead of every node on the map. All
+ * distances are compared squared; no square roots are taken.
+ */
+
+#ifndef _spatialindex_h
+#define _spatialindex_h
+
+#include <limits>
+#include <vector>
+#include "graphsnapshot.h"
+
+/* CONSTANTS */
+const double UNLIMITED_RANGE = std::numeric_limits<double>::infinity();
+
+class SpatialIndex {
+
+public:
+
+/* Constructor: SpatialIndex
+ * Usage: SpatialIndex index;
+ * --------------------------
+ * Creates an empty index that matches no snapshot.
+ */
+
+    SpatialIndex();
+
+/* Method: build
+ * Usage: index.build(snapshot);
+ * -----------------------------
+ * Sorts the nodes of snapshot into grid cells, sizing the grid so
+ * that a cell holds about two nodes on average.
+ */
+
+    void build(const GraphSnapshot & snapshot);
+
+/* Method: clear
+ * Usage: index.clear();
+ * ---------------------
+ * Discards the index.
+ */
+
+    void clear();
+
+/* Method: isBuiltFor
+ * Usage: if (index.isBuiltFor(snapshot)) ...
+ * ------------------------------------------
+ * Returns true if the index was built from this version of the
+ * snapshot.
+ */
+
+    bool isBuiltFor(const GraphSnapshot & snapshot) const;
+
+/* Method: nearestNode
+ * Usage: int id = index.nearestNode(x, y, range);
+ * -----------------------------------------------
+ * Returns the ID of the node closest to (x, y) that lies strictly
+ * within range of it, or NO_NODE if there is none. Ties go to the
+ * lower ID. The range defaults to the whole map.
+ */
+
+    int nearestNode(double x, double y, double range = UNLIMITED_RANGE) const;
+
+/* Method: nodesInRange
+ * Usage: vector<int> ids = index.nodesInRange(x, y, range);
+ * ---------------------------------------------------------
+ * Returns the IDs of every node strictly within range of (x, y), in
+ * increasing order.
+ */
+
+    std::vector<int> nodesInRange(double x, double y, double range) const;
+
+private:
+
+    std::vector<double> xCoord;
+    std::vector<double> yCoord;
+    std::vector<int> cellStart;
+    std::vector<int> cellNodes;
+    double minX;
+    double minY;
+    double cellSize;
+    int columns;
+    int rows;
+    int snapshotVersion;
+
+    int columnOf(double x) const;
+    int rowOf(double y) const;
+    void scanCell(int column, int row, double x, double y, double & bestSquared, int & best) const;
+
+};
+
+/* Function: getSpatialIndex
+ * Usage: const SpatialIndex & index = getSpatialIndex();
+ * ------------------------------------------------------
+ * Returns the index of the current GraphSnapshot, which
+ * refreshGraphSnapshot rebuilds whenever a map is loaded.
+ */
+
+SpatialIndex & getSpatialIndex();
+
+#endif
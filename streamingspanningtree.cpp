@@ -0,0 +1,355 @@
+/*
+ * File: streamingspanningtree.cpp
+ * -------------------------------
+ * This file implements the streaming spanning tree mode. Run files
+ * hold raw StreamEdge records in sorted order; a merge reads each run
+ * through its own share of the memory budget and keeps the current
+ * record of every run in a heap.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+#include "streamingspanningtree.h"
+#include "disjointset.h"
+#include "instrumentation.h"
+#include "maploader.h"
+using namespace std;
+
+/* CONSTANTS */
+const size_t MIN_MEMORY_BUDGET = 1 << 20;
+const size_t DEFAULT_MEMORY_MB = 256;
+const size_t MIN_RUN_BUFFER_BYTES = 64 << 10;
+const int COST_PRECISION = 12;
+
+
+/* Type: StreamEdge
+ * ----------------
+ * One road as it is sorted and spilled: its cost, its city IDs with
+ * u <= v, and its position among the roads of the file.
+ */
+
+struct StreamEdge {
+    double cost;
+    int u;
+    int v;
+    long long sequence;
+};
+
+/* Type: RunReader
+ * ---------------
+ * A run file being merged, with the records read from it so far and
+ * the index of the next one to use.
+ */
+
+struct RunReader {
+    ifstream file;
+    vector<StreamEdge> buffer;
+    size_t next;
+};
+
+
+/* Function: lighterEdge
+ * Usage: if (lighterEdge(a, b)) ...
+ * ---------------------------------
+ * Returns true if a comes before b in Kruskal's order.
+ */
+
+static inline bool lighterEdge(const StreamEdge & a, const StreamEdge & b) {
+    if (a.cost != b.cost) return a.cost < b.cost;
+    if (a.u != b.u) return a.u < b.u;
+    if (a.v != b.v) return a.v < b.v;
+    return a.sequence < b.sequence;
+}
+
+/* Function: secondsSince
+ * Usage: double seconds = secondsSince(start);
+ * --------------------------------------------
+ * Returns the time elapsed since start.
+ */
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/* Function: removeRuns
+ * Usage: removeRuns(runs);
+ * ------------------------
+ * Deletes the run files named in runs.
+ */
+
+static void removeRuns(const vector<string> & runs) {
+    for (size_t i = 0; i < runs.size(); i++) {
+        remove(runs[i].c_str());
+    }
+}
+
+/* Function: createRunFile
+ * Usage: if (createRunFile(tempDirectory, filename)) ...
+ * ------------------------------------------------------
+ * Creates an empty run file with a unique name in tempDirectory and
+ * stores its name in filename. mkstemp picks the name, so processes
+ * sharing the directory never write to each other's runs.
+ */
+
+static bool createRunFile(const string & tempDirectory, string & filename) {
+    string pattern = tempDirectory + "/pathfinder-mst-XXXXXX";
+    vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+    int fd = mkstemp(name.data());
+    if (fd < 0) return false;
+    close(fd);
+    filename = name.data();
+    return true;
+}
+
+/* Function: writeRun
+ * Usage: if (writeRun(edges, tempDirectory, runs, stats)) ...
+ * -----------------------------------------------------------
+ * Sorts edges and writes them to a new run file in tempDirectory,
+ * whose name is added to runs.
+ */
+
+static bool writeRun(vector<StreamEdge> & edges, const string & tempDirectory, vector<string> & runs,
+                     StreamingTreeStats & stats) {
+    PhaseTimer timer("spill run");
+    string filename;
+    if (!createRunFile(tempDirectory, filename)) return false;
+    runs.push_back(filename);
+    sort(edges.begin(), edges.end(), lighterEdge);
+    ofstream file(filename.c_str(), ios::binary);
+    file.write((const char *) edges.data(), edges.size() * sizeof(StreamEdge));
+    file.close();
+    stats.runs++;
+    stats.spilledBytes += edges.size() * sizeof(StreamEdge);
+    timer.setArg("edges", edges.size());
+    return !file.fail();
+}
+
+/* Function: refillRun
+ * Usage: if (refillRun(run)) ...
+ * ------------------------------
+ * Reads the next buffer's worth of records from run. Returns false
+ * once the run is used up.
+ */
+
+static bool refillRun(RunReader & run) {
+    run.buffer.resize(run.buffer.capacity());
+    run.file.read((char *) run.buffer.data(), run.buffer.size() * sizeof(StreamEdge));
+    run.buffer.resize(run.file.gcount() / sizeof(StreamEdge));
+    run.next = 0;
+    return !run.buffer.empty();
+}
+
+/* Function: mergeRuns
+ * Usage: mergeRuns(runs, memoryBudget, sink);
+ * -------------------------------------------
+ * Passes the records of every run to sink in Kruskal's order, with
+ * the budget split evenly between the runs' buffers, until the runs
+ * are used up or sink returns false.
+ */
+
+static void mergeRuns(const vector<string> & runs, size_t memoryBudget, function<bool(const StreamEdge &)> sink) {
+    size_t bufferEdges = max((size_t) 1, memoryBudget / runs.size() / sizeof(StreamEdge));
+    vector<RunReader> readers(runs.size());
+    auto later = [&readers](int a, int b) {
+        return lighterEdge(readers[b].buffer[readers[b].next], readers[a].buffer[readers[a].next]);
+    };
+    priority_queue<int, vector<int>, decltype(later)> heads(later);
+    for (size_t i = 0; i < runs.size(); i++) {
+        readers[i].file.open(runs[i].c_str(), ios::binary);
+        readers[i].buffer.reserve(bufferEdges);
+        if (refillRun(readers[i])) heads.push(i);
+    }
+    while (!heads.empty()) {
+        int i = heads.top();
+        heads.pop();
+        RunReader & run = readers[i];
+        if (!sink(run.buffer[run.next])) return;
+        if (++run.next < run.buffer.size() || refillRun(run)) heads.push(i);
+    }
+}
+
+bool streamMinimumSpanningTree(const string & mapName, ostream & out, size_t memoryBudget,
+                               const string & tempDirectory, StreamingTreeStats & stats) {
+    PhaseTimer timer("streaming mst");
+    stats = StreamingTreeStats();
+    memoryBudget = max(memoryBudget, MIN_MEMORY_BUDGET);
+    size_t capacity = memoryBudget / sizeof(StreamEdge);
+    deque<string> names;
+    unordered_map<string_view, int> cityIds;
+    vector<StreamEdge> edges;
+    edges.reserve(capacity);
+    vector<string> runs;
+    bool written = true;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    string imageName = scanMapFile(mapName,
+        [&](string_view city, double, double) {
+            if (cityIds.count(city) > 0) return;
+            names.push_back(string(city));
+            cityIds[names.back()] = names.size() - 1;
+        },
+        [&](string_view one, string_view two, double cost) {
+            unordered_map<string_view, int>::iterator first = cityIds.find(one);
+            unordered_map<string_view, int>::iterator second = cityIds.find(two);
+            if (first == cityIds.end() || second == cityIds.end()) {
+                stats.skippedRoads++;
+                return;
+            }
+            StreamEdge edge = { cost, min(first->second, second->second), max(first->second, second->second),
+                                stats.roads++ };
+            edges.push_back(edge);
+            if (edges.size() == capacity) {
+                written = writeRun(edges, tempDirectory, runs, stats) && written;
+                edges.clear();
+            }
+        });
+    if (imageName.empty()) {
+        removeRuns(runs);
+        return false;
+    }
+    if (!runs.empty()) {
+        if (!edges.empty()) {
+            written = writeRun(edges, tempDirectory, runs, stats) && written;
+        }
+        vector<StreamEdge>().swap(edges);
+    }
+    stats.cities = names.size();
+    stats.scanSeconds = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    size_t maxFanIn = max((size_t) 2, memoryBudget / MIN_RUN_BUFFER_BYTES);
+    while (written && runs.size() > maxFanIn) {
+        vector<string> merged;
+        for (size_t first = 0; first < runs.size(); first += maxFanIn) {
+            vector<string> group(runs.begin() + first, runs.begin() + min(runs.size(), first + maxFanIn));
+            string mergedName;
+            if (!createRunFile(tempDirectory, mergedName)) {
+                written = false;
+                break;
+            }
+            merged.push_back(mergedName);
+            ofstream file(mergedName.c_str(), ios::binary);
+            mergeRuns(group, memoryBudget, [&file](const StreamEdge & edge) {
+                file.write((const char *) &edge, sizeof(StreamEdge));
+                return true;
+            });
+            file.close();
+            written = written && !file.fail();
+            removeRuns(group);
+        }
+        if (!written) {
+            removeRuns(merged);
+            break;
+        }
+        runs.swap(merged);
+        stats.mergePasses++;
+    }
+
+    DisjointSet components(names.size());
+    long long treeLimit = (long long) names.size() - 1;
+    out.precision(COST_PRECISION);
+    auto accept = [&](const StreamEdge & edge) {
+        if (components.unite(edge.u, edge.v)) {
+            out<<names[edge.u]<<" "<<names[edge.v]<<" "<<edge.cost<<'\n';
+            stats.treeEdges++;
+            stats.treeCost += edge.cost;
+        }
+        return stats.treeEdges < treeLimit;
+    };
+    if (runs.empty()) {
+        sort(edges.begin(), edges.end(), lighterEdge);
+        for (size_t i = 0; i < edges.size() && accept(edges[i]); i++) {}
+    } else if (written) {
+        mergeRuns(runs, memoryBudget, accept);
+    }
+    removeRuns(runs);
+    stats.mergeSeconds = secondsSince(start);
+    timer.setArg("roads", stats.roads);
+    timer.setArg("runs", stats.runs);
+    return written;
+}
+
+/* Function: parseMegabytes
+ * Usage: if (parseMegabytes(value, megabytes)) ...
+ * ------------------------------------------------
+ * Reads value as a positive whole number of megabytes. Returns false
+ * if it is not made of digits alone, is 0, or is too large to count
+ * in bytes.
+ */
+
+static bool parseMegabytes(const string & value, size_t & megabytes) {
+    if (value.empty() || value.find_first_not_of("0123456789") != string::npos) return false;
+    errno = 0;
+    char *end;
+    unsigned long long number = strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || number == 0 || number > (SIZE_MAX >> 20)) return false;
+    megabytes = number;
+    return true;
+}
+
+int runStreamingTreeMode(int argc, char *argv[]) {
+    string mapName, tempDirectory = ".", outputName = "-";
+    size_t memoryMegabytes = DEFAULT_MEMORY_MB;
+    bool valid = argc >= 3;
+    if (valid) mapName = argv[2];
+    for (int i = 3; valid && i < argc; i += 2) {
+        string flag = argv[i];
+        if (i + 1 >= argc) {
+            valid = false;
+            break;
+        }
+        string value = argv[i + 1];
+        if (flag == "--memory" && parseMegabytes(value, memoryMegabytes)) {
+            continue;
+        } else if (flag == "--temp") {
+            tempDirectory = value;
+        } else if (flag == "--output") {
+            outputName = value;
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        cerr<<"Usage: "<<argv[0]<<" --stream-mst FILE [--memory MB] [--temp DIR] [--output FILE]"<<endl;
+        return 1;
+    }
+    ofstream outputFile;
+    if (outputName != "-") {
+        outputFile.open(outputName.c_str());
+        if (outputFile.fail()) {
+            cerr<<"Could not write "<<outputName<<endl;
+            return 1;
+        }
+    }
+    ostream & out = (outputName == "-") ? cout : outputFile;
+    StreamingTreeStats stats;
+    if (!streamMinimumSpanningTree(mapName, out, memoryMegabytes << 20, tempDirectory, stats)) {
+        cerr<<"Could not read "<<mapName<<" or write runs to "<<tempDirectory<<endl;
+        return 1;
+    }
+    out.flush();
+    cerr.precision(COST_PRECISION);
+    cerr<<"Scanned "<<stats.cities<<" cities and "<<stats.roads<<" roads ("<<stats.skippedRoads
+        <<" skipped) in "<<stats.scanSeconds<<" s"<<endl;
+    cerr<<"Spilled "<<stats.runs<<" runs ("<<stats.spilledBytes<<" bytes), "<<stats.mergePasses
+        <<" extra merge passes"<<endl;
+    cerr<<"Tree: "<<stats.treeEdges<<" edges, cost "<<stats.treeCost<<", merged in "<<stats.mergeSeconds
+        <<" s"<<endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * File: streamingspanningtree.h
+ * -----------------------------
+ * This file exports the streaming spanning tree mode, which finds the
+ * minimum spanning forest of a map file whose roads do not fit in
+ * memory. The file is scanned once without building a graph: each
+ * road becomes one small edge record (not the two Arc structs that
+ * loadMapFile makes), and whenever the records fill the memory
+ * budget they are sorted and written to a run file on local disk.
+ * The runs are then merged in cost order, through more passes if
+ * there are too many to merge at once, and Kruskal's algorithm
+ * accepts edges from the merged stream with a DisjointSet over city
+ * IDs. Only the city names, their IDs and the DisjointSet stay in
+ * memory outside the budget, so memory grows with the number of
+ * cities, not roads.
+ *
+ * Usage: Pathfinder --stream-mst FILE [--memory MB] [--temp DIR]
+ *                   [--output FILE]
+ *
+ * The tree is written as "city city cost" lines, the format of the
+ * ARCS section of a map file, in the order Kruskal accepts them.
+ * Ties between equal costs are broken by the order of the cities in
+ * the file and then by the position of the road. spanningtree.h
+ * breaks them by snapshot IDs, which follow the node order chosen at
+ * load, so where costs tie the two can choose different trees of the
+ * same total cost. Statistics go to standard error.
+ */
+
+#ifndef _streamingspanningtree_h
+#define _streamingspanningtree_h
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+/* Type: StreamingTreeStats
+ * ------------------------
+ * Describes one streaming run: the cities and roads read (roads
+ * naming an unknown city are skipped), the sorted runs spilled to
+ * disk and the bytes they took, the merge passes needed before the
+ * final one, and the resulting tree.
+ */
+
+struct StreamingTreeStats {
+    int cities;
+    long long roads;
+    long long skippedRoads;
+    int runs;
+    int mergePasses;
+    long long spilledBytes;
+    long long treeEdges;
+    double treeCost;
+    double scanSeconds;
+    double mergeSeconds;
+};
+
+/* Function: streamMinimumSpanningTree
+ * Usage: if (streamMinimumSpanningTree(mapName, out, memoryBudget, tempDirectory, stats)) ...
+ * -------------------------------------------------------------------------------------------
+ * Writes the minimum spanning forest of the map file mapName to out
+ * while keeping at most memoryBudget bytes of road records in memory
+ * (at least 1 MB is used). Run files are created in tempDirectory
+ * and removed afterwards. Returns false if the map cannot be read or
+ * a run file cannot be written.
+ */
+
+bool streamMinimumSpanningTree(const std::string & mapName, std::ostream & out, size_t memoryBudget,
+                               const std::string & tempDirectory, StreamingTreeStats & stats);
+
+/* Function: runStreamingTreeMode
+ * Usage: return runStreamingTreeMode(argc, argv);
+ * -----------------------------------------------
+ * Runs the streaming spanning tree mode with the program's
+ * command-line arguments, the first of which is --stream-mst, and
+ * returns the exit status for main.
+ */
+
+int runStreamingTreeMode(int argc, char *argv[]);
+
+#endif
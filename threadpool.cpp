@@ -0,0 +1,133 @@
+/*
+ * File: threadpool.cpp
+ * --------------------
+ * This file implements the ThreadPool class. Tasks of a parallelFor
+ * are dealt out to the workers' queues in contiguous blocks; owners
+ * take from the back of their own queue and thieves from the front
+ * of someone else's, which keeps the two ends from contending.
+ */
+
+#include <stdexcept>
+#include "threadpool.h"
+using namespace std;
+
+/* The pool whose task the current thread is running, if any */
+static thread_local const ThreadPool *runningPool = NULL;
+
+ThreadPool::ThreadPool(int threadCount) {
+    if (threadCount <= 0) threadCount = thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 1;
+    remainingTasks = 0;
+    generation = 0;
+    busyWorkers = 0;
+    stopping = false;
+    for (int i = 0; i < threadCount; i++) {
+        queues.push_back(unique_ptr<WorkQueue>(new WorkQueue));
+    }
+    for (int i = 0; i < threadCount; i++) {
+        threads.push_back(thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(stateLock);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+int ThreadPool::size() const {
+    return threads.size();
+}
+
+/* Method: parallelFor
+ * -------------------
+ * The call waits both for the last task to finish and for every
+ * worker to leave its task loop, so a worker still looking for work
+ * from this call can never pick up a task from the next one. Holding
+ * callerLock for the whole call keeps a second caller from replacing
+ * currentBody or dealing tasks into queues that are still in use.
+ */
+
+void ThreadPool::parallelFor(int count, function<void(int, int)> body) {
+    if (runningPool == this) throw logic_error("ThreadPool::parallelFor called from one of its own tasks");
+    if (count <= 0) return;
+    lock_guard<mutex> callerGuard(callerLock);
+    unique_lock<mutex> guard(stateLock);
+    currentBody = body;
+    int workerCount = queues.size();
+    for (int w = 0; w < workerCount; w++) {
+        int begin = (long long) count * w / workerCount;
+        int end = (long long) count * (w + 1) / workerCount;
+        lock_guard<mutex> queueGuard(queues[w]->lock);
+        for (int task = begin; task < end; task++) {
+            queues[w]->tasks.push_back(task);
+        }
+    }
+    remainingTasks = count;
+    busyWorkers = workerCount;
+    generation++;
+    workReady.notify_all();
+    workDone.wait(guard, [this]() { return remainingTasks == 0 && busyWorkers == 0; });
+    currentBody = nullptr;
+}
+
+/* Method: takeTask
+ * Usage: if (takeTask(worker, task)) ...
+ * --------------------------------------
+ * Pops a task from the back of the worker's own queue, or failing
+ * that steals one from the front of another queue. Returns false if
+ * every queue is empty.
+ */
+
+bool ThreadPool::takeTask(int worker, int & task) {
+    int workerCount = queues.size();
+    for (int offset = 0; offset < workerCount; offset++) {
+        WorkQueue & queue = *queues[(worker + offset) % workerCount];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty()) continue;
+        if (offset == 0) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int worker) {
+    runningPool = this;
+    int seenGeneration = 0;
+    while (true) {
+        function<void(int, int)> body;
+        {
+            unique_lock<mutex> guard(stateLock);
+            workReady.wait(guard, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            body = currentBody;
+        }
+        int task;
+        while (takeTask(worker, task)) {
+            body(task, worker);
+            remainingTasks--;
+        }
+        {
+            lock_guard<mutex> guard(stateLock);
+            busyWorkers--;
+        }
+        workDone.notify_all();
+    }
+}
+
+ThreadPool & getSharedThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,101 @@
+/*
+ * File: threadpool.h
+ * ------------------
+ * This file exports the ThreadPool class, a fixed set of worker
+ * threads for running many independent tasks, such as one search per
+ * source city. Each worker has its own queue of task indices; when a
+ * worker runs out it steals from the front of another worker's queue,
+ * so uneven task costs still keep every core busy.
+ */
+
+#ifndef _threadpool_h
+#define _threadpool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+
+public:
+
+/* Constructor: ThreadPool
+ * Usage: ThreadPool pool;
+ *        ThreadPool pool(threadCount);
+ * ------------------------------------
+ * Starts threadCount workers, or one per hardware thread if
+ * threadCount is not positive.
+ */
+
+    ThreadPool(int threadCount = 0);
+
+/* Destructor: ~ThreadPool
+ * -----------------------
+ * Stops and joins the workers.
+ */
+
+    ~ThreadPool();
+
+/* Method: size
+ * Usage: int workers = pool.size();
+ * ---------------------------------
+ * Returns the number of worker threads.
+ */
+
+    int size() const;
+
+/* Method: parallelFor
+ * Usage: pool.parallelFor(count, body);
+ * -------------------------------------
+ * Calls body(index, worker) once for every index in [0, count) and
+ * returns when all calls have finished. worker is the number, in
+ * [0, size()), of the thread making the call, which lets body reuse
+ * per-thread scratch space. Calls from different threads take turns,
+ * each waiting for the one before it to finish. Calling parallelFor
+ * from inside body, which could never finish, throws logic_error.
+ */
+
+    void parallelFor(int count, std::function<void(int, int)> body);
+
+private:
+
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector< std::unique_ptr<WorkQueue> > queues;
+    std::function<void(int, int)> currentBody;
+    std::mutex callerLock;
+    std::mutex stateLock;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    std::atomic<int> remainingTasks;
+    int generation;
+    int busyWorkers;
+    bool stopping;
+
+    void workerLoop(int worker);
+    bool takeTask(int worker, int & task);
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool & operator=(const ThreadPool &);
+
+};
+
+/* Function: getSharedThreadPool
+ * Usage: ThreadPool & pool = getSharedThreadPool();
+ * -------------------------------------------------
+ * Returns a pool with one worker per hardware thread, created on
+ * first use and shared by the whole program.
+ */
+
+ThreadPool & getSharedThreadPool();
+
+#endif